@@ -8,9 +8,19 @@
 #include <FL/Fl_Choice.H>
 #include <FL/Fl_Multiline_Input.H>
 #include <FL/Fl_Value_Input.H>
+#include <FL/Fl_Button.H>
+#include <FL/Fl_Check_Button.H>
+#include <FL/Fl_Box.H>
+#include <FL/Fl_Progress.H>
+#include "DatabaseManager.h"
+#include "ResultsTable.h"
 
 class AdminDashboard {
 private:
+    // The open dashboard, if any; worker completions check it before
+    // touching widgets in case the admin logged out meanwhile
+    static AdminDashboard* current;
+    
     Fl_Window* window;
     Fl_Tabs* tabs;
     
@@ -20,7 +30,10 @@ private:
     Fl_Value_Input* timeInput;
     Fl_Value_Input* questionsCountInput;
     Fl_Value_Input* passingMarkInput;
+    Fl_Check_Button* balancedCheck;
     Fl_Browser* courseBrowser;
+    Fl_Button* pregenBtn;
+    Fl_Button* blueprintBtn;
     
     // Question management widgets
     Fl_Choice* courseChoice;
@@ -31,18 +44,34 @@ private:
     Fl_Input* optDInput;
     Fl_Choice* correctChoice;
     Fl_Browser* questionBrowser;
+    Fl_Button* uploadBtn;
+    Fl_Button* fixKeyBtn;
+    Fl_Progress* uploadProgress;
     
     // Results widgets
-    Fl_Browser* resultsBrowser;
+    Fl_Choice* resultCourseChoice;
+    Fl_Choice* resultStatusChoice;
+    Fl_Box* resultsCountBox;
+    ResultsTable* resultsTable;
     
     // Callbacks
     static void addCourseCallback(Fl_Widget* w, void* data);
     static void refreshCoursesCallback(Fl_Widget* w, void* data);
     static void debugDatabaseCallback(Fl_Widget* w, void* data);
+    static void pregenPapersCallback(Fl_Widget* w, void* data);
+    static void pregenDone(void* data);
+    static void setBlueprintCallback(Fl_Widget* w, void* data);
     static void addQuestionCallback(Fl_Widget* w, void* data);
     static void uploadQuestionsCallback(Fl_Widget* w, void* data);
     static void refreshQuestionsCallback(Fl_Widget* w, void* data);
     static void viewResultsCallback(Fl_Widget* w, void* data);
+    static void reportUploadProgress(int done, int total, void* data);
+    static void uploadProgressed(void* data);
+    static void uploadDone(void* data);
+    static void fixAnswerKeyCallback(Fl_Widget* w, void* data);
+    static void reportRegradeProgress(int done, int total, void* data);
+    static void regradeDone(void* data);
+    static void resultsCounted(void* data);
     static void addUserCallback(Fl_Widget* w, void* data);
     static void logoutCallback(Fl_Widget* w, void* data);
     
@@ -53,7 +82,6 @@ private:
     void refreshCourseChoice();
     void refreshQuestionBrowser();
     void refreshResults();
-    int uploadQuestionsFromFile(const char* filename, int courseId);
     
 public:
     AdminDashboard();
@@ -0,0 +1,27 @@
+#ifndef ANALYTICS_H
+#define ANALYTICS_H
+
+#include <vector>
+#include "DatabaseManager.h"
+
+using namespace std;
+
+// Totals over one candidate's exam history
+class HistorySummary {
+public:
+    int taken;
+    int passed;
+    double totalPercentage;
+    vector<Result> recent;      // newest first
+    
+    HistorySummary();
+    double averagePercentage() const;
+    int passRate() const;       // whole percent
+};
+
+// Streams the candidate's results once, newest first, keeping the latest
+// recentCount rows. Returns the number of exams taken.
+int summarizeHistory(DatabaseManager* db, int userId, HistorySummary& summary,
+                      int recentCount = 10);
+
+#endif
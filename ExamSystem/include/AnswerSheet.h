@@ -0,0 +1,62 @@
+#ifndef ANSWER_SHEET_H
+#define ANSWER_SHEET_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "Question.h"
+
+using namespace std;
+
+// A paper's answers packed for grading. Each question takes a 2-bit lane:
+// the option code (A..D = 0..3) in `codes`, and in `answered` the lane's
+// low bit set if the question has an answer. 32 questions per word.
+class AnswerSheet {
+public:
+    vector<uint64_t> codes;
+    vector<uint64_t> answered;
+    int size;
+
+    AnswerSheet();
+    explicit AnswerSheet(int questionCount);
+
+    // Empties the sheet for questionCount questions, keeping its storage
+    void reset(int questionCount);
+    // Anything but "A".."D" leaves the question unanswered
+    void set(int index, const string& answer);
+    // Option code 0..3 = A..D; anything else leaves the question unanswered
+    void setCode(int index, int code);
+    string get(int index) const;
+    int answeredCount() const;
+
+    static AnswerSheet fromAnswers(const vector<string>& answers);
+    vector<string> toAnswers() const;
+};
+
+// Correct options and marks of a paper, packed the same way
+class AnswerKey {
+public:
+    AnswerSheet options;
+    vector<int> points;
+    int totalPoints;
+    bool uniformPoints;     // every question worth points[0]
+
+    AnswerKey();
+    explicit AnswerKey(const vector<Question>& questions);
+    
+    // Moves each correct option to the slot it was shown in, orders[i] for
+    // question i (see PaperSeed::optionOrders). A sheet answered in the
+    // letters shown then scores through the same kernel, with no per-answer
+    // mapping.
+    void applyOptionOrders(const vector<unsigned char>& orders);
+};
+
+// Number of questions answered correctly
+int countCorrect(const AnswerKey& key, const AnswerSheet& sheet);
+// Marks scored: popcount per word when all questions carry the same
+// points, otherwise the points of each correct lane are summed
+int scoreSheet(const AnswerKey& key, const AnswerSheet& sheet);
+// Bit 2*(i % 32) of word i / 32 set if question i is correct, for item analysis
+void correctLanes(const AnswerKey& key, const AnswerSheet& sheet, vector<uint64_t>& lanes);
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef ASSIGNED_PAPER_H
+#define ASSIGNED_PAPER_H
+
+#include <vector>
+using namespace std;
+
+// A candidate's paper drawn ahead of a sitting, so starting the exam is a
+// primary-key read instead of a draw. Used up when the sitting opens.
+class AssignedPaper {
+public:
+    int userId;
+    int courseId;
+    vector<int> questionIds;    // paper order
+    
+    AssignedPaper();
+};
+
+#endif
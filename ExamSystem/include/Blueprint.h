@@ -0,0 +1,48 @@
+#ifndef BLUEPRINT_H
+#define BLUEPRINT_H
+
+#include <string>
+#include <vector>
+#include "Question.h"
+
+using namespace std;
+
+// One line of a blueprint: count questions of a topic and difficulty.
+// An empty topic or DIFFICULTY_NONE matches any. Also used to report how
+// many questions a course has per topic and difficulty.
+class BlueprintRow {
+public:
+    string topic;
+    int difficulty;
+    int count;
+    
+    BlueprintRow();
+    BlueprintRow(const string& topic, int difficulty, int count);
+    // Topics compare case-insensitively
+    bool matches(const string& questionTopic, int questionDifficulty) const;
+    string toString() const;
+};
+
+// The make-up of every paper of a course, e.g. "10 easy SQL, 5 hard
+// normalization". No rows = papers are drawn from the whole pool.
+class Blueprint {
+public:
+    vector<BlueprintRow> rows;
+    
+    int totalQuestions() const;
+    string toString() const;
+    
+    // Comma-separated "<count> [easy|medium|hard|any] [topic]". False with
+    // a message in error if an entry doesn't read that way.
+    static bool parse(const string& text, Blueprint& blueprint, string& error);
+    
+    // False with the first short row in problem if the course's strata
+    // (see DatabaseManager::getStrata) can't supply a row. Rows are checked
+    // one at a time; overlapping rows share their questions at draw time.
+    bool fits(const vector<BlueprintRow>& strata, string& problem) const;
+};
+
+// Lower-cased topic, for matching
+string topicKey(const string& topic);
+
+#endif
@@ -4,6 +4,12 @@
 #include <string>
 using namespace std;
 
+// How papers of the course are drawn from its question pool
+enum SelectionMode {
+    SELECT_UNIFORM = 0,     // every question equally likely
+    SELECT_BALANCED = 1     // favour questions shown less often so far
+};
+
 class Course {
 public:
     int id;
@@ -13,6 +19,7 @@ public:
     int questionsPerExam;
     int passingMark;
     int totalQuestions;
+    SelectionMode selectionMode;
     
     Course();
 };
@@ -3,17 +3,24 @@
 
 #include <FL/Fl_Window.H>
 #include <FL/Fl_Hold_Browser.H>
+#include <FL/Fl_Button.H>
 #include <vector>
+#include <string>
 #include "Course.h"
 
 class CourseSelectionWindow {
 private:
     Fl_Window* window;
     Fl_Hold_Browser* courseBrowser;
+    Fl_Button* continueBtn;
+    Fl_Button* logoutBtn;
     vector<Course> availableCourses;
     
     static void continueCallback(Fl_Widget* w, void* data);
     static void logoutCallback(Fl_Widget* w, void* data);
+    static void coursesLoaded(void* data);
+    // Fills the browser from availableCourses; error is why there are none
+    void listCourses(const string& error);
     
 public:
     CourseSelectionWindow();
@@ -3,35 +3,112 @@
 
 #include <string>
 #include <vector>
+#include <map>
 #include <sqlite3.h>
 #include "User.h"
 #include "Course.h"
 #include "Question.h"
 #include "Result.h"
+#include "ResultQuery.h"
+#include "ExamSession.h"
+#include "ResultPaper.h"
+#include "AssignedPaper.h"
+#include "SeatPaper.h"
+#include "PaperSeed.h"
+#include "Blueprint.h"
+#include "StorageProfile.h"
 
 using namespace std;
 
+class StatementCache;
+class QuestionSampler;
+
+// Summary of a bulk question import
+struct ImportStats {
+    int inserted;
+    int failed;
+    double seconds;
+    double rowsPerSecond;
+    
+    ImportStats() : inserted(0), failed(0), seconds(0), rowsPerSecond(0) {}
+};
+
+// How often a course's questions have been shown, over all sittings opened
+struct ExposureStats {
+    int questions;
+    int neverShown;
+    int minExposure;
+    int maxExposure;
+    double meanExposure;
+    
+    ExposureStats() : questions(0), neverShown(0), minExposure(0), maxExposure(0),
+                      meanExposure(0) {}
+};
+
 class DatabaseManager {
 private:
     sqlite3* db;
+    StatementCache* stmtCache;
+    QuestionSampler* sampler;
     string dbPath;
+    StorageProfile storageProfile;
+    string lastError;
+    bool ready;
+    // Pool snapshots read so far, by course id << 32 | version
+    map<long long, vector<int> > poolSnapshots;
+    
+    bool execCached(const char* sql);
+    int stepWrite(sqlite3_stmt* stmt);
+    bool insertQuestion(const Question& q);
+    bool getQuestionById(int questionId, Question& q);
+    const vector<int>* loadPoolSnapshot(int courseId, int version);
+    // Stores a snapshot if it isn't there yet; a new one also deletes the
+    // course's older snapshots that no sitting or result refers to
+    bool savePoolSnapshot(int courseId, int version, const vector<int>& ids);
+    // Puts back the snapshot of a paper about to be stored, in case it was
+    // pruned after the paper was drawn from this connection's cached copy
+    bool keepPoolSnapshot(int courseId, int version);
+    // saveSessionProgress(); 1 if written, 0 if the sitting is no longer
+    // open (nothing is written) or -1
+    int writeSessionProgress(int sessionId, const vector<SessionAnswer>& changes,
+                             int currentIndex, int timeRemaining, int timeSpent);
     
 public:
-    DatabaseManager(string path = "database/exam_system.db");
+    DatabaseManager(string path = "database/exam_system.db",
+                    StorageProfile profile = StorageProfile::examHall());
     ~DatabaseManager();
     
     bool initDatabase();
-    void createTables();
+    bool createTables();
+    bool upgradeSchema();
+    int getSchemaVersion();
     void insertDefaultData();
+    bool isReady();
+    string getLastError();
+    string getDatabasePath();
+    const StorageProfile& getStorageProfile();
+    // EXPLAIN QUERY PLAN output, one step per line
+    string explainQueryPlan(const string& sql);
+    
+    // Transactions
+    bool beginTransaction();
+    bool commitTransaction();
+    void rollbackTransaction();
+    StatementCache* getStatementCache();
     
     // User management
     bool addUser(string username, string password, string role);
     User* authenticateUser(string username, string password);
+    int getUserIdByUsername(string username);
+    // Ids of every user with the role, in id order
+    vector<int> getUserIdsByRole(const string& role);
     void incrementLoginAttempts(string username);
     void resetLoginAttempts(string username);
     
     // Course management
-    bool addCourse(string code, string title, int time, int questionsCount, int passing);
+    bool addCourse(string code, string title, int time, int questionsCount, int passing,
+                   SelectionMode mode = SELECT_UNIFORM);
+    bool setSelectionMode(int courseId, SelectionMode mode);
     vector<Course> getAllCourses();
     Course* getCourseById(int courseId);
     int getCourseIdByCode(string code);
@@ -39,11 +116,103 @@ public:
     // Question management
     bool addQuestion(int courseId, string qText, string optA, string optB,
                     string optC, string optD, string correct, int pts);
-    vector<Question> getRandomQuestions(int courseId, int count);
+    // Inserts in chunked transactions through one reused statement; returns rows inserted
+    int addQuestions(const vector<Question>& questions, ImportStats* stats = NULL,
+                     int chunkSize = 1000);
+    // Balanced draws favour the questions shown least (see QuestionSampler);
+    // either way the paper has to be stored as a list, not a seed
+    vector<Question> getRandomQuestions(int courseId, int count,
+                                        SelectionMode mode = SELECT_UNIFORM);
+    // Just the ids of a random paper, drawn from this connection's pool
+    vector<int> sampleQuestionIds(int courseId, int count, SelectionMode mode = SELECT_UNIFORM);
+    // Bumped by every question added to, removed from or moved out of the course
+    int getPoolVersion(int courseId);
+    // The seeded paper's question ids, drawn from the snapshot of the course's
+    // pool at paper.poolVersion (0 = the current pool, and paper.poolVersion is
+    // set to it). Sets paper.questionCount to the ids drawn. False if that
+    // version's snapshot was never taken.
+    bool getPaperQuestionIds(int courseId, PaperSeed& paper, vector<int>& ids);
+    // A seeded paper of count questions; the same paper always comes back
+    // for the same seed and pool version
+    vector<Question> getRandomQuestions(int courseId, int count, PaperSeed& paper);
+    vector<Question> getQuestionsByIds(const vector<int>& ids);
+    // id, correctAnswer and points of every question of the course
+    vector<Question> getCourseAnswerKey(int courseId);
+    bool updateCorrectAnswer(int questionId, const string& correctAnswer);
+    ExposureStats getExposureStats(int courseId);
+    
+    // Blueprints. Setting one also sets the course's questionsPerExam to its
+    // total; an empty one removes it. Joins the caller's transaction.
+    bool setBlueprint(int courseId, const Blueprint& blueprint);
+    Blueprint getBlueprint(int courseId);
+    // Questions per topic and difficulty, as rows with their counts
+    vector<BlueprintRow> getStrata(int courseId);
+    // id, topic and difficulty of every question of the course
+    vector<Question> getQuestionStrata(int courseId);
+    // A paper made up as the blueprint says (see QuestionSampler). False if
+    // the course can no longer supply a row; what could be drawn is returned.
+    bool sampleBlueprintIds(int courseId, const Blueprint& blueprint, vector<int>& ids);
+    bool getBlueprintQuestions(int courseId, const Blueprint& blueprint,
+                               vector<Question>& questions);
     
     // Result management
     int saveResult(Result r);
-    vector<Result> getResults(int userId = -1);
+    // Submission: the result, its paper, the last unsaved answers and the
+    // session close in one transaction, or in the caller's if one is open
+    // (see SubmissionQueue). sessionId 0 = no session; a paper without
+    // questions is not stored. Returns the result id, 0 if the sitting was
+    // no longer open (already submitted; nothing is written) or -1.
+    int submitResult(const Result& r, const ResultPaper& paper, int sessionId,
+                     const vector<SessionAnswer>& finalChanges);
+    bool saveResultPaper(int resultId, const ResultPaper& paper);
+    // Number of stored papers of the course and their first and last result ids
+    int getResultPaperRange(int courseId, int& firstResultId, int& lastResultId);
+    // Up to limit papers with afterResultId < result_id <= lastResultId, in id order.
+    // A paper that can't be rebuilt or whose answers are corrupt comes back
+    // with no questionIds and must not be graded.
+    int loadResultPapers(int courseId, int afterResultId, int lastResultId, int limit,
+                         vector<ResultPaper>& papers);
+    // Writes score, totalPoints, percentage and passed by result id, in one
+    // transaction unless the caller has one open. Returns rows changed or -1.
+    int updateResultScores(const vector<Result>& results);
+    
+    // Papers drawn ahead of a sitting (see pregeneratePapers). Saving joins
+    // the caller's transaction if there is one; returns papers saved or -1.
+    int saveAssignedPapers(const vector<AssignedPaper>& papers);
+    bool findAssignedPaper(int userId, int courseId, AssignedPaper& paper);
+    bool deleteAssignedPaper(int userId, int courseId);
+    int countAssignedPapers(int courseId);
+    
+    // Papers planned per seat of a hall (see planSeating). Saving replaces
+    // the course's whole plan and joins the caller's transaction if there
+    // is one; returns papers saved or -1.
+    int saveSeatPapers(int courseId, const vector<SeatPaper>& papers);
+    bool findSeatPaper(int courseId, const Seat& seat, SeatPaper& paper);
+    bool deleteSeatPaper(int courseId, const Seat& seat);
+    int countSeatPapers(int courseId);
+    
+    // Streams up to query.pageSize matching rows to the callback in the
+    // query's sort order and moves its cursor past the last row delivered.
+    // Returns the number of rows streamed; fewer than pageSize means done.
+    int streamResults(ResultQuery& query, ResultCallback callback, void* data);
+    // Rows matching the query's filters, ignoring its cursor
+    int countResults(const ResultQuery& query);
+    
+    // Exam sessions (autosave of a sitting in progress)
+    // Records a new open sitting and sets session.id; each question on the
+    // paper is counted as shown once more. Joins the caller's transaction.
+    bool openExamSession(ExamSession& session);
+    // Writes only the answers that changed plus the clock, in one transaction.
+    // false, writing nothing, if the sitting has been closed
+    bool saveSessionProgress(int sessionId, const vector<SessionAnswer>& changes,
+                             int currentIndex, int timeRemaining, int timeSpent);
+    // Latest open sitting of the user for the course, with its saved answers
+    bool findOpenExamSession(int userId, int courseId, ExamSession& session);
+    // Sittings of the user for the course so far, open or closed
+    int countExamSessions(int userId, int courseId);
+    // status is "submitted", or "abandoned" for a sitting that can't be resumed.
+    // Only an open sitting is changed; sqlite3_changes() tells whether it was
+    bool closeExamSession(int sessionId, const string& status = "submitted");
 };
 
 #endif
\ No newline at end of file
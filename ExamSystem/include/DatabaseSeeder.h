@@ -0,0 +1,47 @@
+#ifndef DATABASE_SEEDER_H
+#define DATABASE_SEEDER_H
+
+#include <string>
+#include "DatabaseManager.h"
+
+using namespace std;
+
+// Shape of a synthetic database. The same spec and seed always produce the
+// same rows, so benchmarks run against comparable data.
+class SeedSpec {
+public:
+    int courses;
+    int questionsPerCourse;
+    int topics;                 // questions cycle through "topic1".."topicN" and
+                                // easy/medium/hard; 0 = no topic or difficulty
+    int users;                  // candidates "seed000001"... all with SEED_PASSWORD
+    int results;                // past sittings spread over the users and courses,
+                                // scored from randomly answered papers
+    int historyDays;            // results are dated over this many days
+    unsigned int seed;
+    string codePrefix;          // course codes are prefix + number, e.g. SEED001
+    bool papers;                // store each result's paper, so it can be re-graded
+
+    SeedSpec();
+};
+
+struct SeedStats {
+    int courses;
+    int questions;
+    int users;
+    int results;
+    double seconds;
+
+    SeedStats() : courses(0), questions(0), users(0), results(0), seconds(0) {}
+};
+
+extern const char* SEED_PASSWORD;
+
+string seedUsername(int index);
+string seedCourseCode(const SeedSpec& spec, int index);
+
+// Writes the spec's rows in large transactions. Best on a fresh database
+// opened with StorageProfile::bulkImport(). Returns false on any failed write.
+bool seedDatabase(DatabaseManager* db, const SeedSpec& spec, SeedStats* stats = NULL);
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef DB_WORKER_H
+#define DB_WORKER_H
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include "DatabaseManager.h"
+
+using namespace std;
+
+// Runs on the worker thread against the worker's own connection (NULL
+// when the worker was created without a database path)
+typedef void (*DbJob)(DatabaseManager* db, void* data);
+// Runs on the FLTK thread after the job has finished
+typedef void (*DbDone)(void* data);
+
+/**
+ * Background thread for slow database work. It owns a second connection to
+ * the exam database (WAL lets the UI connection keep reading meanwhile) and
+ * runs posted jobs one at a time, in order. Each job's completion callback
+ * is handed back to the event loop through Fl::awake, so windows and the
+ * exam countdown stay live while the job runs.
+ *
+ * Requires Fl::lock() to have been called once on the UI thread.
+ */
+class DbWorker {
+private:
+    struct Request {
+        DbJob job;
+        DbDone done;
+        void* data;
+    };
+    
+    DatabaseManager* db;
+    deque<Request> queue;
+    mutex queueLock;
+    condition_variable queueReady;
+    bool stopping;
+    int busy;
+    thread worker;
+    
+    void run();
+    
+public:
+    // An empty path gives a plain background thread with no connection
+    DbWorker(const string& path, const StorageProfile& profile);
+    // Finishes the jobs already queued, then joins the thread
+    ~DbWorker();
+    
+    bool isReady();
+    string getLastError();
+    
+    void post(DbJob job, DbDone done, void* data);
+    // Queued plus running jobs
+    int pending();
+    
+    // Schedules a callback on the UI thread; jobs use it to report progress.
+    // Callbacks are delivered in order, and before the job's own done.
+    static void notify(DbDone callback, void* data);
+};
+
+#endif
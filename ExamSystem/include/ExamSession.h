@@ -0,0 +1,36 @@
+#ifndef EXAM_SESSION_H
+#define EXAM_SESSION_H
+
+#include <string>
+#include <vector>
+#include "PaperSeed.h"
+using namespace std;
+
+// One answer as stored in session_answers; position is the index into the paper
+class SessionAnswer {
+public:
+    int position;
+    string answer;
+    
+    SessionAnswer();
+    SessionAnswer(int position, const string& answer);
+};
+
+// An exam sitting in progress, as persisted by the autosave
+class ExamSession {
+public:
+    int id;
+    int userId;
+    int courseId;
+    vector<int> questionIds;    // paper order
+    vector<string> answers;     // one per question, "" = unanswered
+    int currentIndex;
+    int timeRemaining;
+    int timeSpent;
+    long long startedAt;        // when the sitting was opened, seconds since the epoch
+    PaperSeed seed;             // seeded papers store this instead of questionIds
+    
+    ExamSession();
+};
+
+#endif
@@ -10,6 +10,7 @@
 #include <FL/Fl_Group.H>
 #include <vector>
 #include "Question.h"
+#include "ExamSession.h"
 
 class ExamWindow {
 private:
@@ -19,6 +20,16 @@ private:
     int currentQuestionIndex;
     int timeRemaining;
     int timeSpent;
+    bool submitting;
+    
+    // Autosave state: the answers as last persisted to the session
+    int sessionId;
+    PaperSeed paperSeed;
+    // Per question, the order its options are shown in (one byte of 24 states)
+    vector<unsigned char> optionOrders;
+    vector<string> savedAnswers;
+    bool autosaving;
+    int clockSavedAt;
     
     Fl_Box* timerBox;
     Fl_Box* questionNumberBox;
@@ -38,11 +49,16 @@ private:
     void updateTimer();
     void displayQuestion();
     void saveCurrentAnswer();
+    void autosave();
+    vector<SessionAnswer> changedAnswers();
     
     static void prevCallback(Fl_Widget* w, void* data);
     static void nextCallback(Fl_Widget* w, void* data);
     static void submitCallback(Fl_Widget* w, void* data);
     void submitExam();
+    static void paperDrawn(void* data);
+    static void resultSaved(void* data);
+    static void autosaved(void* data);
     
     static int eventHandler(int event);
     
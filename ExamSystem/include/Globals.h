@@ -2,6 +2,8 @@
 #define GLOBALS_H
 
 #include "DatabaseManager.h"
+#include "DbWorker.h"
+#include "HallClient.h"
 #include "User.h"
 #include "Course.h"
 
@@ -14,8 +16,11 @@ void showExamWindow();
 void showResultWindow(Result result);
 
 // Global variables
-extern DatabaseManager* dbManager;
+extern DatabaseManager* dbManager;  // NULL on a terminal of a hall server
+extern HallClient* hallClient;      // from --server; NULL = use the database directly
+extern DbWorker* dbWorker;          // slow queries go here, off the UI thread
 extern User* currentUser;
 extern Course* selectedCourse;
+extern Seat terminalSeat;           // from --seat; row 0 = not in a planned hall
 
 #endif
\ No newline at end of file
@@ -0,0 +1,28 @@
+#ifndef GRADER_H
+#define GRADER_H
+
+#include <string>
+#include <vector>
+#include "Question.h"
+#include "User.h"
+#include "Course.h"
+#include "Result.h"
+#include "AnswerSheet.h"
+#include "PaperSeed.h"
+
+using namespace std;
+
+// Scores a finished paper. answers[i] is the candidate's choice for
+// questions[i] in the letters shown (see PaperSeed::optionOrders), "" if
+// unanswered. Fills every Result field except id and dateTime, which the
+// database assigns.
+Result gradeExam(const vector<Question>& questions, const vector<string>& answers,
+                 const User& candidate, const Course& course, int timeSpent,
+                 const PaperSeed& seed = PaperSeed());
+
+// The same on an already packed key and sheet, for grading many sheets
+// against one paper
+Result gradeExam(const AnswerKey& key, const AnswerSheet& sheet,
+                 const User& candidate, const Course& course, int timeSpent);
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef HALL_CLIENT_H
+#define HALL_CLIENT_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include "User.h"
+#include "Course.h"
+#include "Question.h"
+#include "Result.h"
+#include "ExamSession.h"
+#include "SeatPaper.h"
+#include "PaperGenerator.h"
+
+using namespace std;
+
+/**
+ * A thin terminal's connection to the hall server (see HallServer). It
+ * stands in for the database in the candidate's path: login, course list,
+ * starting a paper, saving answers and submitting are each one request and
+ * one reply. Questions come without their correct answers; the server
+ * grades the submission and returns the result.
+ *
+ * Calls block, so the GUI makes them from its DbWorker thread. A dropped
+ * connection is reopened, and signed in again with the session token from
+ * the login, once per call, but only if the request had not been sent yet:
+ * a lost submit reply is reported, not retried. If the server no longer
+ * accepts the token the terminal is signed out and the call fails.
+ */
+class HallClient {
+private:
+    string address;
+    int fd;
+    string username;
+    string sessionToken;        // from the login, to sign in again after a reconnect
+    int userId;
+    string lastError;
+    mutex callLock;
+
+    bool open();
+    void closeSocket();
+    bool sendFrame(const vector<unsigned char>& frame);
+    bool readFrame(vector<unsigned char>& frame);
+    bool exchange(const vector<unsigned char>& request, vector<unsigned char>& reply);
+    // Sends request and reads its reply; false (with lastError set) if the
+    // server could not be reached, leaving reply empty, or answered
+    // HALL_ERROR or HALL_CLOSED
+    bool call(const vector<unsigned char>& request, vector<unsigned char>& reply);
+    // Signs a new connection in with sessionToken. false if the server
+    // refused it; if the connection drops instead it is closed for a retry
+    bool resume();
+
+public:
+    HallClient();
+    ~HallClient();
+
+    // A Unix socket path, or host:port (":port" for this machine) for TCP
+    bool connect(const string& serverAddress);
+    string getLastError();
+
+    User* login(const string& user, const string& pass);
+    vector<Course> getCourses();
+    // As preparePaper(), for the course's own length, time and mode
+    PaperSource startPaper(int courseId, const Seat& seat, vector<Question>& questions,
+                           ExamSession& session);
+    bool saveSessionProgress(int sessionId, int courseId, const vector<SessionAnswer>& changes,
+                             int currentIndex, int timeRemaining, int timeSpent);
+    // The result id, 0 if the sitting had already been submitted, or -1;
+    // result is filled in as graded by the server
+    int submitResult(int sessionId, int courseId, const vector<string>& answers,
+                     const vector<SessionAnswer>& finalChanges, int timeSpent, Result& result);
+};
+
+#endif
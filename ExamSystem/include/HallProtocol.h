@@ -0,0 +1,100 @@
+#ifndef HALL_PROTOCOL_H
+#define HALL_PROTOCOL_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+using namespace std;
+
+/**
+ * Wire format between exam terminals and the hall server (see HallServer,
+ * HallClient). Every message is a frame:
+ *
+ *   u32 length of what follows, u8 message type, fields
+ *
+ * Integers are little-endian, strings are a u32 byte count and the bytes,
+ * lists a u32 count and the items, and an answer is one byte: 0 for none
+ * or 'A'..'D'. A terminal sends one request and waits for its reply, which
+ * is HALL_OK followed by the fields listed here, or HALL_ERROR and a message.
+ * HALL_SAVE_PROGRESS and HALL_SUBMIT for a sitting that has been submitted
+ * (perhaps by this terminal, its reply lost) get HALL_CLOSED and a message.
+ */
+enum HallMessage {
+    // username, password -> user id, username, role, session token. The token
+    //    signs the terminal in again after a reconnect (HALL_RESUME); the
+    //    candidate's next login replaces it.
+    HALL_LOGIN = 1,
+    // -> courses: id, code, title, time, questions per exam, pass mark,
+    //    question count, selection mode
+    HALL_COURSES = 2,
+    // course id, seat row, seat column -> paper source, session id, answers,
+    //    current index, time remaining, time spent, seed (pool version, value,
+    //    question count, shuffled options), questions: id, text, options A..D,
+    //    points. Correct answers stay on the server.
+    HALL_START_PAPER = 3,
+    // session id, course id, changes: position and answer, current index,
+    //    time remaining, time spent ->
+    HALL_SAVE_PROGRESS = 4,
+    // session id, course id, time spent, answers, final changes -> result id,
+    //    score, total questions, total points, percentage (as IEEE double
+    //    bits), passed, course code, course title
+    HALL_SUBMIT = 5,
+    // session token -> user id, username, role
+    HALL_RESUME = 6,
+
+    HALL_OK = 100,
+    HALL_ERROR = 101,
+    HALL_CLOSED = 102
+};
+
+// Frames larger than this are refused; a 100-question paper is ~40 KB
+static const uint32_t HALL_MAX_FRAME = 1 << 20;
+// Bytes before the type: the length field
+static const size_t HALL_FRAME_HEADER = 4;
+
+// Builds one frame
+class MessageWriter {
+public:
+    vector<unsigned char> bytes;
+
+    explicit MessageWriter(int type);
+    void putU8(int value);
+    void putInt(int value);
+    void putU64(uint64_t value);
+    void putDouble(double value);
+    void putString(const string& value);
+    void putAnswer(const string& answer);
+    // Fills in the length; call once, after the last field
+    const vector<unsigned char>& finish();
+};
+
+// Reads the fields of one frame (without its length). Reading past the
+// end or a malformed field clears ok and returns zero values from then on.
+class MessageReader {
+private:
+    const unsigned char* data;
+    size_t size;
+    size_t pos;
+
+public:
+    bool ok;
+    int type;
+
+    MessageReader(const unsigned char* frame, size_t frameSize);
+    int getU8();
+    int getInt();
+    uint64_t getU64();
+    double getDouble();
+    string getString();
+    string getAnswer();
+    // Count of a list that follows, each item at least minItemBytes long;
+    // 0 and not ok if the frame can't hold that many
+    int getCount(size_t minItemBytes);
+    bool atEnd() const;
+};
+
+// Length field of a frame starting at header (HALL_FRAME_HEADER bytes)
+uint32_t hallFrameLength(const unsigned char* header);
+
+#endif
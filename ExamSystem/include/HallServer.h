@@ -0,0 +1,148 @@
+#ifndef HALL_SERVER_H
+#define HALL_SERVER_H
+
+#include <map>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include "DatabaseManager.h"
+#include "SubmissionQueue.h"
+
+using namespace std;
+
+class Poller;
+
+// Requests served so far
+struct HallServerStats {
+    long long connections;      // accepted
+    long long requests;
+    long long errors;           // answered with HALL_ERROR
+    long long saves;            // answer saves
+
+    HallServerStats() : connections(0), requests(0), errors(0), saves(0) {}
+};
+
+/**
+ * The one process that owns the exam database in a hall of thin terminals
+ * (see HallClient). Terminals connect over a Unix domain socket or loopback
+ * TCP and send HallProtocol requests: login, course list, start or resume a
+ * paper, save answers, submit.
+ *
+ * run() is an event loop on epoll (poll() where there is no epoll) that
+ * only moves bytes: it reads frames and writes replies on non-blocking
+ * sockets. Requests are handled by a pool of worker threads, each with its
+ * own connection to the database; submissions go on through one
+ * SubmissionQueue, so a time-up storm commits in groups. A terminal's
+ * requests are handled one at a time, in the order sent.
+ *
+ * A terminal may only save or submit a sitting of the user it logged in as;
+ * the paper's correct answers never leave the server, which grades the
+ * submission itself. Admins can't log in through it. A terminal that
+ * reconnects signs in again with the token from its login, not the
+ * password. Time left and time spent are the terminal's figures capped by
+ * the server's own clock.
+ */
+class HallServer {
+private:
+    // What the server knows about a terminal between its requests
+    struct TerminalState {
+        int userId;             // 0 = not logged in
+        string username;
+        int sessionId;          // sitting already checked to be the user's
+        long long startedAt;    // ...when the server opened it
+        int timeAllowed;        // ...and the course's allocation, in seconds
+        int questionCount;      // ...and the length of its paper
+    };
+
+    struct Terminal {
+        int fd;
+        vector<unsigned char> in;
+        vector<unsigned char> out;
+        size_t outSent;
+        deque<vector<unsigned char> > requests;     // frames waiting their turn
+        bool busy;                                  // a request is with a worker
+        bool writing;                               // waiting for the socket to drain
+        TerminalState state;
+    };
+
+    struct Job {
+        long long terminalId;
+        vector<unsigned char> request;
+        TerminalState state;
+        vector<unsigned char> reply;
+        bool failed;
+    };
+
+    string dbPath;
+    StorageProfile profile;
+    int workerCount;
+    SubmissionQueue* submissions;
+    vector<int> listeners;
+    string unixPath;
+    int wakeRead;
+    int wakeWrite;
+    string lastError;
+
+    Poller* poller;                 // run()'s, while it runs
+    map<long long, Terminal*> terminals;
+    map<int, long long> terminalByFd;
+    long long nextTerminalId;
+
+    mutex jobLock;
+    condition_variable jobReady;
+    deque<Job*> jobs;
+    deque<Job*> replies;
+    bool stopping;
+    vector<thread> workers;
+    atomic<bool> stopRequested;
+
+    mutex statsLock;
+    HallServerStats totals;
+
+    // Session tokens handed out at login, one per candidate
+    struct SignedIn {
+        int userId;
+        string username;
+    };
+    mutex tokenLock;
+    map<string, SignedIn> signedIn;     // by token
+    map<int, string> tokenByUser;
+
+    string issueToken(int userId, const string& username);
+
+    bool addListener(int fd);
+    void workerLoop();
+    // false when the reply comes later, from the SubmissionQueue
+    bool handle(DatabaseManager* db, Job* job);
+    void complete(Job* job);
+    static void submitted(int resultId, void* data);
+    void acceptTerminals(int listener);
+    void dispatch(long long terminalId, Terminal* terminal);
+    void closeTerminal(long long terminalId);
+    void readTerminal(long long terminalId, Terminal* terminal);
+    bool flushTerminal(Terminal* terminal);
+    void deliverReplies();
+
+public:
+    HallServer(const string& path, const StorageProfile& storage, int workers = 0);
+    // Stops the workers and closes every socket
+    ~HallServer();
+
+    // Each may be called once before run(); both may be used together
+    bool listenUnix(const string& socketPath);
+    bool listenTcp(int port);           // 127.0.0.1 only
+
+    bool isReady();
+    string getLastError();
+
+    // Serves terminals until stop()
+    bool run();
+    // From any thread, or a signal handler
+    void stop();
+    HallServerStats getStats();
+};
+
+#endif
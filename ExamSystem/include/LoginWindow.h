@@ -4,14 +4,17 @@
 #include <FL/Fl_Window.H>
 #include <FL/Fl_Input.H>
 #include <FL/Fl_Secret_Input.H>
+#include <FL/Fl_Button.H>
 
 class LoginWindow {
 private:
     Fl_Window* window;
     Fl_Input* userIdInput;
     Fl_Secret_Input* passwordInput;
+    Fl_Button* loginBtn;
     
     static void loginCallback(Fl_Widget* w, void* data);
+    static void loginDone(void* data);
     static void exitCallback(Fl_Widget* w, void* data);
     
 public:
@@ -0,0 +1,67 @@
+#ifndef PAPER_GENERATOR_H
+#define PAPER_GENERATOR_H
+
+#include <vector>
+#include "DatabaseManager.h"
+
+using namespace std;
+
+enum PaperSource {
+    PAPER_NONE,         // the course has no questions
+    PAPER_NEW,          // freshly drawn, new session opened
+    PAPER_ASSIGNED,     // the seat's or candidate's pre-generated paper, new session opened
+    PAPER_RESUMED       // an open session was picked up where it was saved
+};
+
+/**
+ * Prepares the paper for one sitting. If the candidate left a sitting for
+ * this course open (the program died mid-exam) the same questions come back
+ * with the saved answers, position and clock in session. Otherwise the
+ * paper planned for the candidate's seat (see planSeating), or else their
+ * own pre-generated paper, is used if there is one of `count` questions,
+ * or a new paper is drawn, and a session opened for it with
+ * timeAllocation seconds on the clock. A course with a blueprint gets a
+ * paper made up as it says. Otherwise uniform draws are seeded: session.seed
+ * is set, so pass it on with the result and the paper isn't stored as a
+ * list. Blueprint and balanced draws can't be rebuilt from a seed and the
+ * pool snapshot, so they are stored as a list. Either way every new paper
+ * shows each question's options in an order derived from session.seed.value
+ * (see PaperSeed::optionOrders); answers are kept as the letters shown.
+ *
+ * session.id is 0 if no session could be recorded; the exam can still be
+ * taken, just without autosave.
+ */
+PaperSource preparePaper(DatabaseManager* db, int userId, int courseId, int count,
+                         int timeAllocation, vector<Question>& questions,
+                         ExamSession& session, SelectionMode mode = SELECT_UNIFORM,
+                         const Seat& seat = Seat());
+
+// Summary of a pre-generation run
+struct PregenStats {
+    int papers;
+    int threads;
+    double seconds;
+    double papersPerSecond;
+    
+    PregenStats() : papers(0), threads(0), seconds(0), papersPerSecond(0) {}
+};
+
+// Called on the calling thread after each chunk of papers is stored
+typedef void (*PregenProgress)(int done, int total, void* data);
+
+/**
+ * Draws every listed candidate's paper for the course ahead of a sitting
+ * and stores it, so the start of the exam only reads it back by key instead
+ * of the whole hall drawing at once. Papers are drawn by `threads` threads
+ * (0 = one per core, fewer for small halls), each on its own connection with
+ * its own question pool, following the course's blueprint or selection
+ * mode; db stores them in chunked transactions.
+ * A candidate who already had a paper for the course gets a new one.
+ * Returns false if the course doesn't exist or has no questions, or a
+ * write failed.
+ */
+bool pregeneratePapers(DatabaseManager* db, int courseId, const vector<int>& userIds,
+                       PregenStats* stats = NULL, int threads = 0,
+                       PregenProgress progress = NULL, void* progressData = NULL);
+
+#endif
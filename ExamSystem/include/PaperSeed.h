@@ -0,0 +1,45 @@
+#ifndef PAPER_SEED_H
+#define PAPER_SEED_H
+
+#include <vector>
+#include <stdint.h>
+using namespace std;
+
+// Everything needed to rebuild a paper: which snapshot of the course's
+// question pool it was drawn from, the seed of the draw and its length.
+// Stored instead of the question list; poolVersion 0 = not a seeded paper.
+// A paper stored as a list may still carry a seed for its option orders.
+class PaperSeed {
+public:
+    int poolVersion;
+    uint64_t value;
+    int questionCount;
+    bool shuffledOptions;   // options shown in orders derived from value
+    
+    PaperSeed();
+    PaperSeed(int poolVersion, uint64_t value, int questionCount);
+    bool isSeeded() const;
+    // Option order of each of the first count questions, 0 for all of
+    // them unless shuffledOptions
+    vector<unsigned char> optionOrders(int count) const;
+};
+
+// A question's options can be shown in any of the 4! orders of A..D;
+// order 0 shows them as stored. Answers are kept as the letters shown.
+static const int OPTION_ORDERS = 24;
+// Stored option (0..3 = A..D) shown in display slot `slot` under order
+int storedOption(int order, int slot);
+// Display slot showing stored option `option` under order; -1 if the
+// option isn't 0..3
+int displaySlot(int order, int option);
+
+// Seed of a candidate's paper for a course; sitting numbers their attempts
+uint64_t paperSeedFor(int userId, int courseId, int sitting);
+
+// The first count questions of a seeded Fisher-Yates shuffle of the pool.
+// Uses its own generator and bounded draws rather than <random>
+// distributions, so the same seed gives the same paper on every platform
+// and library version. The pool is not modified.
+vector<int> drawSeededPaper(const vector<int>& pool, int count, uint64_t seed);
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef QUERY_STATS_H
+#define QUERY_STATS_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+
+using namespace std;
+
+// Per-call timing of the DatabaseManager public API. Built in when
+// EXAM_QUERY_STATS is defined (make QUERY_STATS=1, the default); otherwise
+// QUERY_TIMER and QUERY_ROWS expand to nothing and no call is timed.
+//
+// Each thread counts into its own buckets, so recording takes no lock and
+// never contends with other connections; readers sum the buckets.
+
+enum QueryOp {
+    QOP_ADD_USER,
+    QOP_AUTHENTICATE_USER,
+    QOP_GET_USER_ID,
+    QOP_USERS_BY_ROLE,
+    QOP_LOGIN_ATTEMPTS,
+    QOP_ADD_COURSE,
+    QOP_SET_SELECTION_MODE,
+    QOP_GET_ALL_COURSES,
+    QOP_GET_COURSE,
+    QOP_GET_COURSE_ID,
+    QOP_ADD_QUESTION,
+    QOP_ADD_QUESTIONS,
+    QOP_GET_RANDOM_QUESTIONS,
+    QOP_SAMPLE_QUESTION_IDS,
+    QOP_PAPER_QUESTION_IDS,
+    QOP_GET_SEEDED_QUESTIONS,
+    QOP_POOL_VERSION,
+    QOP_GET_QUESTIONS_BY_IDS,
+    QOP_ANSWER_KEY,
+    QOP_UPDATE_ANSWER_KEY,
+    QOP_EXPOSURE_STATS,
+    QOP_SET_BLUEPRINT,
+    QOP_GET_BLUEPRINT,
+    QOP_GET_STRATA,
+    QOP_QUESTION_STRATA,
+    QOP_SAMPLE_BLUEPRINT_IDS,
+    QOP_BLUEPRINT_QUESTIONS,
+    QOP_SAVE_RESULT,
+    QOP_SUBMIT_RESULT,
+    QOP_STREAM_RESULTS,
+    QOP_COUNT_RESULTS,
+    QOP_SAVE_RESULT_PAPER,
+    QOP_RESULT_PAPER_RANGE,
+    QOP_RESULT_PAPERS,
+    QOP_UPDATE_SCORES,
+    QOP_SAVE_ASSIGNED_PAPERS,
+    QOP_FIND_ASSIGNED_PAPER,
+    QOP_DELETE_ASSIGNED_PAPER,
+    QOP_COUNT_ASSIGNED_PAPERS,
+    QOP_SAVE_SEAT_PAPERS,
+    QOP_FIND_SEAT_PAPER,
+    QOP_DELETE_SEAT_PAPER,
+    QOP_COUNT_SEAT_PAPERS,
+    QOP_OPEN_SESSION,
+    QOP_SAVE_SESSION,
+    QOP_FIND_SESSION,
+    QOP_COUNT_SESSIONS,
+    QOP_CLOSE_SESSION,
+    QOP_BEGIN,
+    QOP_COMMIT,
+    QOP_ROLLBACK,
+    QUERY_OP_COUNT
+};
+
+// Latency buckets: 0 is under 1 us, bucket b holds [2^(b-1), 2^b) us,
+// the last one everything from about 16 s up
+static const int QUERY_BUCKETS = 26;
+
+// Totals for one operation across all threads
+class QuerySummary {
+public:
+    const char* name;
+    unsigned long long calls;
+    unsigned long long rows;
+    unsigned long long totalMicros;
+    unsigned long long maxMicros;
+    unsigned long long buckets[QUERY_BUCKETS];
+
+    QuerySummary();
+    double averageMs() const;
+    // Upper edge of the bucket holding the p-th call (p in 0..1)
+    double percentileMs(double p) const;
+};
+
+const char* queryOpName(QueryOp op);
+void recordQuery(QueryOp op, unsigned long long micros, unsigned long long rows);
+// Summaries of the operations called at least once, in QueryOp order
+vector<QuerySummary> snapshotQueryStats();
+// Fixed-width table of the snapshot, for the debug dialog and the dump file
+string formatQueryStats();
+bool dumpQueryStats(const string& path);
+
+// Times the enclosing scope as one call of op
+class QueryTimer {
+private:
+    QueryOp op;
+    unsigned long long rowCount;
+    chrono::steady_clock::time_point start;
+
+public:
+    QueryTimer(QueryOp queryOp)
+        : op(queryOp), rowCount(0), start(chrono::steady_clock::now()) {}
+    ~QueryTimer() {
+        chrono::steady_clock::duration d = chrono::steady_clock::now() - start;
+        recordQuery(op, chrono::duration_cast<chrono::microseconds>(d).count(), rowCount);
+    }
+    void rows(unsigned long long n) { rowCount = n; }
+};
+
+#ifdef EXAM_QUERY_STATS
+#define QUERY_TIMER(op) QueryTimer queryTimer(op)
+#define QUERY_ROWS(n) queryTimer.rows(n)
+#else
+#define QUERY_TIMER(op)
+#define QUERY_ROWS(n)
+#endif
+
+#endif
@@ -4,6 +4,14 @@
 #include <string>
 using namespace std;
 
+// Optional difficulty of a question; 0 = not set
+enum Difficulty {
+    DIFFICULTY_NONE = 0,
+    DIFFICULTY_EASY = 1,
+    DIFFICULTY_MEDIUM = 2,
+    DIFFICULTY_HARD = 3
+};
+
 class Question {
 public:
     int id;
@@ -15,8 +23,15 @@ public:
     string optionD;
     string correctAnswer;
     int points;
+    string topic;           // optional, e.g. "SQL"
+    int difficulty;         // Difficulty
     
     Question();
 };
 
-#endif
\ No newline at end of file
+// "easy", "medium", "hard", or "" for DIFFICULTY_NONE
+const char* difficultyName(int difficulty);
+// Name (any case) or 1..3; -1 if it is neither
+int parseDifficulty(const string& text);
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef QUESTION_IMPORTER_H
+#define QUESTION_IMPORTER_H
+
+#include <string>
+#include <vector>
+#include "Question.h"
+#include "DatabaseManager.h"
+
+using namespace std;
+
+/**
+ * Parses a question bank file in the bulk upload format:
+ *
+ * Q: What is 2 + 2?
+ * A: 3
+ * B: 4
+ * C: 5
+ * D: 6
+ * ANSWER: B
+ * TOPIC: Arithmetic
+ * DIFFICULTY: easy
+ *
+ * TOPIC and DIFFICULTY (easy, medium or hard) are optional and may come in
+ * either order after ANSWER. Returns false if the file cannot be opened.
+ */
+bool parseQuestionFile(const string& filename, int courseId, vector<Question>& questions);
+
+// Called after each slice of an import is committed
+typedef void (*ImportProgress)(int done, int total, void* data);
+
+// Parses the file and writes it through DatabaseManager::addQuestions,
+// reporting progress every few thousand rows if a callback is given.
+// Returns the number of questions inserted.
+int importQuestionFile(DatabaseManager* db, const string& filename, int courseId,
+                       ImportStats* stats = NULL, ImportProgress progress = NULL,
+                       void* progressData = NULL);
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef QUESTION_SAMPLER_H
+#define QUESTION_SAMPLER_H
+
+#include <map>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <sqlite3.h>
+#include "Course.h"
+#include "Blueprint.h"
+#include "StatementCache.h"
+
+using namespace std;
+
+// Draws random question ids for a course without scanning the question
+// table. Each course's ids are loaded once into an array and k distinct
+// ids are drawn with a partial Fisher-Yates shuffle, so a draw is O(k).
+// A pool is reloaded when the course's pool version moves, i.e. when a
+// question is added to, removed from or moved out of the course.
+//
+// Balanced draws prefer questions that have been shown less often: each
+// showing halves a question's weight, so one shown once more than another
+// is half as likely to come up, and k ids are drawn without replacement
+// from a Fenwick tree of the weights in O(k log n). Exposure counts are read
+// with the pool, kept up to date for this connection's own draws and
+// re-read from the database every EXPOSURE_REFRESH_SECONDS to pick up
+// other connections' draws.
+//
+// Blueprint draws read each question's topic and difficulty once per pool
+// version and index the ids matching each blueprint row the first time the
+// row is used. A draw is then a partial Fisher-Yates per row, so it costs
+// about the same as a plain draw of the same length.
+class QuestionSampler {
+private:
+    struct CoursePool {
+        int poolVersion;
+        vector<int> ids;                // permuted in place by uniform draws
+
+        // Balanced draws, loaded on first use; never permuted
+        bool weighted;
+        vector<int> weightedIds;
+        vector<int> exposures;
+        vector<double> weights;         // 0 while picked in the current draw
+        vector<double> tree;            // Fenwick tree over weights, 1-based
+        double totalWeight;
+        int baseExposure;               // weights are 2^-(exposure - baseExposure)
+        chrono::steady_clock::time_point weightsLoaded;
+
+        // Blueprint draws, loaded on first use
+        bool stratified;
+        vector<int> stratumIds;
+        vector<string> topics;
+        vector<signed char> difficulties;
+        // Ids matching each row seen, by lower-cased topic and difficulty
+        map<pair<string, int>, vector<int> > strata;
+
+        CoursePool() : poolVersion(-1), weighted(false), totalWeight(0), baseExposure(0),
+                       stratified(false) {}
+    };
+
+    sqlite3* db;
+    StatementCache* stmtCache;
+    map<int, CoursePool> pools;
+    mt19937 rng;
+
+    CoursePool& pool(int courseId);
+    int currentPoolVersion(int courseId);
+    void loadWeights(int courseId, CoursePool& p);
+    void rebase(CoursePool& p);
+    void rebuildTree(CoursePool& p);
+    void addWeight(CoursePool& p, int index, double delta);
+    int findWeight(const CoursePool& p, double target);
+    double weightFor(const CoursePool& p, int exposure);
+    vector<int> sampleBalanced(int courseId, int count);
+    void loadStrata(int courseId, CoursePool& p);
+    vector<int>& stratum(CoursePool& p, const BlueprintRow& row);
+
+public:
+    static const int EXPOSURE_REFRESH_SECONDS = 60;
+
+    QuestionSampler(sqlite3* database, StatementCache* cache);
+
+    vector<int> sample(int courseId, int count, SelectionMode mode = SELECT_UNIFORM);
+    // Each row's count drawn uniformly from the questions it matches, in
+    // shuffled order. False if a row could not be filled; ids then holds
+    // what could be drawn.
+    bool sample(int courseId, const Blueprint& blueprint, vector<int>& ids);
+    int poolSize(int courseId);
+
+    // Drop loaded pools, e.g. after a rollback
+    void invalidate(int courseId = -1);
+};
+
+#endif
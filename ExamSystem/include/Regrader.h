@@ -0,0 +1,35 @@
+#ifndef REGRADER_H
+#define REGRADER_H
+
+#include "DatabaseManager.h"
+
+using namespace std;
+
+// Summary of a re-grade run
+struct RegradeStats {
+    int papers;         // stored papers graded
+    int changed;        // results whose marks moved
+    int skipped;        // papers unreadable or with a deleted question; results kept
+    int threads;
+    double seconds;
+    double papersPerSecond;
+
+    RegradeStats() : papers(0), changed(0), skipped(0), threads(0), seconds(0), papersPerSecond(0) {}
+};
+
+// Called on the writing thread after each chunk is committed
+typedef void (*RegradeProgress)(int done, int total, void* data);
+
+// Re-grades every stored paper of the course against its current answer
+// key and rewrites score, total, percentage and pass/fail where they moved.
+// Papers are read and graded by `threads` reader threads (0 = one per core),
+// each on its own connection to db's database; db itself writes the results
+// back in short chunked transactions so live exam writes interleave.
+// Results saved without a paper, papers that can't be read back and papers
+// with a question deleted since are left alone.
+// Returns false if the course doesn't exist or a read or write failed.
+bool regradeCourse(DatabaseManager* db, int courseId, RegradeStats* stats = NULL,
+                   int threads = 0, RegradeProgress progress = NULL,
+                   void* progressData = NULL);
+
+#endif
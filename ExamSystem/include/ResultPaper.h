@@ -0,0 +1,23 @@
+#ifndef RESULT_PAPER_H
+#define RESULT_PAPER_H
+
+#include <vector>
+#include "AnswerSheet.h"
+#include "PaperSeed.h"
+using namespace std;
+
+// The paper behind a stored result: the questions in the order they were
+// shown and the candidate's packed answers, kept so the result can be
+// re-graded if the answer key is corrected
+class ResultPaper {
+public:
+    int resultId;
+    int courseId;
+    vector<int> questionIds;
+    AnswerSheet answers;
+    PaperSeed seed;             // seeded papers store this instead of questionIds
+    
+    ResultPaper();
+};
+
+#endif
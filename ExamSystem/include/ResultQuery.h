@@ -0,0 +1,44 @@
+#ifndef RESULT_QUERY_H
+#define RESULT_QUERY_H
+
+#include <string>
+#include "Result.h"
+using namespace std;
+
+// Called once per streamed row; return false to stop early.
+// The Result is reused between rows, so copy anything you keep.
+typedef bool (*ResultCallback)(const Result& result, void* data);
+
+// Column a results listing is ordered by; ties are broken by id
+enum ResultSort {
+    SORT_DATE,
+    SORT_USERNAME,
+    SORT_COURSE,
+    SORT_SCORE
+};
+
+// Filters, ordering and keyset cursor for DatabaseManager::streamResults.
+class ResultQuery {
+public:
+    int userId;             // -1 = any user
+    int courseId;           // -1 = any course
+    int passed;             // -1 = any, 0 = failed, 1 = passed
+    string fromDate;        // inclusive lower bound on date_time, "" = none
+    string toDate;          // exclusive upper bound on date_time, "" = none
+    ResultSort sortBy;
+    bool ascending;         // default is descending (newest first)
+    int pageSize;           // rows per call, <= 0 = no limit
+    int offset;             // rows to skip after the cursor; for jumps only
+    
+    // Sort key and id of the last row streamed; afterId 0 = from the start
+    string afterKey;
+    double afterScore;
+    int afterId;
+    
+    ResultQuery();
+    void rewind();
+    // Moves the cursor so the next page starts after this row
+    void resumeAfter(const Result& r);
+};
+
+#endif
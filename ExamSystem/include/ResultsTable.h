@@ -0,0 +1,46 @@
+#ifndef RESULTS_TABLE_H
+#define RESULTS_TABLE_H
+
+#include <FL/Fl_Table.H>
+#include <map>
+#include <list>
+#include <vector>
+#include "ResultQuery.h"
+
+// Virtual grid over the results table. Only the pages holding visible rows
+// are fetched (keyset from the nearest page already seen, OFFSET only for
+// the gap), a bounded number of pages is kept, and clicking a column
+// header re-sorts in SQL.
+class ResultsTable : public Fl_Table {
+private:
+    ResultQuery baseQuery;
+    int totalRows;
+    
+    map<int, vector<Result> > pages;
+    list<int> pageOrder;            // least recently used at the back
+    map<int, Result> pageEnds;      // last row of every page fetched so far
+    
+    vector<Result>* loadPage(int page);
+    const Result* rowAt(int row);
+    void drawHeader(int col, int X, int Y, int W, int H);
+    void drawCell(int row, int col, int X, int Y, int W, int H);
+    
+    static bool collectRow(const Result& result, void* data);
+    static void eventCallback(Fl_Widget* w, void* data);
+    
+protected:
+    void draw_cell(TableContext context, int R = 0, int C = 0,
+                   int X = 0, int Y = 0, int W = 0, int H = 0);
+    
+public:
+    ResultsTable(int x, int y, int w, int h);
+    
+    // Applies the query's filters, keeping the current sort, and reloads;
+    // rowCount is countResults for the query, which can take a while on
+    // a big table and so is left to the caller
+    void setQuery(const ResultQuery& query, int rowCount);
+    void reload();
+    int totalCount();
+};
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef SEAT_PAPER_H
+#define SEAT_PAPER_H
+
+#include <vector>
+#include <stdint.h>
+using namespace std;
+
+// One terminal of an exam hall. Rows and columns count from 1 at the
+// front left; 0 = no seat.
+class Seat {
+public:
+    int row;
+    int column;
+    
+    Seat();
+    Seat(int row, int column);
+    bool isSet() const;
+};
+
+// The paper planned for one seat of a hall (see planSeating): its
+// questions in paper order and the seed of its option orders. Used up
+// when a sitting opens at the seat.
+class SeatPaper {
+public:
+    int courseId;
+    Seat seat;
+    vector<int> questionIds;
+    uint64_t optionSeed;
+    
+    SeatPaper();
+};
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef SEAT_PLANNER_H
+#define SEAT_PLANNER_H
+
+#include "DatabaseManager.h"
+
+using namespace std;
+
+// What neighbouring papers have in common, over every pair of seats next
+// to each other (side by side, front to back or diagonally)
+struct SeatOverlap {
+    int adjacentPairs;
+    int sharingPairs;       // pairs with at least one question in common
+    int sharedQuestions;    // questions on both papers of a pair
+    int samePosition;       // ...of which at the same position
+    int sameOrder;          // ...of which with the options in the same order
+    long long cost;         // weighted total the planner minimises
+
+    SeatOverlap() : adjacentPairs(0), sharingPairs(0), sharedQuestions(0), samePosition(0),
+                    sameOrder(0), cost(0) {}
+};
+
+// Summary of a seating plan
+struct SeatPlanStats {
+    int seats;
+    int threads;
+    int sweeps;             // passes of the local search over the hall
+    SeatOverlap drawn;      // the papers as first drawn
+    SeatOverlap planned;    // after the search
+    double drawSeconds;
+    double searchSeconds;
+    double seconds;         // including storing the plan
+
+    SeatPlanStats() : seats(0), threads(0), sweeps(0), drawSeconds(0), searchSeconds(0),
+                      seconds(0) {}
+};
+
+// Plans a paper for every seat of a rows x columns hall so that neighbours'
+// papers share as few questions as possible, and those they share sit at
+// different positions with their options in different orders, then stores
+// the plan in place of the course's previous one. Each seat first gets a
+// paper of questionsPerExam questions as preparePaper would draw it (the
+// course's blueprint or selection mode). A local search then replaces
+// shared questions with ones no neighbour has (of the same topic and
+// difficulty when there is a blueprint), re-rolls option orders and moves
+// shared questions to other positions. Seats are searched in four colour
+// classes of the hall, none with two neighbours in it, so `threads` threads
+// (0 = one per core) improve the seats of a class at once without locks.
+// Returns false if the hall is empty, the course has no questions, or
+// storing failed.
+bool planSeating(DatabaseManager* db, int courseId, int rows, int columns,
+                 SeatPlanStats* stats = NULL, int threads = 0);
+
+#endif
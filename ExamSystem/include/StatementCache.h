@@ -0,0 +1,37 @@
+#ifndef STATEMENT_CACHE_H
+#define STATEMENT_CACHE_H
+
+#include <string>
+#include <map>
+#include <vector>
+#include <sqlite3.h>
+
+using namespace std;
+
+// Holds one prepared statement per SQL string for the lifetime of a
+// connection, so each query is parsed and planned only once.
+class StatementCache {
+private:
+    sqlite3* db;
+    map<string, sqlite3_stmt*> statements;
+    unsigned long hitCount;
+    unsigned long missCount;
+    
+public:
+    StatementCache(sqlite3* database);
+    ~StatementCache();
+    
+    // Returns a reset statement with no bindings, or NULL if it fails to prepare
+    sqlite3_stmt* acquire(const char* sql);
+    // Resets the statement and clears its bindings so it can be reused
+    void release(sqlite3_stmt* stmt);
+    void clear();
+    
+    unsigned long hits() const;
+    unsigned long misses() const;
+    int size() const;
+    // SQL text of every statement prepared so far
+    vector<string> statementsSql() const;
+};
+
+#endif
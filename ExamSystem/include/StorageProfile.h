@@ -0,0 +1,41 @@
+#ifndef STORAGE_PROFILE_H
+#define STORAGE_PROFILE_H
+
+#include <string>
+#include <sqlite3.h>
+
+using namespace std;
+
+// SQLite settings applied when DatabaseManager opens its connection.
+class StorageProfile {
+public:
+    string name;
+    string journalMode;      // WAL, DELETE, TRUNCATE ...
+    string synchronous;      // OFF, NORMAL, FULL
+    int cacheSizeKb;         // page cache per connection
+    long long mmapSize;      // bytes, 0 disables memory-mapped I/O
+    string tempStore;        // DEFAULT, FILE, MEMORY
+    int busyTimeoutMs;       // give up on a locked database after this long
+    int backoffInitialMs;    // first retry delay, doubled on every retry
+    int backoffMaxMs;        // cap for a single retry delay
+    
+    StorageProfile();
+    
+    // Concurrent candidates on one machine: WAL so admin reads never block
+    // result writes, NORMAL sync (durable at checkpoint), generous busy wait
+    static StorageProfile examHall();
+    // Loading question banks: fsync off, large cache; only for offline use
+    static StorageProfile bulkImport();
+    // Every commit on disk before it returns; rollback journal, so it also
+    // works on network filesystems where WAL shared memory is unavailable
+    static StorageProfile durable();
+    
+    // Looks up "exam-hall", "bulk-import" or "durable"; false if unknown
+    static bool byName(const string& presetName, StorageProfile& profile);
+    
+    // Runs the PRAGMAs and installs the busy handler; fills error on failure,
+    // including when SQLite keeps a journal mode other than journalMode
+    bool apply(sqlite3* db, string& error) const;
+};
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef SUBMISSION_QUEUE_H
+#define SUBMISSION_QUEUE_H
+
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include "DatabaseManager.h"
+
+using namespace std;
+
+// Called on the queue's writer thread once a posted submission is
+// committed (resultId > 0), was already submitted (0) or has failed (-1)
+typedef void (*SubmissionDone)(int resultId, void* data);
+
+// What a queue has written so far
+struct SubmissionStats {
+    int submissions;
+    int groups;             // groups written
+    int largestGroup;
+    int retried;            // submissions written again alone after their group failed
+
+    SubmissionStats() : submissions(0), groups(0), largestGroup(0), retried(0) {}
+};
+
+/**
+ * Group commit for result submissions. Any number of threads call submit(),
+ * which blocks until that submission is committed and returns its result id,
+ * just like DatabaseManager::submitResult, or post(), which returns at once
+ * and reports through a callback (for servers whose threads mustn't wait
+ * out a group). A writer thread with a connection
+ * of its own takes whatever is queued, waits up to maxDelayMs after the
+ * first arrival for more (unless maxGroup are already waiting), and writes
+ * the whole group in one transaction. A time-up storm then costs one commit
+ * (one fsync under the durable profile) per group instead of one per
+ * candidate, and submitters don't queue for each other's write lock.
+ *
+ * A submission is acknowledged only after its group's COMMIT returns, so
+ * it is as durable as the profile's synchronous setting makes any commit.
+ * If a group can't be written, each of its submissions is retried in a
+ * transaction of its own, so one bad submission doesn't fail the rest.
+ */
+class SubmissionQueue {
+private:
+    struct Submission {
+        Result result;
+        ResultPaper paper;
+        int sessionId;
+        vector<SessionAnswer> finalChanges;
+        int resultId;
+        bool done;
+        SubmissionDone callback;        // NULL = a caller waits in submit()
+        void* callbackData;
+    };
+
+    DatabaseManager* db;
+    int maxGroup;
+    int maxDelayMs;
+    deque<Submission*> queue;
+    mutex queueLock;
+    condition_variable queued;          // the writer waits for submissions
+    condition_variable committed;       // submitters wait for their group
+    bool stopping;
+    SubmissionStats totals;
+    thread writer;
+
+    void run();
+    void writeGroup(vector<Submission*>& group);
+    void enqueue(Submission* submission);
+
+public:
+    static const int DEFAULT_MAX_GROUP = 128;
+    static const int DEFAULT_MAX_DELAY_MS = 5;
+
+    SubmissionQueue(const string& path, const StorageProfile& profile,
+                    int maxGroup = DEFAULT_MAX_GROUP, int maxDelayMs = DEFAULT_MAX_DELAY_MS);
+    // Writes what is already queued, then joins the writer
+    ~SubmissionQueue();
+
+    bool isReady();
+    string getLastError();
+
+    int submit(const Result& r, const ResultPaper& paper, int sessionId,
+               const vector<SessionAnswer>& finalChanges);
+    // Queues the submission and returns; done(resultId, data) follows on
+    // the writer thread. False if the queue isn't running.
+    bool post(const Result& r, const ResultPaper& paper, int sessionId,
+              const vector<SessionAnswer>& finalChanges, SubmissionDone done, void* data);
+    SubmissionStats getStats();
+};
+
+#endif
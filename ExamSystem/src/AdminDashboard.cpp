@@ -1,15 +1,103 @@
 #include "AdminDashboard.h"
 #include "Globals.h"
+#include "StatementCache.h"
+#include "QueryStats.h"
+#include "QuestionImporter.h"
+#include "Regrader.h"
+#include "PaperGenerator.h"
+#include "DbWorker.h"
 #include <FL/Fl_Box.H>
 #include <FL/Fl_Button.H>
 #include <FL/fl_ask.H>
 #include <FL/Fl_File_Chooser.H>
 #include <sstream>
-#include <fstream>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
 
 using namespace std;
 
+AdminDashboard* AdminDashboard::current = NULL;
+
+// Bulk upload, run on the database worker
+struct UploadJob {
+    string filename;
+    int courseId;
+    int count;
+    ImportStats stats;
+    ImportProgress progress;
+};
+
+// One progress report from an upload in flight
+struct UploadProgress {
+    int done;
+    int total;
+};
+
+static void runUpload(DatabaseManager* db, void* data) {
+    UploadJob* job = (UploadJob*)data;
+    job->count = importQuestionFile(db, job->filename, job->courseId, &job->stats,
+                                    job->progress, NULL);
+}
+
+// Answer key correction and re-grade of the course, run on the database worker
+struct RegradeJob {
+    int courseId;
+    int questionId;
+    string answer;
+    bool inCourse;
+    bool keyFixed;
+    bool ok;
+    RegradeStats stats;
+    RegradeProgress progress;
+};
+
+static void runRegrade(DatabaseManager* db, void* data) {
+    RegradeJob* job = (RegradeJob*)data;
+    job->inCourse = false;
+    job->keyFixed = false;
+    job->ok = false;
+    
+    // The question must belong to the course being re-graded
+    vector<Question> key = db->getCourseAnswerKey(job->courseId);
+    for (size_t i = 0; i < key.size(); i++) {
+        if (key[i].id == job->questionId) {
+            job->inCourse = true;
+            job->keyFixed = db->updateCorrectAnswer(job->questionId, job->answer);
+            break;
+        }
+    }
+    if (job->keyFixed) {
+        job->ok = regradeCourse(db, job->courseId, &job->stats, 0, job->progress, NULL);
+    }
+}
+
+// Papers for every candidate ahead of a sitting, run on the database worker
+struct PregenJob {
+    int courseId;
+    string code;
+    bool ok;
+    PregenStats stats;
+};
+
+static void runPregen(DatabaseManager* db, void* data) {
+    PregenJob* job = (PregenJob*)data;
+    job->ok = pregeneratePapers(db, job->courseId, db->getUserIdsByRole("candidate"),
+                                &job->stats);
+}
+
+// Row count for the results grid, run on the database worker
+struct ResultsCountJob {
+    ResultQuery query;
+    int count;
+};
+
+static void runResultsCount(DatabaseManager* db, void* data) {
+    ResultsCountJob* job = (ResultsCountJob*)data;
+    job->count = db->countResults(job->query);
+}
+
 void AdminDashboard::addCourseCallback(Fl_Widget* w, void* data) {
     AdminDashboard* panel = (AdminDashboard*)data;
     string code = panel->courseCodeInput->value();
@@ -17,13 +105,14 @@ void AdminDashboard::addCourseCallback(Fl_Widget* w, void* data) {
     int time = (int)panel->timeInput->value();
     int qCount = (int)panel->questionsCountInput->value();
     int passing = (int)panel->passingMarkInput->value();
+    SelectionMode mode = panel->balancedCheck->value() ? SELECT_BALANCED : SELECT_UNIFORM;
     
     if (code.empty() || title.empty()) {
         fl_alert("Please fill Course Code and Title!");
         return;
     }
     
-    if (dbManager->addCourse(code, title, time, qCount, passing)) {
+    if (dbManager->addCourse(code, title, time, qCount, passing, mode)) {
         fl_message("Course added successfully!");
         panel->clearCourseFields();
         panel->refreshCourseBrowser();
@@ -39,6 +128,94 @@ void AdminDashboard::refreshCoursesCallback(Fl_Widget* w, void* data) {
     panel->refreshCourseChoice();
 }
 
+void AdminDashboard::setBlueprintCallback(Fl_Widget* w, void* data) {
+    AdminDashboard* panel = (AdminDashboard*)data;
+    const char* codeText = fl_input("Set the blueprint of course:",
+                                    panel->courseCodeInput->value());
+    if (!codeText) return;
+    string code = codeText;
+    
+    int courseId = dbManager->getCourseIdByCode(code);
+    if (courseId <= 0) {
+        fl_alert("No course with code %s!", code.c_str());
+        return;
+    }
+    
+    string current = dbManager->getBlueprint(courseId).toString();
+    const char* text = fl_input("Blueprint for %s, e.g. \"10 easy SQL, 5 hard normalization\"\n"
+                                "(leave empty to draw from the whole pool):",
+                                current.c_str(), code.c_str());
+    if (!text) return;
+    
+    Blueprint blueprint;
+    string error;
+    string trimmed = text;
+    if (trimmed.find_first_not_of(" \t") != string::npos) {
+        if (!Blueprint::parse(trimmed, blueprint, error)) {
+            fl_alert("%s", error.c_str());
+            return;
+        }
+        if (!blueprint.fits(dbManager->getStrata(courseId), error)) {
+            fl_alert("%s cannot be met: %s", code.c_str(), error.c_str());
+            return;
+        }
+    }
+    
+    if (dbManager->setBlueprint(courseId, blueprint)) {
+        if (blueprint.rows.empty()) {
+            fl_message("%s papers are drawn from the whole pool again.", code.c_str());
+        } else {
+            fl_message("%s papers now have %d questions: %s", code.c_str(),
+                       blueprint.totalQuestions(), blueprint.toString().c_str());
+        }
+        panel->refreshCourseBrowser();
+    } else {
+        fl_alert("Failed to save the blueprint: %s", dbManager->getLastError().c_str());
+    }
+}
+
+void AdminDashboard::pregenPapersCallback(Fl_Widget* w, void* data) {
+    AdminDashboard* panel = (AdminDashboard*)data;
+    const char* codeText = fl_input("Pre-generate every candidate's paper for course:",
+                                    panel->courseCodeInput->value());
+    if (!codeText) return;
+    
+    int courseId = dbManager->getCourseIdByCode(codeText);
+    if (courseId <= 0) {
+        fl_alert("No course with code %s!", codeText);
+        return;
+    }
+    
+    PregenJob* job = new PregenJob;
+    job->courseId = courseId;
+    job->code = codeText;
+    job->ok = false;
+    
+    panel->pregenBtn->deactivate();
+    dbWorker->post(runPregen, pregenDone, job);
+}
+
+void AdminDashboard::pregenDone(void* data) {
+    PregenJob* job = (PregenJob*)data;
+    string code = job->code;
+    bool ok = job->ok;
+    PregenStats stats = job->stats;
+    delete job;
+    
+    if (!current) return;
+    current->pregenBtn->activate();
+    
+    if (ok) {
+        char msg[200];
+        sprintf(msg, "%d papers ready for %s.\n%.2f seconds (%.0f papers/sec)",
+                stats.papers, code.c_str(), stats.seconds, stats.papersPerSecond);
+        fl_message("%s", msg);
+    } else {
+        fl_alert("Could not pre-generate papers for %s. Does the course have questions?",
+                 code.c_str());
+    }
+}
+
 void AdminDashboard::debugDatabaseCallback(Fl_Widget* w, void* data) {
     AdminDashboard* panel = (AdminDashboard*)data;
     
@@ -47,7 +224,20 @@ void AdminDashboard::debugDatabaseCallback(Fl_Widget* w, void* data) {
     stringstream debug;
     debug << "DATABASE DEBUG INFORMATION\n";
     debug << "===========================\n\n";
-    debug << "Total Courses Found: " << courses.size() << "\n\n";
+    debug << "Total Courses Found: " << courses.size() << "\n";
+    
+    const StorageProfile& profile = dbManager->getStorageProfile();
+    debug << "Storage Profile: " << profile.name << " (journal " << profile.journalMode
+          << ", synchronous " << profile.synchronous << ")\n";
+    
+    StatementCache* cache = dbManager->getStatementCache();
+    debug << "Statement Cache: " << cache->size() << " statements, "
+          << cache->hits() << " hits, " << cache->misses() << " misses\n\n";
+    
+#ifdef EXAM_QUERY_STATS
+    debug << "Query Latency (all connections):\n";
+    debug << formatQueryStats() << "\n";
+#endif
     
     if (courses.empty()) {
         debug << "NO COURSES IN DATABASE!\n\n";
@@ -70,7 +260,10 @@ void AdminDashboard::debugDatabaseCallback(Fl_Widget* w, void* data) {
         }
     }
     
+    // Fixed width so the latency table lines up
+    fl_message_font(FL_COURIER, 12);
     fl_message("%s", debug.str().c_str());
+    fl_message_font(FL_HELVETICA, 14);
     
     panel->refreshCourseBrowser();
     panel->refreshCourseChoice();
@@ -144,19 +337,151 @@ void AdminDashboard::uploadQuestionsCallback(Fl_Widget* w, void* data) {
     const char* filename = fl_file_chooser("Select Questions File", "*.txt", "");
     if (!filename) return;
     
-    int count = panel->uploadQuestionsFromFile(filename, courseId);
+    UploadJob* job = new UploadJob;
+    job->filename = filename;
+    job->courseId = courseId;
+    job->count = 0;
+    job->progress = reportUploadProgress;
+    
+    panel->uploadBtn->deactivate();
+    panel->uploadProgress->value(0);
+    panel->uploadProgress->label("Reading...");
+    panel->uploadProgress->show();
+    dbWorker->post(runUpload, uploadDone, job);
+}
+
+// Called on the worker thread after each committed slice
+void AdminDashboard::reportUploadProgress(int done, int total, void* data) {
+    UploadProgress* progress = new UploadProgress;
+    progress->done = done;
+    progress->total = total;
+    DbWorker::notify(uploadProgressed, progress);
+}
+
+void AdminDashboard::uploadProgressed(void* data) {
+    UploadProgress* progress = (UploadProgress*)data;
+    if (current && progress->total > 0) {
+        static char label[32];
+        sprintf(label, "%d / %d", progress->done, progress->total);
+        current->uploadProgress->value(progress->done * 100.0f / progress->total);
+        current->uploadProgress->label(label);
+    }
+    delete progress;
+}
+
+void AdminDashboard::uploadDone(void* data) {
+    UploadJob* job = (UploadJob*)data;
+    int count = job->count;
+    ImportStats stats = job->stats;
+    delete job;
+    
+    if (!current) return;
+    current->uploadProgress->hide();
+    current->uploadBtn->activate();
     
     if (count > 0) {
         char msg[200];
-        sprintf(msg, "Successfully uploaded %d questions!", count);
-        fl_message(msg);
-        panel->refreshQuestionBrowser();
-        panel->refreshCourseBrowser();
+        sprintf(msg, "Successfully uploaded %d questions!\n%.2f seconds (%.0f rows/sec)",
+               count, stats.seconds, stats.rowsPerSecond);
+        fl_message("%s", msg);
+        current->refreshQuestionBrowser();
+        current->refreshCourseBrowser();
     } else {
         fl_alert("Failed to upload questions or file format incorrect!");
     }
 }
 
+void AdminDashboard::fixAnswerKeyCallback(Fl_Widget* w, void* data) {
+    AdminDashboard* panel = (AdminDashboard*)data;
+    int courseIdx = panel->courseChoice->value();
+    if (courseIdx < 0) {
+        fl_alert("Please select a course first!");
+        return;
+    }
+    
+    stringstream ss(panel->courseChoice->text(courseIdx));
+    string code;
+    ss >> code;
+    int courseId = dbManager->getCourseIdByCode(code);
+    if (courseId <= 0) {
+        fl_alert("Invalid course!");
+        return;
+    }
+    
+    const char* idText = fl_input("Question ID with the wrong answer:");
+    if (!idText) return;
+    int questionId = atoi(idText);
+    
+    const char* answerText = fl_input("Correct answer (A, B, C or D):");
+    if (!answerText) return;
+    string answer = answerText;
+    if (answer.size() != 1 || toupper(answer[0]) < 'A' || toupper(answer[0]) > 'D') {
+        fl_alert("The answer must be A, B, C or D!");
+        return;
+    }
+    answer[0] = (char)toupper(answer[0]);
+    
+    char msg[200];
+    sprintf(msg, "Set question %d of %s to %s and re-grade every stored paper?",
+            questionId, code.c_str(), answer.c_str());
+    if (fl_choice("%s", "Cancel", "Re-grade", NULL, msg) != 1) return;
+    
+    RegradeJob* job = new RegradeJob;
+    job->courseId = courseId;
+    job->questionId = questionId;
+    job->answer = answer;
+    job->progress = reportRegradeProgress;
+    
+    panel->uploadBtn->deactivate();
+    panel->fixKeyBtn->deactivate();
+    panel->uploadProgress->value(0);
+    panel->uploadProgress->label("Re-grading...");
+    panel->uploadProgress->show();
+    dbWorker->post(runRegrade, regradeDone, job);
+}
+
+// Called on the worker thread after each chunk of results is rewritten
+void AdminDashboard::reportRegradeProgress(int done, int total, void* data) {
+    UploadProgress* progress = new UploadProgress;
+    progress->done = done;
+    progress->total = total;
+    DbWorker::notify(uploadProgressed, progress);
+}
+
+void AdminDashboard::regradeDone(void* data) {
+    RegradeJob* job = (RegradeJob*)data;
+    int questionId = job->questionId;
+    bool inCourse = job->inCourse;
+    bool keyFixed = job->keyFixed;
+    bool ok = job->ok;
+    RegradeStats stats = job->stats;
+    delete job;
+    
+    if (!current) return;
+    current->uploadProgress->hide();
+    current->uploadBtn->activate();
+    current->fixKeyBtn->activate();
+    
+    if (!inCourse) {
+        fl_alert("Question %d is not in the selected course!", questionId);
+    } else if (!keyFixed) {
+        fl_alert("The answer of question %d could not be changed; nothing was re-graded.",
+                 questionId);
+    } else if (!ok) {
+        fl_alert("The answer key was corrected but the re-grade failed. Run it again.");
+    } else {
+        char msg[300];
+        sprintf(msg, "Re-graded %d papers, %d results changed.\n%.2f seconds (%.0f papers/sec)",
+                stats.papers, stats.changed, stats.seconds, stats.papersPerSecond);
+        if (stats.skipped > 0) {
+            sprintf(msg + strlen(msg), "\n\n%d stored papers could not be read back or ask a "
+                    "question since deleted; their results were left unchanged.", stats.skipped);
+        }
+        fl_message("%s", msg);
+        current->refreshResults();
+    }
+}
+
 void AdminDashboard::refreshQuestionsCallback(Fl_Widget* w, void* data) {
     AdminDashboard* panel = (AdminDashboard*)data;
     panel->refreshQuestionBrowser();
@@ -202,6 +527,7 @@ void AdminDashboard::clearCourseFields() {
     timeInput->value(60);
     questionsCountInput->value(40);
     passingMarkInput->value(40);
+    balancedCheck->value(0);
 }
 
 void AdminDashboard::clearQuestionFields() {
@@ -226,26 +552,37 @@ void AdminDashboard::refreshCourseBrowser() {
                courses[i].courseTitle.c_str());
         courseBrowser->add(buffer);
         
-        sprintf(buffer, "  Time: %d min | Questions: %d (Pool: %d) | Pass: %d%%",
+        sprintf(buffer, "  Time: %d min | Questions: %d (Pool: %d) | Pass: %d%%%s",
                courses[i].timeAllocation, courses[i].questionsPerExam,
-               courses[i].totalQuestions, courses[i].passingMark);
+               courses[i].totalQuestions, courses[i].passingMark,
+               courses[i].selectionMode == SELECT_BALANCED ? " | Balanced draws" : "");
         courseBrowser->add(buffer);
+        
+        Blueprint blueprint = dbManager->getBlueprint(courses[i].id);
+        if (!blueprint.rows.empty()) {
+            string line = "  Blueprint: " + blueprint.toString();
+            courseBrowser->add(line.c_str());
+        }
         courseBrowser->add("---");
     }
 }
 
 void AdminDashboard::refreshCourseChoice() {
     courseChoice->clear();
+    resultCourseChoice->clear();
+    resultCourseChoice->add("All Courses");
     vector<Course> courses = dbManager->getAllCourses();
     
     for (size_t i = 0; i < courses.size(); i++) {
         string item = courses[i].courseCode + " - " + courses[i].courseTitle;
         courseChoice->add(item.c_str());
+        resultCourseChoice->add(item.c_str());
     }
     
     if (courses.size() > 0) {
         courseChoice->value(0);
     }
+    resultCourseChoice->value(0);
 }
 
 void AdminDashboard::refreshQuestionBrowser() {
@@ -271,97 +608,50 @@ void AdminDashboard::refreshQuestionBrowser() {
         questionBrowser->add(buffer);
         sprintf(buffer, "Total Questions: %d", course->totalQuestions);
         questionBrowser->add(buffer);
+        
+        ExposureStats exposure = dbManager->getExposureStats(courseId);
+        sprintf(buffer, "Times shown: min %d | mean %.1f | max %d | never shown: %d",
+               exposure.minExposure, exposure.meanExposure, exposure.maxExposure,
+               exposure.neverShown);
+        questionBrowser->add(buffer);
         questionBrowser->add("---");
         delete course;
     }
 }
 
 void AdminDashboard::refreshResults() {
-    resultsBrowser->clear();
-    vector<Result> results = dbManager->getResults();
-    
-    resultsBrowser->add("=== ALL EXAMINATION RESULTS ===");
-    resultsBrowser->add("");
-    
-    for (size_t i = 0; i < results.size(); i++) {
-        char buffer[400];
-        sprintf(buffer, "%s - %s (%s)", 
-               results[i].username.c_str(),
-               results[i].courseCode.c_str(),
-               results[i].courseTitle.c_str());
-        resultsBrowser->add(buffer);
-        
-        sprintf(buffer, "  Date: %s", results[i].dateTime.c_str());
-        resultsBrowser->add(buffer);
-        
-        sprintf(buffer, "  Score: %d/%d (%.1f%%) - %s", 
-               results[i].score, results[i].totalPoints,
-               results[i].percentage,
-               results[i].passed ? "PASS" : "FAIL");
-        resultsBrowser->add(buffer);
-        resultsBrowser->add("---");
-    }
-}
-
-int AdminDashboard::uploadQuestionsFromFile(const char* filename, int courseId) {
-    ifstream file(filename);
-    if (!file.is_open()) {
-        return 0;
+    ResultQuery query;
+    
+    int courseIdx = resultCourseChoice->value();
+    if (courseIdx > 0) {
+        stringstream ss(resultCourseChoice->text(courseIdx));
+        string code;
+        ss >> code;
+        query.courseId = dbManager->getCourseIdByCode(code);
     }
     
-    int count = 0;
-    string line;
+    int statusIdx = resultStatusChoice->value();
+    if (statusIdx == 1) query.passed = 1;
+    else if (statusIdx == 2) query.passed = 0;
     
-    while (getline(file, line)) {
-        if (line.empty() || line[0] == '#') continue;
+    // Counting a large table takes a while; the grid fills in when it's done
+    ResultsCountJob* job = new ResultsCountJob;
+    job->query = query;
+    job->count = 0;
+    resultsCountBox->label("Counting...");
+    dbWorker->post(runResultsCount, resultsCounted, job);
+}
+
+void AdminDashboard::resultsCounted(void* data) {
+    ResultsCountJob* job = (ResultsCountJob*)data;
+    if (current) {
+        current->resultsTable->setQuery(job->query, job->count);
         
-        if (line.substr(0, 2) == "Q:") {
-            string question = line.substr(2);
-            if (!question.empty() && question[0] == ' ') {
-                question = question.substr(1);
-            }
-            
-            string optA, optB, optC, optD, correct;
-            
-            if (getline(file, line) && line.substr(0, 2) == "A:") {
-                optA = line.substr(2);
-                if (!optA.empty() && optA[0] == ' ') optA = optA.substr(1);
-            }
-            
-            if (getline(file, line) && line.substr(0, 2) == "B:") {
-                optB = line.substr(2);
-                if (!optB.empty() && optB[0] == ' ') optB = optB.substr(1);
-            }
-            
-            if (getline(file, line) && line.substr(0, 2) == "C:") {
-                optC = line.substr(2);
-                if (!optC.empty() && optC[0] == ' ') optC = optC.substr(1);
-            }
-            
-            if (getline(file, line) && line.substr(0, 2) == "D:") {
-                optD = line.substr(2);
-                if (!optD.empty() && optD[0] == ' ') optD = optD.substr(1);
-            }
-            
-            if (getline(file, line) && line.substr(0, 7) == "ANSWER:") {
-                correct = line.substr(7);
-                if (!correct.empty() && correct[0] == ' ') correct = correct.substr(1);
-                if (!correct.empty()) correct = correct.substr(0, 1);
-            }
-            
-            if (!question.empty() && !optA.empty() && !optB.empty() && 
-                !optC.empty() && !optD.empty() && !correct.empty()) {
-                
-                if (dbManager->addQuestion(courseId, question, optA, optB, 
-                                          optC, optD, correct, 1)) {
-                    count++;
-                }
-            }
-        }
+        static char countLabel[64];
+        sprintf(countLabel, "%d results", job->count);
+        current->resultsCountBox->label(countLabel);
     }
-    
-    file.close();
-    return count;
+    delete job;
 }
 
 // ============================================================================
@@ -369,6 +659,7 @@ int AdminDashboard::uploadQuestionsFromFile(const char* filename, int courseId)
 // ============================================================================
 
 AdminDashboard::AdminDashboard() {
+    current = this;
     window = new Fl_Window(950, 700, "Admin Dashboard");
     window->color(fl_rgb_color(240, 245, 250));
     
@@ -412,6 +703,9 @@ AdminDashboard::AdminDashboard() {
     passingMarkInput->value(40);
     passingMarkInput->step(5);
     
+    balancedCheck = new Fl_Check_Button(270, 285, 230, 25, "Balance question exposure");
+    balancedCheck->tooltip("Draw the questions shown least so far more often");
+    
     Fl_Button* addCourseBtn = new Fl_Button(150, 325, 150, 35, "Add Course");
     addCourseBtn->color(FL_GREEN);
     addCourseBtn->callback(addCourseCallback, this);
@@ -419,6 +713,16 @@ AdminDashboard::AdminDashboard() {
     Fl_Button* refreshCourseBtn = new Fl_Button(320, 325, 150, 35, "Refresh List");
     refreshCourseBtn->color(fl_rgb_color(100, 149, 237));
     refreshCourseBtn->callback(refreshCoursesCallback, this);
+    
+    pregenBtn = new Fl_Button(490, 325, 180, 35, "Pre-generate Papers");
+    pregenBtn->color(fl_rgb_color(255, 165, 0));
+    pregenBtn->callback(pregenPapersCallback, this);
+    pregenBtn->tooltip("Draw every candidate's paper now, before the sitting starts");
+    
+    blueprintBtn = new Fl_Button(690, 325, 150, 35, "Set Blueprint");
+    blueprintBtn->color(fl_rgb_color(100, 149, 237));
+    blueprintBtn->callback(setBlueprintCallback, this);
+    blueprintBtn->tooltip("How many questions of each topic and difficulty a paper takes");
 
     courseBrowser = new Fl_Browser(30, 380, 890, 280);
     
@@ -441,14 +745,21 @@ AdminDashboard::AdminDashboard() {
     Fl_Button* refreshQBtn = new Fl_Button(510, 145, 120, 25, "Refresh");
     refreshQBtn->callback(refreshQuestionsCallback, this);
     
-    Fl_Button* uploadBtn = new Fl_Button(650, 145, 150, 25, "Upload Questions");
+    uploadBtn = new Fl_Button(650, 145, 150, 25, "Upload Questions");
     uploadBtn->color(fl_rgb_color(255, 165, 0));
     uploadBtn->labelsize(11);
     uploadBtn->callback(uploadQuestionsCallback, this);
     uploadBtn->tooltip("Upload questions from a text file");
     
+    uploadProgress = new Fl_Progress(810, 145, 110, 25);
+    uploadProgress->minimum(0);
+    uploadProgress->maximum(100);
+    uploadProgress->selection_color(fl_rgb_color(255, 165, 0));
+    uploadProgress->labelsize(10);
+    uploadProgress->hide();
+    
     Fl_Box* formatInfo = new Fl_Box(30, 180, 890, 30);
-    formatInfo->copy_label("File Format: Q: Question? | A: Option A | B: Option B | C: Option C | D: Option D | ANSWER: A");
+    formatInfo->copy_label("File Format: Q: Question? | A: Option A | B: Option B | C: Option C | D: Option D | ANSWER: A | optional TOPIC: SQL | DIFFICULTY: easy");
     formatInfo->labelsize(10);
     formatInfo->labelcolor(FL_DARK_BLUE);
     formatInfo->align(FL_ALIGN_LEFT | FL_ALIGN_INSIDE);
@@ -476,6 +787,12 @@ AdminDashboard::AdminDashboard() {
     addQBtn->labelsize(13);
     addQBtn->callback(addQuestionCallback, this);
     
+    fixKeyBtn = new Fl_Button(580, 495, 180, 40, "Fix Answer Key");
+    fixKeyBtn->color(fl_rgb_color(255, 165, 0));
+    fixKeyBtn->labelsize(13);
+    fixKeyBtn->callback(fixAnswerKeyCallback, this);
+    fixKeyBtn->tooltip("Correct one question's answer and re-grade the course's results");
+    
     questionBrowser = new Fl_Browser(30, 550, 890, 110);
     
     questionTab->end();
@@ -489,11 +806,23 @@ AdminDashboard::AdminDashboard() {
     resTitle->labelsize(16);
     resTitle->labelfont(FL_BOLD);
     
-    Fl_Button* viewResBtn = new Fl_Button(400, 145, 150, 30, "Refresh Results");
+    resultCourseChoice = new Fl_Choice(100, 145, 280, 30, "Course:");
+    
+    resultStatusChoice = new Fl_Choice(450, 145, 100, 30, "Status:");
+    resultStatusChoice->add("All");
+    resultStatusChoice->add("Pass");
+    resultStatusChoice->add("Fail");
+    resultStatusChoice->value(0);
+    
+    Fl_Button* viewResBtn = new Fl_Button(580, 145, 150, 30, "Refresh Results");
     viewResBtn->color(fl_rgb_color(100, 149, 237));
     viewResBtn->callback(viewResultsCallback, this);
     
-    resultsBrowser = new Fl_Browser(30, 190, 890, 470);
+    resultsCountBox = new Fl_Box(750, 145, 170, 30, "");
+    resultsCountBox->align(FL_ALIGN_INSIDE | FL_ALIGN_RIGHT);
+    
+    // Click a column header to sort by it; click again to reverse
+    resultsTable = new ResultsTable(30, 190, 890, 470);
     
     resultsTab->end();
     
@@ -530,6 +859,7 @@ AdminDashboard::AdminDashboard() {
 // ============================================================================
 
 AdminDashboard::~AdminDashboard() {
+    if (current == this) current = NULL;
     delete window;
 }
 
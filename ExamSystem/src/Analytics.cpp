@@ -0,0 +1,48 @@
+#include "Analytics.h"
+
+using namespace std;
+
+HistorySummary::HistorySummary() : taken(0), passed(0), totalPercentage(0) {}
+
+double HistorySummary::averagePercentage() const {
+    return taken > 0 ? totalPercentage / taken : 0;
+}
+
+int HistorySummary::passRate() const {
+    return taken > 0 ? passed * 100 / taken : 0;
+}
+
+struct SummaryState {
+    HistorySummary* summary;
+    int recentCount;
+};
+
+static bool addToSummary(const Result& r, void* data) {
+    SummaryState* state = (SummaryState*)data;
+    HistorySummary* summary = state->summary;
+    
+    // Rows arrive newest first, so the first few are the recent history
+    if ((int)summary->recent.size() < state->recentCount) {
+        summary->recent.push_back(r);
+    }
+    
+    summary->taken++;
+    summary->totalPercentage += r.percentage;
+    if (r.passed) summary->passed++;
+    return true;
+}
+
+int summarizeHistory(DatabaseManager* db, int userId, HistorySummary& summary,
+                      int recentCount) {
+    summary = HistorySummary();
+    
+    SummaryState state;
+    state.summary = &summary;
+    state.recentCount = recentCount;
+    
+    ResultQuery query;
+    query.userId = userId;
+    query.pageSize = 0;
+    db->streamResults(query, addToSummary, &state);
+    return summary.taken;
+}
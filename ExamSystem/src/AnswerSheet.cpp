@@ -0,0 +1,173 @@
+#include "AnswerSheet.h"
+#include "PaperSeed.h"
+#include <algorithm>
+
+using namespace std;
+
+static const int LANES_PER_WORD = 32;
+// Low bit of every 2-bit lane
+static const uint64_t LANE_LOW_BITS = 0x5555555555555555ULL;
+
+static int wordsFor(int questionCount) {
+    return (questionCount + LANES_PER_WORD - 1) / LANES_PER_WORD;
+}
+
+static int popcount64(uint64_t v) {
+#if defined(__GNUC__)
+    return __builtin_popcountll(v);
+#else
+    v = v - ((v >> 1) & LANE_LOW_BITS);
+    v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+    v = (v + (v >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (int)((v * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+static int lowestBit(uint64_t v) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(v);
+#else
+    int bit = 0;
+    while (!(v & 1)) {
+        v >>= 1;
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+// Low lane bits of the questions both answered and answered the same
+static uint64_t matchingLanes(const AnswerKey& key, const AnswerSheet& sheet, int word) {
+    uint64_t differ = key.options.codes[word] ^ sheet.codes[word];
+    differ = (differ | (differ >> 1)) & LANE_LOW_BITS;
+    return ~differ & key.options.answered[word] & sheet.answered[word];
+}
+
+AnswerSheet::AnswerSheet() : size(0) {}
+
+AnswerSheet::AnswerSheet(int questionCount)
+    : codes(wordsFor(questionCount), 0), answered(wordsFor(questionCount), 0),
+      size(questionCount) {}
+
+void AnswerSheet::reset(int questionCount) {
+    size = questionCount;
+    codes.assign(wordsFor(questionCount), 0);
+    answered.assign(wordsFor(questionCount), 0);
+}
+
+void AnswerSheet::set(int index, const string& answer) {
+    bool valid = answer.size() == 1 && answer[0] >= 'A' && answer[0] <= 'D';
+    setCode(index, valid ? answer[0] - 'A' : -1);
+}
+
+void AnswerSheet::setCode(int index, int code) {
+    if (index < 0 || index >= size) {
+        return;
+    }
+    int word = index / LANES_PER_WORD;
+    int shift = (index % LANES_PER_WORD) * 2;
+    codes[word] &= ~(3ULL << shift);
+    answered[word] &= ~(1ULL << shift);
+
+    if (code >= 0 && code <= 3) {
+        codes[word] |= (uint64_t)code << shift;
+        answered[word] |= 1ULL << shift;
+    }
+}
+
+string AnswerSheet::get(int index) const {
+    if (index < 0 || index >= size) {
+        return "";
+    }
+    int word = index / LANES_PER_WORD;
+    int shift = (index % LANES_PER_WORD) * 2;
+    if (!(answered[word] >> shift & 1)) {
+        return "";
+    }
+    return string(1, (char)('A' + (codes[word] >> shift & 3)));
+}
+
+int AnswerSheet::answeredCount() const {
+    int count = 0;
+    for (size_t w = 0; w < answered.size(); w++) {
+        count += popcount64(answered[w]);
+    }
+    return count;
+}
+
+AnswerSheet AnswerSheet::fromAnswers(const vector<string>& answers) {
+    AnswerSheet sheet((int)answers.size());
+    for (size_t i = 0; i < answers.size(); i++) {
+        sheet.set((int)i, answers[i]);
+    }
+    return sheet;
+}
+
+vector<string> AnswerSheet::toAnswers() const {
+    vector<string> answers(size);
+    for (int i = 0; i < size; i++) {
+        answers[i] = get(i);
+    }
+    return answers;
+}
+
+AnswerKey::AnswerKey() : totalPoints(0), uniformPoints(true) {}
+
+AnswerKey::AnswerKey(const vector<Question>& questions)
+    : options((int)questions.size()), points(questions.size()), totalPoints(0),
+      uniformPoints(true) {
+    for (size_t i = 0; i < questions.size(); i++) {
+        // A malformed key entry can never be matched
+        options.set((int)i, questions[i].correctAnswer);
+        points[i] = questions[i].points;
+        totalPoints += points[i];
+        if (points[i] != points[0]) uniformPoints = false;
+    }
+}
+
+void AnswerKey::applyOptionOrders(const vector<unsigned char>& orders) {
+    int count = min(options.size, (int)orders.size());
+    for (int i = 0; i < count; i++) {
+        if (orders[i] == 0) continue;
+        int word = i / LANES_PER_WORD;
+        int shift = (i % LANES_PER_WORD) * 2;
+        if (options.answered[word] >> shift & 1) {
+            int code = (int)(options.codes[word] >> shift & 3);
+            options.setCode(i, displaySlot(orders[i], code));
+        }
+    }
+}
+
+int countCorrect(const AnswerKey& key, const AnswerSheet& sheet) {
+    int words = (int)min(key.options.codes.size(), sheet.codes.size());
+    int correct = 0;
+    for (int w = 0; w < words; w++) {
+        correct += popcount64(matchingLanes(key, sheet, w));
+    }
+    return correct;
+}
+
+int scoreSheet(const AnswerKey& key, const AnswerSheet& sheet) {
+    if (key.uniformPoints) {
+        return key.points.empty() ? 0 : countCorrect(key, sheet) * key.points[0];
+    }
+
+    int words = (int)min(key.options.codes.size(), sheet.codes.size());
+    int score = 0;
+    for (int w = 0; w < words; w++) {
+        uint64_t lanes = matchingLanes(key, sheet, w);
+        while (lanes) {
+            score += key.points[w * LANES_PER_WORD + lowestBit(lanes) / 2];
+            lanes &= lanes - 1;
+        }
+    }
+    return score;
+}
+
+void correctLanes(const AnswerKey& key, const AnswerSheet& sheet, vector<uint64_t>& lanes) {
+    int words = (int)min(key.options.codes.size(), sheet.codes.size());
+    lanes.assign(words, 0);
+    for (int w = 0; w < words; w++) {
+        lanes[w] = matchingLanes(key, sheet, w);
+    }
+}
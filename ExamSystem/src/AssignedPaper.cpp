@@ -0,0 +1,3 @@
+#include "AssignedPaper.h"
+
+AssignedPaper::AssignedPaper() : userId(0), courseId(0) {}
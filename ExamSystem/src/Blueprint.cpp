@@ -0,0 +1,112 @@
+#include "Blueprint.h"
+#include <sstream>
+#include <cstdlib>
+#include <cctype>
+
+using namespace std;
+
+string topicKey(const string& topic) {
+    string key;
+    for (size_t i = 0; i < topic.size(); i++) {
+        key += (char)tolower((unsigned char)topic[i]);
+    }
+    return key;
+}
+
+BlueprintRow::BlueprintRow() : difficulty(DIFFICULTY_NONE), count(0) {}
+
+BlueprintRow::BlueprintRow(const string& rowTopic, int rowDifficulty, int rowCount)
+    : topic(rowTopic), difficulty(rowDifficulty), count(rowCount) {}
+
+bool BlueprintRow::matches(const string& questionTopic, int questionDifficulty) const {
+    if (difficulty != DIFFICULTY_NONE && difficulty != questionDifficulty) {
+        return false;
+    }
+    return topic.empty() || topicKey(topic) == topicKey(questionTopic);
+}
+
+string BlueprintRow::toString() const {
+    stringstream text;
+    text << count;
+    if (difficulty != DIFFICULTY_NONE) text << " " << difficultyName(difficulty);
+    if (!topic.empty()) text << " " << topic;
+    if (difficulty == DIFFICULTY_NONE && topic.empty()) text << " any";
+    return text.str();
+}
+
+int Blueprint::totalQuestions() const {
+    int total = 0;
+    for (size_t i = 0; i < rows.size(); i++) {
+        total += rows[i].count;
+    }
+    return total;
+}
+
+string Blueprint::toString() const {
+    string text;
+    for (size_t i = 0; i < rows.size(); i++) {
+        if (i > 0) text += ", ";
+        text += rows[i].toString();
+    }
+    return text;
+}
+
+bool Blueprint::parse(const string& text, Blueprint& blueprint, string& error) {
+    blueprint.rows.clear();
+    stringstream entries(text);
+    string entry;
+    while (getline(entries, entry, ',')) {
+        stringstream words(entry);
+        string word;
+        if (!(words >> word)) continue;
+        
+        char* end;
+        long count = strtol(word.c_str(), &end, 10);
+        if (*end != '\0' || count <= 0) {
+            error = "Expected a number of questions at \"" + word + "\"";
+            return false;
+        }
+        
+        BlueprintRow row;
+        row.count = (int)count;
+        string topic;
+        bool first = true;
+        while (words >> word) {
+            if (first && topicKey(word) == "any") {
+                // "5 any" or "5 any SQL": no difficulty given
+            } else if (first && parseDifficulty(word) > 0 && !isdigit((unsigned char)word[0])) {
+                row.difficulty = parseDifficulty(word);
+            } else {
+                if (!topic.empty()) topic += " ";
+                topic += word;
+            }
+            first = false;
+        }
+        row.topic = topic;
+        blueprint.rows.push_back(row);
+    }
+    if (blueprint.rows.empty()) {
+        error = "The blueprint has no entries";
+        return false;
+    }
+    return true;
+}
+
+bool Blueprint::fits(const vector<BlueprintRow>& strata, string& problem) const {
+    for (size_t i = 0; i < rows.size(); i++) {
+        int available = 0;
+        for (size_t s = 0; s < strata.size(); s++) {
+            if (rows[i].matches(strata[s].topic, strata[s].difficulty)) {
+                available += strata[s].count;
+            }
+        }
+        if (available < rows[i].count) {
+            stringstream text;
+            text << "\"" << rows[i].toString() << "\" needs " << rows[i].count
+                 << " questions but the course has " << available;
+            problem = text.str();
+            return false;
+        }
+    }
+    return true;
+}
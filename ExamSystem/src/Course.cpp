@@ -2,4 +2,4 @@
 
 Course::Course() 
     : id(0), timeAllocation(60), questionsPerExam(40), 
-      passingMark(40), totalQuestions(0) {}
\ No newline at end of file
+      passingMark(40), totalQuestions(0), selectionMode(SELECT_UNIFORM) {}
\ No newline at end of file
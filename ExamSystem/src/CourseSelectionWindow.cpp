@@ -5,6 +5,23 @@
 #include <FL/fl_ask.H>
 #include <cstdio>
 
+// Course list, read on the database worker
+struct CoursesJob {
+    CourseSelectionWindow* window;
+    vector<Course> courses;
+    string error;       // the hall server's reason, when it can't answer
+};
+
+static void runLoadCourses(DatabaseManager* db, void* data) {
+    CoursesJob* job = (CoursesJob*)data;
+    if (hallClient) {
+        job->courses = hallClient->getCourses();
+        if (job->courses.empty()) job->error = hallClient->getLastError();
+        return;
+    }
+    job->courses = db->getAllCourses();
+}
+
 void CourseSelectionWindow::continueCallback(Fl_Widget* w, void* data) {
     CourseSelectionWindow* csw = (CourseSelectionWindow*)data;
     
@@ -53,31 +70,25 @@ void CourseSelectionWindow::logoutCallback(Fl_Widget* w, void* data) {
     showLoginWindow();
 }
 
-CourseSelectionWindow::CourseSelectionWindow() {
-    window = new Fl_Window(700, 600, "Course Selection");
-    window->color(FL_WHITE);
-    
-    Fl_Box* title = new Fl_Box(200, 20, 300, 40, "Select Course for Examination");
-    title->labelsize(18);
-    title->labelfont(FL_BOLD);
-    title->labelcolor(FL_BLUE);
-    
-    Fl_Box* welcomeBox = new Fl_Box(50, 70, 600, 30);
-    string welcome = "Welcome, " + currentUser->username + "!";
-    welcomeBox->copy_label(welcome.c_str());
-    welcomeBox->labelsize(14);
-    welcomeBox->labelfont(FL_BOLD);
-    
-    Fl_Box* infoBox = new Fl_Box(50, 110, 600, 40);
-    infoBox->copy_label("Select a course below to begin your examination.\nExam settings are controlled by the administrator.");
-    infoBox->labelsize(12);
+void CourseSelectionWindow::coursesLoaded(void* data) {
+    CoursesJob* job = (CoursesJob*)data;
+    CourseSelectionWindow* csw = job->window;
+    csw->availableCourses.swap(job->courses);
+    string error = job->error;
+    delete job;
     
-    courseBrowser = new Fl_Hold_Browser(50, 170, 600, 330);
-    courseBrowser->textsize(12);
-    
-    availableCourses = dbManager->getAllCourses();
-    
-    if (availableCourses.empty()) {
+    csw->listCourses(error);
+    csw->continueBtn->activate();
+    csw->logoutBtn->activate();
+}
+
+void CourseSelectionWindow::listCourses(const string& error) {
+    courseBrowser->clear();
+    if (availableCourses.empty() && !error.empty()) {
+        courseBrowser->add("@C1@bCould not load the courses");
+        courseBrowser->add("");
+        courseBrowser->add(("@." + error).c_str());
+    } else if (availableCourses.empty()) {
         courseBrowser->add("@C1@bNo courses available");
         courseBrowser->add("");
         courseBrowser->add("Please contact your administrator to:");
@@ -116,18 +127,51 @@ CourseSelectionWindow::CourseSelectionWindow() {
             courseBrowser->add("   ========================================");
         }
     }
+}
+
+CourseSelectionWindow::CourseSelectionWindow() {
+    window = new Fl_Window(700, 600, "Course Selection");
+    window->color(FL_WHITE);
     
-    Fl_Button* continueBtn = new Fl_Button(250, 520, 200, 40, "Continue to Instructions");
+    Fl_Box* title = new Fl_Box(200, 20, 300, 40, "Select Course for Examination");
+    title->labelsize(18);
+    title->labelfont(FL_BOLD);
+    title->labelcolor(FL_BLUE);
+    
+    Fl_Box* welcomeBox = new Fl_Box(50, 70, 600, 30);
+    string welcome = "Welcome, " + currentUser->username + "!";
+    welcomeBox->copy_label(welcome.c_str());
+    welcomeBox->labelsize(14);
+    welcomeBox->labelfont(FL_BOLD);
+    
+    Fl_Box* infoBox = new Fl_Box(50, 110, 600, 40);
+    infoBox->copy_label("Select a course below to begin your examination.\nExam settings are controlled by the administrator.");
+    infoBox->labelsize(12);
+    
+    courseBrowser = new Fl_Hold_Browser(50, 170, 600, 330);
+    courseBrowser->textsize(12);
+    
+    courseBrowser->add("Loading courses...");
+    
+    continueBtn = new Fl_Button(250, 520, 200, 40, "Continue to Instructions");
     continueBtn->color(FL_GREEN);
     continueBtn->labelsize(13);
     continueBtn->labelfont(FL_BOLD);
     continueBtn->callback(continueCallback, this);
     
-    Fl_Button* logoutBtn = new Fl_Button(550, 520, 100, 40, "Logout");
+    logoutBtn = new Fl_Button(550, 520, 100, 40, "Logout");
     logoutBtn->color(FL_RED);
     logoutBtn->callback(logoutCallback, this);
     
     window->end();
+    
+    // Read on the database worker; a hall server may be slow to answer.
+    // The window can't be closed until the list is in.
+    continueBtn->deactivate();
+    logoutBtn->deactivate();
+    CoursesJob* job = new CoursesJob;
+    job->window = this;
+    dbWorker->post(runLoadCourses, coursesLoaded, job);
 }
 
 CourseSelectionWindow::~CourseSelectionWindow() {
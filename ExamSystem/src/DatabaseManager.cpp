@@ -1,40 +1,347 @@
 #include "DatabaseManager.h"
+#include "StatementCache.h"
+#include "QuestionSampler.h"
+#include "QueryStats.h"
 #include "Utils.h"
-#include <FL/fl_ask.H>
 #include <sstream>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <chrono>
+#include <algorithm>
 #include "Result.h"
 using namespace std;
 
-DatabaseManager::DatabaseManager(string path) : db(NULL), dbPath(path) {
+// Schema changes applied after createTables. Entry i moves the database
+// from PRAGMA user_version i to i + 1; append new steps, never edit old ones.
+static const char* schemaUpgrades[] = {
+    // 1: indexes for the hot access paths
+    "CREATE INDEX IF NOT EXISTS idx_questions_course ON questions(course_id);"
+    "CREATE INDEX IF NOT EXISTS idx_results_user_date ON results(user_id, date_time);"
+    "CREATE INDEX IF NOT EXISTS idx_results_date ON results(date_time);"
+    "CREATE INDEX IF NOT EXISTS idx_users_role ON users(role);",
+    
+    // 2: per-course question count kept exact by triggers, so listing the
+    //    catalogue does not touch the questions table
+    "ALTER TABLE courses ADD COLUMN question_count INTEGER NOT NULL DEFAULT 0;"
+    "UPDATE courses SET question_count = "
+    "(SELECT COUNT(*) FROM questions q WHERE q.course_id = courses.id);"
+    "CREATE TRIGGER IF NOT EXISTS trg_questions_insert AFTER INSERT ON questions BEGIN "
+    "UPDATE courses SET question_count = question_count + 1 WHERE id = NEW.course_id; END;"
+    "CREATE TRIGGER IF NOT EXISTS trg_questions_delete AFTER DELETE ON questions BEGIN "
+    "UPDATE courses SET question_count = question_count - 1 WHERE id = OLD.course_id; END;"
+    "CREATE TRIGGER IF NOT EXISTS trg_questions_move AFTER UPDATE OF course_id ON questions "
+    "WHEN OLD.course_id <> NEW.course_id BEGIN "
+    "UPDATE courses SET question_count = question_count - 1 WHERE id = OLD.course_id;"
+    "UPDATE courses SET question_count = question_count + 1 WHERE id = NEW.course_id; END;",
+    
+    // 3: results filtered by course, newest first
+    "CREATE INDEX IF NOT EXISTS idx_results_course_date ON results(course_id, date_time);",
+    
+    // 4: sortable columns and the pass/fail count of the admin results grid
+    "CREATE INDEX IF NOT EXISTS idx_results_username ON results(username);"
+    "CREATE INDEX IF NOT EXISTS idx_results_course_code ON results(course_code);"
+    "CREATE INDEX IF NOT EXISTS idx_results_percentage ON results(percentage);"
+    "CREATE INDEX IF NOT EXISTS idx_results_passed ON results(passed, date_time);",
+    
+    // 5: autosaved exam sittings. Answers are keyed by paper position so an
+    //    autosave rewrites only the rows that changed.
+    "CREATE TABLE IF NOT EXISTS exam_sessions ("
+    "id INTEGER PRIMARY KEY AUTOINCREMENT,"
+    "user_id INTEGER NOT NULL,"
+    "course_id INTEGER NOT NULL,"
+    "question_ids TEXT NOT NULL,"
+    "current_index INTEGER NOT NULL DEFAULT 0,"
+    "time_remaining INTEGER NOT NULL,"
+    "time_spent INTEGER NOT NULL DEFAULT 0,"
+    "status TEXT NOT NULL DEFAULT 'open',"
+    "started_at DATETIME DEFAULT CURRENT_TIMESTAMP,"
+    "updated_at DATETIME DEFAULT CURRENT_TIMESTAMP);"
+    "CREATE INDEX IF NOT EXISTS idx_sessions_user_status ON exam_sessions(user_id, status);"
+    "CREATE TABLE IF NOT EXISTS session_answers ("
+    "session_id INTEGER NOT NULL,"
+    "position INTEGER NOT NULL,"
+    "answer TEXT NOT NULL,"
+    "PRIMARY KEY (session_id, position)) WITHOUT ROWID;",
+    
+    // 6: the paper behind each result, for re-grading. Clustered by course
+    //    so a course's papers are read back in one sequential range.
+    "CREATE TABLE IF NOT EXISTS result_papers ("
+    "course_id INTEGER NOT NULL,"
+    "result_id INTEGER NOT NULL,"
+    "question_ids BLOB NOT NULL,"
+    "answers BLOB NOT NULL,"
+    "PRIMARY KEY (course_id, result_id)) WITHOUT ROWID;",
+    
+    // 7: papers drawn ahead of a sitting, read by primary key at exam start
+    "CREATE TABLE IF NOT EXISTS assigned_papers ("
+    "user_id INTEGER NOT NULL,"
+    "course_id INTEGER NOT NULL,"
+    "question_ids BLOB NOT NULL,"
+    "created_at DATETIME DEFAULT CURRENT_TIMESTAMP,"
+    "PRIMARY KEY (user_id, course_id)) WITHOUT ROWID;"
+    "CREATE INDEX IF NOT EXISTS idx_assigned_papers_course ON assigned_papers(course_id);",
+    
+    // 8: seeded papers. Every change to a course's questions bumps its pool
+    //    version; a snapshot of the pool is kept per version papers were
+    //    drawn from, so sittings and results store a seed instead of a list.
+    "ALTER TABLE courses ADD COLUMN pool_version INTEGER NOT NULL DEFAULT 1;"
+    "DROP TRIGGER IF EXISTS trg_questions_insert;"
+    "DROP TRIGGER IF EXISTS trg_questions_delete;"
+    "DROP TRIGGER IF EXISTS trg_questions_move;"
+    "CREATE TRIGGER trg_questions_insert AFTER INSERT ON questions BEGIN "
+    "UPDATE courses SET question_count = question_count + 1, pool_version = pool_version + 1 "
+    "WHERE id = NEW.course_id; END;"
+    "CREATE TRIGGER trg_questions_delete AFTER DELETE ON questions BEGIN "
+    "UPDATE courses SET question_count = question_count - 1, pool_version = pool_version + 1 "
+    "WHERE id = OLD.course_id; END;"
+    "CREATE TRIGGER trg_questions_move AFTER UPDATE OF course_id ON questions "
+    "WHEN OLD.course_id <> NEW.course_id BEGIN "
+    "UPDATE courses SET question_count = question_count - 1, pool_version = pool_version + 1 "
+    "WHERE id = OLD.course_id;"
+    "UPDATE courses SET question_count = question_count + 1, pool_version = pool_version + 1 "
+    "WHERE id = NEW.course_id; END;"
+    "CREATE TABLE IF NOT EXISTS pool_snapshots ("
+    "course_id INTEGER NOT NULL,"
+    "version INTEGER NOT NULL,"
+    "question_ids BLOB NOT NULL,"
+    "created_at DATETIME DEFAULT CURRENT_TIMESTAMP,"
+    "PRIMARY KEY (course_id, version)) WITHOUT ROWID;"
+    "ALTER TABLE exam_sessions ADD COLUMN pool_version INTEGER NOT NULL DEFAULT 0;"
+    "ALTER TABLE exam_sessions ADD COLUMN paper_seed INTEGER NOT NULL DEFAULT 0;"
+    "ALTER TABLE exam_sessions ADD COLUMN question_count INTEGER NOT NULL DEFAULT 0;"
+    "ALTER TABLE result_papers ADD COLUMN pool_version INTEGER NOT NULL DEFAULT 0;"
+    "ALTER TABLE result_papers ADD COLUMN paper_seed INTEGER NOT NULL DEFAULT 0;"
+    "ALTER TABLE result_papers ADD COLUMN question_count INTEGER NOT NULL DEFAULT 0;",
+    
+    // 9: exposure control. Every sitting opened counts once against each
+    //    question on its paper; a course can ask for balanced draws.
+    "ALTER TABLE questions ADD COLUMN exposure_count INTEGER NOT NULL DEFAULT 0;"
+    "ALTER TABLE courses ADD COLUMN selection_mode INTEGER NOT NULL DEFAULT 0;",
+    
+    // 10: topic and difficulty per question, and per-course blueprints of
+    //     how many questions of each a paper takes
+    "ALTER TABLE questions ADD COLUMN topic TEXT NOT NULL DEFAULT '';"
+    "ALTER TABLE questions ADD COLUMN difficulty INTEGER NOT NULL DEFAULT 0;"
+    "CREATE INDEX IF NOT EXISTS idx_questions_strata ON questions(course_id, topic, difficulty);"
+    "CREATE TABLE IF NOT EXISTS course_blueprints ("
+    "course_id INTEGER NOT NULL,"
+    "position INTEGER NOT NULL,"
+    "topic TEXT NOT NULL,"
+    "difficulty INTEGER NOT NULL,"
+    "question_count INTEGER NOT NULL,"
+    "PRIMARY KEY (course_id, position)) WITHOUT ROWID;",
+    
+    // 11: papers whose options were shown in orders derived from paper_seed
+    "ALTER TABLE exam_sessions ADD COLUMN shuffled_options INTEGER NOT NULL DEFAULT 0;"
+    "ALTER TABLE result_papers ADD COLUMN shuffled_options INTEGER NOT NULL DEFAULT 0;",
+    
+    // 12: papers planned per seat of a hall, read by key when a sitting
+    //    opens at the seat
+    "CREATE TABLE IF NOT EXISTS seat_papers ("
+    "course_id INTEGER NOT NULL,"
+    "seat_row INTEGER NOT NULL,"
+    "seat_column INTEGER NOT NULL,"
+    "question_ids BLOB NOT NULL,"
+    "option_seed INTEGER NOT NULL,"
+    "created_at DATETIME DEFAULT CURRENT_TIMESTAMP,"
+    "PRIMARY KEY (course_id, seat_row, seat_column)) WITHOUT ROWID;",
+    
+    // 13: which pool versions sittings and results still refer to, so
+    //     unreferenced snapshots can be pruned
+    "CREATE INDEX IF NOT EXISTS idx_sessions_course_pool ON exam_sessions(course_id, pool_version);"
+    "CREATE INDEX IF NOT EXISTS idx_result_papers_pool ON result_papers(course_id, pool_version);"
+};
+
+// BLOB columns of ids and answer words are little-endian whatever the host,
+// so a database file can move between machines. Blobs are copied out, never
+// cast in place: SQLite makes no promise about their alignment.
+static bool hostIsLittleEndian() {
+    const uint16_t one = 1;
+    unsigned char first;
+    memcpy(&first, &one, 1);
+    return first == 1;
+}
+
+static void packIds(const vector<int>& ids, vector<unsigned char>& bytes) {
+    bytes.resize(ids.size() * 4);
+    if (hostIsLittleEndian()) {
+        if (!ids.empty()) memcpy(&bytes[0], &ids[0], bytes.size());
+        return;
+    }
+    for (size_t i = 0; i < ids.size(); i++) {
+        uint32_t v = (uint32_t)ids[i];
+        for (int b = 0; b < 4; b++) bytes[4 * i + b] = (unsigned char)(v >> (8 * b));
+    }
+}
+
+// False if the blob isn't a whole number of ids
+static bool unpackIds(const void* blob, int bytes, vector<int>& ids) {
+    ids.clear();
+    if (bytes % 4 != 0) return false;
+    if (!blob || bytes == 0) return true;
+    ids.resize(bytes / 4);
+    if (hostIsLittleEndian()) {
+        memcpy(&ids[0], blob, bytes);
+        return true;
+    }
+    const unsigned char* p = (const unsigned char*)blob;
+    for (size_t i = 0; i < ids.size(); i++, p += 4) {
+        ids[i] = (int)((uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+                       ((uint32_t)p[3] << 24));
+    }
+    return true;
+}
+
+static void packWords(const vector<uint64_t>& words, vector<unsigned char>& bytes) {
+    bytes.resize(words.size() * 8);
+    if (hostIsLittleEndian()) {
+        if (!words.empty()) memcpy(&bytes[0], &words[0], bytes.size());
+        return;
+    }
+    for (size_t i = 0; i < words.size(); i++) {
+        for (int b = 0; b < 8; b++) bytes[8 * i + b] = (unsigned char)(words[i] >> (8 * b));
+    }
+}
+
+static void unpackWords(const void* blob, size_t count, vector<uint64_t>& words) {
+    words.resize(count);
+    if (count == 0) return;
+    if (hostIsLittleEndian()) {
+        memcpy(&words[0], blob, count * 8);
+        return;
+    }
+    const unsigned char* p = (const unsigned char*)blob;
+    for (size_t i = 0; i < count; i++, p += 8) {
+        uint64_t v = 0;
+        for (int b = 7; b >= 0; b--) v = (v << 8) | p[b];
+        words[i] = v;
+    }
+}
+
+// An empty list is stored as an empty blob, not NULL
+static void bindBytes(sqlite3_stmt* stmt, int index, const vector<unsigned char>& bytes) {
+    if (bytes.empty()) {
+        sqlite3_bind_zeroblob(stmt, index, 0);
+    } else {
+        sqlite3_bind_blob(stmt, index, &bytes[0], (int)bytes.size(), SQLITE_TRANSIENT);
+    }
+}
+
+DatabaseManager::DatabaseManager(string path, StorageProfile profile)
+    : db(NULL), stmtCache(NULL), sampler(NULL), dbPath(path),
+      storageProfile(profile), ready(false) {
     initDatabase();
 }
 
 DatabaseManager::~DatabaseManager() {
+    // Cached statements must be finalized before the connection can close
+    delete sampler;
+    delete stmtCache;
     if (db) {
+        // Refreshes planner statistics for tables whose indexes were used
+        sqlite3_exec(db, "PRAGMA optimize", NULL, 0, NULL);
         sqlite3_close(db);
     }
 }
 bool DatabaseManager::initDatabase() {
     int rc = sqlite3_open(dbPath.c_str(), &db);
+    stmtCache = new StatementCache(db);
+    sampler = new QuestionSampler(db, stmtCache);
     if (rc) {
         char errMsg[300];
         sprintf(errMsg, "Cannot open database: %s\nPath: %s", 
                sqlite3_errmsg(db), dbPath.c_str());
-        fl_alert("%s", errMsg);
+        lastError = errMsg;
         return false;
     }
     
-    char successMsg[300];
-    sprintf(successMsg, "Database initialized successfully!\nPath: %s", dbPath.c_str());
-    fl_message("%s", successMsg);
+    if (!storageProfile.apply(db, lastError)) {
+        return false;
+    }
     
-    createTables();
+    if (!createTables() || !upgradeSchema()) {
+        return false;
+    }
     insertDefaultData();
+    ready = true;
     return true;
 }
 
-void DatabaseManager::createTables() {
+bool DatabaseManager::isReady() {
+    return ready;
+}
+
+string DatabaseManager::getLastError() {
+    return lastError;
+}
+
+string DatabaseManager::getDatabasePath() {
+    return dbPath;
+}
+
+const StorageProfile& DatabaseManager::getStorageProfile() {
+    return storageProfile;
+}
+
+StatementCache* DatabaseManager::getStatementCache() {
+    return stmtCache;
+}
+
+bool DatabaseManager::execCached(const char* sql) {
+    sqlite3_stmt* stmt = stmtCache->acquire(sql);
+    if (stmt) {
+        int result = sqlite3_step(stmt);
+        stmtCache->release(stmt);
+        if (result == SQLITE_DONE) {
+            return true;
+        }
+    }
+    lastError = sqlite3_errmsg(db);
+    return false;
+}
+
+int DatabaseManager::stepWrite(sqlite3_stmt* stmt) {
+    if (!sqlite3_get_autocommit(db)) {
+        return sqlite3_step(stmt);
+    }
+    
+    // Take the write lock before reading anything. An autocommit write that
+    // has to upgrade from a read lock can get SQLITE_BUSY without the busy
+    // handler ever running; BEGIN IMMEDIATE waits through the handler instead.
+    if (!beginTransaction()) {
+        return SQLITE_BUSY;
+    }
+    int result = sqlite3_step(stmt);
+    if (result == SQLITE_DONE && !commitTransaction()) {
+        result = sqlite3_errcode(db);
+    }
+    if (result != SQLITE_DONE) {
+        rollbackTransaction();
+    }
+    return result;
+}
+
+bool DatabaseManager::beginTransaction() {
+    // Includes the wait for the write lock
+    QUERY_TIMER(QOP_BEGIN);
+    return execCached("BEGIN IMMEDIATE");
+}
+
+bool DatabaseManager::commitTransaction() {
+    QUERY_TIMER(QOP_COMMIT);
+    return execCached("COMMIT");
+}
+
+void DatabaseManager::rollbackTransaction() {
+    QUERY_TIMER(QOP_ROLLBACK);
+    execCached("ROLLBACK");
+    // Ids added to the sampler pools inside the transaction no longer exist
+    sampler->invalidate();
+}
+
+bool DatabaseManager::createTables() {
     const char* sqlUsers = 
         "CREATE TABLE IF NOT EXISTS users ("
         "id INTEGER PRIMARY KEY AUTOINCREMENT,"
@@ -88,70 +395,136 @@ void DatabaseManager::createTables() {
     
     rc = sqlite3_exec(db, sqlUsers, NULL, 0, &errMsg);
     if (rc != SQLITE_OK) {
-        fl_alert("Error creating users table: %s", errMsg);
+        lastError = string("Error creating users table: ") + errMsg;
         sqlite3_free(errMsg);
+        return false;
     }
     
     rc = sqlite3_exec(db, sqlCourses, NULL, 0, &errMsg);
     if (rc != SQLITE_OK) {
-        fl_alert("Error creating courses table: %s", errMsg);
+        lastError = string("Error creating courses table: ") + errMsg;
         sqlite3_free(errMsg);
+        return false;
     }
     
     rc = sqlite3_exec(db, sqlQuestions, NULL, 0, &errMsg);
     if (rc != SQLITE_OK) {
-        fl_alert("Error creating questions table: %s", errMsg);
+        lastError = string("Error creating questions table: ") + errMsg;
         sqlite3_free(errMsg);
+        return false;
     }
     
     rc = sqlite3_exec(db, sqlResults, NULL, 0, &errMsg);
     if (rc != SQLITE_OK) {
-        fl_alert("Error creating results table: %s", errMsg);
+        lastError = string("Error creating results table: ") + errMsg;
         sqlite3_free(errMsg);
+        return false;
     }
+    return true;
 }
 
-void DatabaseManager::insertDefaultData() {
+int DatabaseManager::getSchemaVersion() {
+    int version = 0;
+    sqlite3_stmt* stmt = stmtCache->acquire("PRAGMA user_version");
+    if (stmt) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            version = sqlite3_column_int(stmt, 0);
+        }
+        stmtCache->release(stmt);
+    }
+    return version;
+}
+
+bool DatabaseManager::upgradeSchema() {
+    int target = sizeof(schemaUpgrades) / sizeof(schemaUpgrades[0]);
+    if (getSchemaVersion() >= target) {
+        return true;
+    }
+    
+    if (!beginTransaction()) {
+        return false;
+    }
+    
+    // Read again under the write lock: another process may have upgraded
+    for (int version = getSchemaVersion(); version < target; version++) {
+        char setVersion[64];
+        sprintf(setVersion, "PRAGMA user_version = %d", version + 1);
+        
+        char* errMsg = 0;
+        if (sqlite3_exec(db, schemaUpgrades[version], NULL, 0, &errMsg) != SQLITE_OK ||
+            sqlite3_exec(db, setVersion, NULL, 0, &errMsg) != SQLITE_OK) {
+            char msg[100];
+            sprintf(msg, "Error upgrading schema to version %d: ", version + 1);
+            lastError = string(msg) + (errMsg ? errMsg : "");
+            sqlite3_free(errMsg);
+            rollbackTransaction();
+            return false;
+        }
+    }
+    return commitTransaction();
+}
+
+string DatabaseManager::explainQueryPlan(const string& sql) {
+    string plan;
     sqlite3_stmt* stmt;
+    string explain = "EXPLAIN QUERY PLAN " + sql;
+    
+    if (sqlite3_prepare_v2(db, explain.c_str(), -1, &stmt, 0) == SQLITE_OK) {
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            plan += string((char*)sqlite3_column_text(stmt, 3)) + "\n";
+        }
+        sqlite3_finalize(stmt);
+    } else {
+        plan = string("ERROR ") + sqlite3_errmsg(db) + "\n";
+    }
+    return plan;
+}
+
+void DatabaseManager::insertDefaultData() {
     const char* checkAdmin = "SELECT COUNT(*) FROM users WHERE role='admin'";
     
-    if (sqlite3_prepare_v2(db, checkAdmin, -1, &stmt, 0) == SQLITE_OK) {
+    sqlite3_stmt* stmt = stmtCache->acquire(checkAdmin);
+    if (stmt) {
+        int count = -1;
         if (sqlite3_step(stmt) == SQLITE_ROW) {
-            int count = sqlite3_column_int(stmt, 0);
-            if (count == 0) {
-                addUser("admin", "admin123", "admin");
-                addUser("student1", "pass123", "candidate");
-            }
+            count = sqlite3_column_int(stmt, 0);
+        }
+        stmtCache->release(stmt);
+        
+        if (count == 0) {
+            addUser("admin", "admin123", "admin");
+            addUser("student1", "pass123", "candidate");
         }
-        sqlite3_finalize(stmt);
     }
 }
 
 
 bool DatabaseManager::addUser(string username, string password, string role) {
+    QUERY_TIMER(QOP_ADD_USER);
     string passwordHash = sha256(password);
     const char* sql = "INSERT INTO users (username, password_hash, role) VALUES (?, ?, ?)";
-    sqlite3_stmt* stmt;
     
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, 0) == SQLITE_OK) {
+    sqlite3_stmt* stmt = stmtCache->acquire(sql);
+    if (stmt) {
         sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_TRANSIENT);
         sqlite3_bind_text(stmt, 2, passwordHash.c_str(), -1, SQLITE_TRANSIENT);
         sqlite3_bind_text(stmt, 3, role.c_str(), -1, SQLITE_TRANSIENT);
         
-        int result = sqlite3_step(stmt);
-        sqlite3_finalize(stmt);
+        int result = stepWrite(stmt);
+        stmtCache->release(stmt);
         return result == SQLITE_DONE;
     }
     return false;
 }
 
 User* DatabaseManager::authenticateUser(string username, string password) {
+    QUERY_TIMER(QOP_AUTHENTICATE_USER);
     string passwordHash = sha256(password);
     const char* sql = "SELECT id, username, password_hash, role, login_attempts "
                      "FROM users WHERE username = ?";
-    sqlite3_stmt* stmt;
     
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, 0) == SQLITE_OK) {
+    sqlite3_stmt* stmt = stmtCache->acquire(sql);
+    if (stmt) {
         sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_TRANSIENT);
         
         if (sqlite3_step(stmt) == SQLITE_ROW) {
@@ -162,7 +535,7 @@ User* DatabaseManager::authenticateUser(string username, string password) {
             user->role = string((char*)sqlite3_column_text(stmt, 3));
             user->loginAttempts = sqlite3_column_int(stmt, 4);
             
-            sqlite3_finalize(stmt);
+            stmtCache->release(stmt);
             
             if (user->loginAttempts >= 5) {
                 delete user;
@@ -171,6 +544,7 @@ User* DatabaseManager::authenticateUser(string username, string password) {
             
             if (storedHash == passwordHash) {
                 resetLoginAttempts(username);
+                QUERY_ROWS(1);
                 return user;
             } else {
                 incrementLoginAttempts(username);
@@ -178,59 +552,114 @@ User* DatabaseManager::authenticateUser(string username, string password) {
                 return NULL;
             }
         }
-        sqlite3_finalize(stmt);
+        stmtCache->release(stmt);
     }
     return NULL;
 }
 
+int DatabaseManager::getUserIdByUsername(string username) {
+    QUERY_TIMER(QOP_GET_USER_ID);
+    const char* sql = "SELECT id FROM users WHERE username = ?";
+    int id = 0;
+    
+    sqlite3_stmt* stmt = stmtCache->acquire(sql);
+    if (stmt) {
+        sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_TRANSIENT);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            id = sqlite3_column_int(stmt, 0);
+        }
+        stmtCache->release(stmt);
+    }
+    QUERY_ROWS(id > 0 ? 1 : 0);
+    return id;
+}
+
+vector<int> DatabaseManager::getUserIdsByRole(const string& role) {
+    QUERY_TIMER(QOP_USERS_BY_ROLE);
+    const char* sql = "SELECT id FROM users WHERE role = ? ORDER BY id";
+    vector<int> ids;
+    
+    sqlite3_stmt* stmt = stmtCache->acquire(sql);
+    if (stmt) {
+        sqlite3_bind_text(stmt, 1, role.c_str(), -1, SQLITE_TRANSIENT);
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            ids.push_back(sqlite3_column_int(stmt, 0));
+        }
+        stmtCache->release(stmt);
+    }
+    QUERY_ROWS(ids.size());
+    return ids;
+}
+
 void DatabaseManager::incrementLoginAttempts(string username) {
+    QUERY_TIMER(QOP_LOGIN_ATTEMPTS);
     const char* sql = "UPDATE users SET login_attempts = login_attempts + 1 WHERE username = ?";
-    sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, 0) == SQLITE_OK) {
+    sqlite3_stmt* stmt = stmtCache->acquire(sql);
+    if (stmt) {
         sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_TRANSIENT);
-        sqlite3_step(stmt);
-        sqlite3_finalize(stmt);
+        stepWrite(stmt);
+        stmtCache->release(stmt);
     }
 }
 
 void DatabaseManager::resetLoginAttempts(string username) {
+    QUERY_TIMER(QOP_LOGIN_ATTEMPTS);
     const char* sql = "UPDATE users SET login_attempts = 0 WHERE username = ?";
-    sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, 0) == SQLITE_OK) {
+    sqlite3_stmt* stmt = stmtCache->acquire(sql);
+    if (stmt) {
         sqlite3_bind_text(stmt, 1, username.c_str(), -1, SQLITE_TRANSIENT);
-        sqlite3_step(stmt);
-        sqlite3_finalize(stmt);
+        stepWrite(stmt);
+        stmtCache->release(stmt);
     }
 }
 
-bool DatabaseManager::addCourse(string code, string title, int time, int questionsCount, int passing) {
+bool DatabaseManager::addCourse(string code, string title, int time, int questionsCount, int passing,
+                                SelectionMode mode) {
+    QUERY_TIMER(QOP_ADD_COURSE);
     const char* sql = "INSERT INTO courses (course_code, course_title, time_allocation, "
-                     "questions_per_exam, passing_mark) VALUES (?, ?, ?, ?, ?)";
-    sqlite3_stmt* stmt;
+                     "questions_per_exam, passing_mark, selection_mode) VALUES (?, ?, ?, ?, ?, ?)";
     
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, 0) == SQLITE_OK) {
+    sqlite3_stmt* stmt = stmtCache->acquire(sql);
+    if (stmt) {
         sqlite3_bind_text(stmt, 1, code.c_str(), -1, SQLITE_TRANSIENT);
         sqlite3_bind_text(stmt, 2, title.c_str(), -1, SQLITE_TRANSIENT);
         sqlite3_bind_int(stmt, 3, time);
         sqlite3_bind_int(stmt, 4, questionsCount);
         sqlite3_bind_int(stmt, 5, passing);
+        sqlite3_bind_int(stmt, 6, (int)mode);
         
-        int result = sqlite3_step(stmt);
-        sqlite3_finalize(stmt);
+        int result = stepWrite(stmt);
+        stmtCache->release(stmt);
         return result == SQLITE_DONE;
     }
     return false;
 }
 
+bool DatabaseManager::setSelectionMode(int courseId, SelectionMode mode) {
+    QUERY_TIMER(QOP_SET_SELECTION_MODE);
+    const char* sql = "UPDATE courses SET selection_mode = ? WHERE id = ?";
+    
+    sqlite3_stmt* stmt = stmtCache->acquire(sql);
+    if (stmt) {
+        sqlite3_bind_int(stmt, 1, (int)mode);
+        sqlite3_bind_int(stmt, 2, courseId);
+        
+        int result = stepWrite(stmt);
+        stmtCache->release(stmt);
+        return result == SQLITE_DONE && sqlite3_changes(db) > 0;
+    }
+    return false;
+}
+
 vector<Course> DatabaseManager::getAllCourses() {
+    QUERY_TIMER(QOP_GET_ALL_COURSES);
     vector<Course> courses;
-    const char* sql = "SELECT c.id, c.course_code, c.course_title, c.time_allocation, "
-                     "c.questions_per_exam, c.passing_mark, COUNT(q.id) as total_questions "
-                     "FROM courses c LEFT JOIN questions q ON c.id = q.course_id "
-                     "GROUP BY c.id ORDER BY c.course_code";
-    sqlite3_stmt* stmt;
+    const char* sql = "SELECT id, course_code, course_title, time_allocation, "
+                     "questions_per_exam, passing_mark, question_count, selection_mode "
+                     "FROM courses ORDER BY course_code";
     
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, 0) == SQLITE_OK) {
+    sqlite3_stmt* stmt = stmtCache->acquire(sql);
+    if (stmt) {
         while (sqlite3_step(stmt) == SQLITE_ROW) {
             Course c;
             c.id = sqlite3_column_int(stmt, 0);
@@ -240,21 +669,23 @@ vector<Course> DatabaseManager::getAllCourses() {
             c.questionsPerExam = sqlite3_column_int(stmt, 4);
             c.passingMark = sqlite3_column_int(stmt, 5);
             c.totalQuestions = sqlite3_column_int(stmt, 6);
+            c.selectionMode = (SelectionMode)sqlite3_column_int(stmt, 7);
             courses.push_back(c);
         }
-        sqlite3_finalize(stmt);
+        stmtCache->release(stmt);
     }
+    QUERY_ROWS(courses.size());
     return courses;
 }
 
 Course* DatabaseManager::getCourseById(int courseId) {
-    const char* sql = "SELECT c.id, c.course_code, c.course_title, c.time_allocation, "
-                     "c.questions_per_exam, c.passing_mark, COUNT(q.id) as total_questions "
-                     "FROM courses c LEFT JOIN questions q ON c.id = q.course_id "
-                     "WHERE c.id = ? GROUP BY c.id";
-    sqlite3_stmt* stmt;
+    QUERY_TIMER(QOP_GET_COURSE);
+    const char* sql = "SELECT id, course_code, course_title, time_allocation, "
+                     "questions_per_exam, passing_mark, question_count, selection_mode "
+                     "FROM courses WHERE id = ?";
     
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, 0) == SQLITE_OK) {
+    sqlite3_stmt* stmt = stmtCache->acquire(sql);
+    if (stmt) {
         sqlite3_bind_int(stmt, 1, courseId);
         
         if (sqlite3_step(stmt) == SQLITE_ROW) {
@@ -266,65 +697,131 @@ Course* DatabaseManager::getCourseById(int courseId) {
             c->questionsPerExam = sqlite3_column_int(stmt, 4);
             c->passingMark = sqlite3_column_int(stmt, 5);
             c->totalQuestions = sqlite3_column_int(stmt, 6);
-            sqlite3_finalize(stmt);
+            c->selectionMode = (SelectionMode)sqlite3_column_int(stmt, 7);
+            stmtCache->release(stmt);
+            QUERY_ROWS(1);
             return c;
         }
-        sqlite3_finalize(stmt);
+        stmtCache->release(stmt);
     }
     return NULL;
 }
 
 int DatabaseManager::getCourseIdByCode(string code) {
+    QUERY_TIMER(QOP_GET_COURSE_ID);
     const char* sql = "SELECT id FROM courses WHERE course_code = ?";
-    sqlite3_stmt* stmt;
     int id = 0;
     
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, 0) == SQLITE_OK) {
+    sqlite3_stmt* stmt = stmtCache->acquire(sql);
+    if (stmt) {
         sqlite3_bind_text(stmt, 1, code.c_str(), -1, SQLITE_TRANSIENT);
         if (sqlite3_step(stmt) == SQLITE_ROW) {
             id = sqlite3_column_int(stmt, 0);
         }
-        sqlite3_finalize(stmt);
+        stmtCache->release(stmt);
     }
+    QUERY_ROWS(id > 0 ? 1 : 0);
     return id;
 }
 
 
 bool DatabaseManager::addQuestion(int courseId, string qText, string optA, string optB, 
                 string optC, string optD, string correct, int pts) {
+    QUERY_TIMER(QOP_ADD_QUESTION);
+    Question q;
+    q.courseId = courseId;
+    q.questionText = qText;
+    q.optionA = optA;
+    q.optionB = optB;
+    q.optionC = optC;
+    q.optionD = optD;
+    q.correctAnswer = correct;
+    q.points = pts;
+    return insertQuestion(q);
+}
+
+bool DatabaseManager::insertQuestion(const Question& q) {
     const char* sql = "INSERT INTO questions (course_id, question_text, option_a, "
-                     "option_b, option_c, option_d, correct_answer, points) "
-                     "VALUES (?, ?, ?, ?, ?, ?, ?, ?)";
-    sqlite3_stmt* stmt;
+                     "option_b, option_c, option_d, correct_answer, points, topic, difficulty) "
+                     "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
     
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, 0) == SQLITE_OK) {
-        sqlite3_bind_int(stmt, 1, courseId);
-        sqlite3_bind_text(stmt, 2, qText.c_str(), -1, SQLITE_TRANSIENT);
-        sqlite3_bind_text(stmt, 3, optA.c_str(), -1, SQLITE_TRANSIENT);
-        sqlite3_bind_text(stmt, 4, optB.c_str(), -1, SQLITE_TRANSIENT);
-        sqlite3_bind_text(stmt, 5, optC.c_str(), -1, SQLITE_TRANSIENT);
-        sqlite3_bind_text(stmt, 6, optD.c_str(), -1, SQLITE_TRANSIENT);
-        sqlite3_bind_text(stmt, 7, correct.c_str(), -1, SQLITE_TRANSIENT);
-        sqlite3_bind_int(stmt, 8, pts);
+    sqlite3_stmt* stmt = stmtCache->acquire(sql);
+    if (stmt) {
+        sqlite3_bind_int(stmt, 1, q.courseId);
+        sqlite3_bind_text(stmt, 2, q.questionText.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 3, q.optionA.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 4, q.optionB.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 5, q.optionC.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 6, q.optionD.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 7, q.correctAnswer.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 8, q.points);
+        sqlite3_bind_text(stmt, 9, q.topic.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 10, q.difficulty);
         
-        int result = sqlite3_step(stmt);
-        sqlite3_finalize(stmt);
+        int result = stepWrite(stmt);
+        stmtCache->release(stmt);
         return result == SQLITE_DONE;
     }
     return false;
 }
 
-vector<Question> DatabaseManager::getRandomQuestions(int courseId, int count) {
-    vector<Question> questions;
-    const char* sql = "SELECT * FROM questions WHERE course_id = ? ORDER BY RANDOM() LIMIT ?";
-    sqlite3_stmt* stmt;
+int DatabaseManager::addQuestions(const vector<Question>& questions, ImportStats* stats,
+                                  int chunkSize) {
+    QUERY_TIMER(QOP_ADD_QUESTIONS);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    int inserted = 0;
+    int failed = 0;
     
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, 0) == SQLITE_OK) {
-        sqlite3_bind_int(stmt, 1, courseId);
-        sqlite3_bind_int(stmt, 2, count);
+    if (chunkSize <= 0) chunkSize = 1000;
+    
+    size_t i = 0;
+    while (i < questions.size()) {
+        size_t chunkEnd = min(i + (size_t)chunkSize, questions.size());
         
-        while (sqlite3_step(stmt) == SQLITE_ROW) {
-            Question q;
+        if (!beginTransaction()) {
+            failed += (int)(questions.size() - i);
+            break;
+        }
+        
+        int chunkInserted = 0;
+        for (; i < chunkEnd; i++) {
+            if (insertQuestion(questions[i])) {
+                chunkInserted++;
+            } else {
+                failed++;
+            }
+        }
+        
+        if (commitTransaction()) {
+            inserted += chunkInserted;
+        } else {
+            rollbackTransaction();
+            failed += chunkInserted;
+        }
+    }
+    
+    if (stats) {
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        stats->inserted = inserted;
+        stats->failed = failed;
+        stats->seconds = elapsed.count();
+        stats->rowsPerSecond = stats->seconds > 0 ? inserted / stats->seconds : 0;
+    }
+    QUERY_ROWS(inserted);
+    return inserted;
+}
+
+bool DatabaseManager::getQuestionById(int questionId, Question& q) {
+    const char* sql = "SELECT id, course_id, question_text, option_a, option_b, "
+                     "option_c, option_d, correct_answer, points, topic, difficulty "
+                     "FROM questions WHERE id = ?";
+    bool found = false;
+    
+    sqlite3_stmt* stmt = stmtCache->acquire(sql);
+    if (stmt) {
+        sqlite3_bind_int(stmt, 1, questionId);
+        
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
             q.id = sqlite3_column_int(stmt, 0);
             q.courseId = sqlite3_column_int(stmt, 1);
             q.questionText = string((char*)sqlite3_column_text(stmt, 2));
@@ -334,24 +831,433 @@ vector<Question> DatabaseManager::getRandomQuestions(int courseId, int count) {
             q.optionD = string((char*)sqlite3_column_text(stmt, 6));
             q.correctAnswer = string((char*)sqlite3_column_text(stmt, 7));
             q.points = sqlite3_column_int(stmt, 8);
+            q.topic = string((char*)sqlite3_column_text(stmt, 9));
+            q.difficulty = sqlite3_column_int(stmt, 10);
+            found = true;
+        }
+        stmtCache->release(stmt);
+    }
+    return found;
+}
+
+vector<Question> DatabaseManager::getQuestionsByIds(const vector<int>& ids) {
+    QUERY_TIMER(QOP_GET_QUESTIONS_BY_IDS);
+    vector<Question> questions;
+    questions.reserve(ids.size());
+    for (size_t i = 0; i < ids.size(); i++) {
+        Question q;
+        if (getQuestionById(ids[i], q)) {
             questions.push_back(q);
         }
-        sqlite3_finalize(stmt);
     }
+    QUERY_ROWS(questions.size());
+    return questions;
+}
+
+vector<Question> DatabaseManager::getRandomQuestions(int courseId, int count, SelectionMode mode) {
+    QUERY_TIMER(QOP_GET_RANDOM_QUESTIONS);
+    // Ids come from the in-memory pool; only the chosen rows are read
+    vector<int> ids = sampler->sample(courseId, count, mode);
+    vector<Question> questions = getQuestionsByIds(ids);
+    
+    // A question vanished under us: reload the pool and draw again
+    if (questions.size() < ids.size()) {
+        sampler->invalidate(courseId);
+        questions = getQuestionsByIds(sampler->sample(courseId, count, mode));
+    }
+    QUERY_ROWS(questions.size());
+    return questions;
+}
+
+int DatabaseManager::getPoolVersion(int courseId) {
+    QUERY_TIMER(QOP_POOL_VERSION);
+    const char* sql = "SELECT pool_version FROM courses WHERE id = ?";
+    int version = 0;
+    
+    sqlite3_stmt* stmt = stmtCache->acquire(sql);
+    if (stmt) {
+        sqlite3_bind_int(stmt, 1, courseId);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            version = sqlite3_column_int(stmt, 0);
+        }
+        stmtCache->release(stmt);
+    }
+    return version;
+}
+
+// Snapshots never change once written, so each connection caches the ones
+// it has read. A missing snapshot of the current version is taken now; an
+// older one can't be rebuilt and is reported as missing.
+const vector<int>* DatabaseManager::loadPoolSnapshot(int courseId, int version) {
+    long long key = ((long long)courseId << 32) | (unsigned int)version;
+    map<long long, vector<int> >::iterator it = poolSnapshots.find(key);
+    if (it != poolSnapshots.end()) {
+        return &it->second;
+    }
+    
+    const char* sql = "SELECT question_ids FROM pool_snapshots WHERE course_id = ? AND version = ?";
+    bool found = false;
+    vector<int> ids;
+    sqlite3_stmt* stmt = stmtCache->acquire(sql);
+    if (stmt) {
+        sqlite3_bind_int(stmt, 1, courseId);
+        sqlite3_bind_int(stmt, 2, version);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            found = unpackIds(sqlite3_column_blob(stmt, 0), sqlite3_column_bytes(stmt, 0), ids);
+        }
+        stmtCache->release(stmt);
+    }
+    
+    if (!found) {
+        // Version and ids read under the write lock, so they agree
+        bool ownTransaction = sqlite3_get_autocommit(db) != 0;
+        if (ownTransaction && !beginTransaction()) {
+            return NULL;
+        }
+        bool ok = getPoolVersion(courseId) == version;
+        if (ok) {
+            const char* idSql = "SELECT id FROM questions WHERE course_id = ? ORDER BY id";
+            stmt = stmtCache->acquire(idSql);
+            ok = stmt != NULL;
+            if (ok) {
+                sqlite3_bind_int(stmt, 1, courseId);
+                while (sqlite3_step(stmt) == SQLITE_ROW) {
+                    ids.push_back(sqlite3_column_int(stmt, 0));
+                }
+                stmtCache->release(stmt);
+            }
+        }
+        if (ok) {
+            ok = savePoolSnapshot(courseId, version, ids);
+        }
+        if (ownTransaction) {
+            if (ok) {
+                ok = commitTransaction();
+            }
+            if (!ok) {
+                rollbackTransaction();
+            }
+        }
+        if (!ok) {
+            return NULL;
+        }
+    }
+    
+    vector<int>& cached = poolSnapshots[key];
+    cached.swap(ids);
+    return &cached;
+}
+
+bool DatabaseManager::savePoolSnapshot(int courseId, int version, const vector<int>& ids) {
+    const char* insertSql = "INSERT OR IGNORE INTO pool_snapshots "
+                           "(course_id, version, question_ids) VALUES (?, ?, ?)";
+    sqlite3_stmt* stmt = stmtCache->acquire(insertSql);
+    if (!stmt) {
+        return false;
+    }
+    sqlite3_bind_int(stmt, 1, courseId);
+    sqlite3_bind_int(stmt, 2, version);
+    vector<unsigned char> bytes;
+    packIds(ids, bytes);
+    bindBytes(stmt, 3, bytes);
+    bool ok = stepWrite(stmt) == SQLITE_DONE;
+    bool inserted = ok && sqlite3_changes(db) > 0;
+    stmtCache->release(stmt);
+    if (!inserted) {
+        return ok;
+    }
+    
+    // Each edit of a course bumps its version, so without this a course that
+    // is edited and sat often keeps a full id list per version for ever
+    const char* pruneSql = "DELETE FROM pool_snapshots WHERE course_id = ? AND version < ? "
+                          "AND NOT EXISTS (SELECT 1 FROM exam_sessions s "
+                          "WHERE s.course_id = pool_snapshots.course_id "
+                          "AND s.pool_version = pool_snapshots.version) "
+                          "AND NOT EXISTS (SELECT 1 FROM result_papers p "
+                          "WHERE p.course_id = pool_snapshots.course_id "
+                          "AND p.pool_version = pool_snapshots.version)";
+    stmt = stmtCache->acquire(pruneSql);
+    if (!stmt) {
+        return false;
+    }
+    sqlite3_bind_int(stmt, 1, courseId);
+    sqlite3_bind_int(stmt, 2, version);
+    ok = stepWrite(stmt) == SQLITE_DONE;
+    stmtCache->release(stmt);
+    return ok;
+}
+
+bool DatabaseManager::keepPoolSnapshot(int courseId, int version) {
+    const char* sql = "SELECT 1 FROM pool_snapshots WHERE course_id = ? AND version = ?";
+    bool found = false;
+    sqlite3_stmt* stmt = stmtCache->acquire(sql);
+    if (!stmt) {
+        return false;
+    }
+    sqlite3_bind_int(stmt, 1, courseId);
+    sqlite3_bind_int(stmt, 2, version);
+    found = sqlite3_step(stmt) == SQLITE_ROW;
+    stmtCache->release(stmt);
+    if (found) {
+        return true;
+    }
+    
+    long long key = ((long long)courseId << 32) | (unsigned int)version;
+    map<long long, vector<int> >::iterator it = poolSnapshots.find(key);
+    return it != poolSnapshots.end() && savePoolSnapshot(courseId, version, it->second);
+}
+
+bool DatabaseManager::getPaperQuestionIds(int courseId, PaperSeed& paper, vector<int>& ids) {
+    QUERY_TIMER(QOP_PAPER_QUESTION_IDS);
+    ids.clear();
+    if (paper.poolVersion <= 0) {
+        paper.poolVersion = getPoolVersion(courseId);
+    }
+    const vector<int>* pool = paper.poolVersion > 0 ? loadPoolSnapshot(courseId, paper.poolVersion)
+                                                    : NULL;
+    if (!pool) {
+        return false;
+    }
+    ids = drawSeededPaper(*pool, paper.questionCount, paper.value);
+    paper.questionCount = (int)ids.size();
+    QUERY_ROWS(ids.size());
+    return true;
+}
+
+vector<Question> DatabaseManager::getRandomQuestions(int courseId, int count, PaperSeed& paper) {
+    QUERY_TIMER(QOP_GET_SEEDED_QUESTIONS);
+    vector<Question> questions;
+    vector<int> ids;
+    paper.questionCount = count;
+    if (getPaperQuestionIds(courseId, paper, ids)) {
+        questions = getQuestionsByIds(ids);
+    }
+    QUERY_ROWS(questions.size());
+    return questions;
+}
+
+vector<int> DatabaseManager::sampleQuestionIds(int courseId, int count, SelectionMode mode) {
+    QUERY_TIMER(QOP_SAMPLE_QUESTION_IDS);
+    vector<int> ids = sampler->sample(courseId, count, mode);
+    QUERY_ROWS(ids.size());
+    return ids;
+}
+
+bool DatabaseManager::setBlueprint(int courseId, const Blueprint& blueprint) {
+    QUERY_TIMER(QOP_SET_BLUEPRINT);
+    bool ownTransaction = sqlite3_get_autocommit(db) != 0;
+    if (ownTransaction && !beginTransaction()) {
+        return false;
+    }
+    
+    bool ok = false;
+    sqlite3_stmt* stmt = stmtCache->acquire("DELETE FROM course_blueprints WHERE course_id = ?");
+    if (stmt) {
+        sqlite3_bind_int(stmt, 1, courseId);
+        ok = sqlite3_step(stmt) == SQLITE_DONE;
+        stmtCache->release(stmt);
+    }
+    
+    if (ok && !blueprint.rows.empty()) {
+        const char* rowSql = "INSERT INTO course_blueprints (course_id, position, topic, "
+                            "difficulty, question_count) VALUES (?, ?, ?, ?, ?)";
+        stmt = stmtCache->acquire(rowSql);
+        ok = stmt != NULL;
+        for (size_t i = 0; ok && i < blueprint.rows.size(); i++) {
+            const BlueprintRow& row = blueprint.rows[i];
+            sqlite3_bind_int(stmt, 1, courseId);
+            sqlite3_bind_int(stmt, 2, (int)i);
+            sqlite3_bind_text(stmt, 3, row.topic.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_int(stmt, 4, row.difficulty);
+            sqlite3_bind_int(stmt, 5, row.count);
+            ok = sqlite3_step(stmt) == SQLITE_DONE;
+            sqlite3_reset(stmt);
+        }
+        if (stmt) stmtCache->release(stmt);
+        
+        // The paper length follows the blueprint
+        if (ok) {
+            stmt = stmtCache->acquire("UPDATE courses SET questions_per_exam = ? WHERE id = ?");
+            ok = stmt != NULL;
+            if (ok) {
+                sqlite3_bind_int(stmt, 1, blueprint.totalQuestions());
+                sqlite3_bind_int(stmt, 2, courseId);
+                ok = sqlite3_step(stmt) == SQLITE_DONE;
+                stmtCache->release(stmt);
+            }
+        }
+    }
+    
+    if (ownTransaction) {
+        if (ok) {
+            ok = commitTransaction();
+        } else {
+            rollbackTransaction();
+        }
+    }
+    return ok;
+}
+
+Blueprint DatabaseManager::getBlueprint(int courseId) {
+    QUERY_TIMER(QOP_GET_BLUEPRINT);
+    const char* sql = "SELECT topic, difficulty, question_count FROM course_blueprints "
+                     "WHERE course_id = ? ORDER BY position";
+    Blueprint blueprint;
+    
+    sqlite3_stmt* stmt = stmtCache->acquire(sql);
+    if (stmt) {
+        sqlite3_bind_int(stmt, 1, courseId);
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            blueprint.rows.push_back(BlueprintRow(string((char*)sqlite3_column_text(stmt, 0)),
+                                                  sqlite3_column_int(stmt, 1),
+                                                  sqlite3_column_int(stmt, 2)));
+        }
+        stmtCache->release(stmt);
+    }
+    QUERY_ROWS(blueprint.rows.size());
+    return blueprint;
+}
+
+vector<BlueprintRow> DatabaseManager::getStrata(int courseId) {
+    QUERY_TIMER(QOP_GET_STRATA);
+    const char* sql = "SELECT topic, difficulty, COUNT(*) FROM questions WHERE course_id = ? "
+                     "GROUP BY topic, difficulty";
+    vector<BlueprintRow> strata;
+    
+    sqlite3_stmt* stmt = stmtCache->acquire(sql);
+    if (stmt) {
+        sqlite3_bind_int(stmt, 1, courseId);
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            strata.push_back(BlueprintRow(string((char*)sqlite3_column_text(stmt, 0)),
+                                          sqlite3_column_int(stmt, 1),
+                                          sqlite3_column_int(stmt, 2)));
+        }
+        stmtCache->release(stmt);
+    }
+    QUERY_ROWS(strata.size());
+    return strata;
+}
+
+vector<Question> DatabaseManager::getQuestionStrata(int courseId) {
+    QUERY_TIMER(QOP_QUESTION_STRATA);
+    const char* sql = "SELECT id, topic, difficulty FROM questions WHERE course_id = ?";
+    vector<Question> questions;
+    
+    sqlite3_stmt* stmt = stmtCache->acquire(sql);
+    if (stmt) {
+        sqlite3_bind_int(stmt, 1, courseId);
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            Question q;
+            q.id = sqlite3_column_int(stmt, 0);
+            q.courseId = courseId;
+            q.topic = string((char*)sqlite3_column_text(stmt, 1));
+            q.difficulty = sqlite3_column_int(stmt, 2);
+            questions.push_back(q);
+        }
+        stmtCache->release(stmt);
+    }
+    QUERY_ROWS(questions.size());
+    return questions;
+}
+
+bool DatabaseManager::sampleBlueprintIds(int courseId, const Blueprint& blueprint,
+                                         vector<int>& ids) {
+    QUERY_TIMER(QOP_SAMPLE_BLUEPRINT_IDS);
+    bool complete = sampler->sample(courseId, blueprint, ids);
+    QUERY_ROWS(ids.size());
+    return complete;
+}
+
+bool DatabaseManager::getBlueprintQuestions(int courseId, const Blueprint& blueprint,
+                                            vector<Question>& questions) {
+    QUERY_TIMER(QOP_BLUEPRINT_QUESTIONS);
+    vector<int> ids;
+    bool complete = sampler->sample(courseId, blueprint, ids);
+    questions = getQuestionsByIds(ids);
+    
+    // A question vanished under us: reload the pool and draw again
+    if (questions.size() < ids.size()) {
+        sampler->invalidate(courseId);
+        complete = sampler->sample(courseId, blueprint, ids);
+        questions = getQuestionsByIds(ids);
+    }
+    QUERY_ROWS(questions.size());
+    return complete && questions.size() == ids.size();
+}
+
+ExposureStats DatabaseManager::getExposureStats(int courseId) {
+    QUERY_TIMER(QOP_EXPOSURE_STATS);
+    const char* sql = "SELECT COUNT(*), SUM(exposure_count = 0), MIN(exposure_count), "
+                     "MAX(exposure_count), AVG(exposure_count) FROM questions WHERE course_id = ?";
+    ExposureStats stats;
+    
+    sqlite3_stmt* stmt = stmtCache->acquire(sql);
+    if (stmt) {
+        sqlite3_bind_int(stmt, 1, courseId);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            stats.questions = sqlite3_column_int(stmt, 0);
+            stats.neverShown = sqlite3_column_int(stmt, 1);
+            stats.minExposure = sqlite3_column_int(stmt, 2);
+            stats.maxExposure = sqlite3_column_int(stmt, 3);
+            stats.meanExposure = sqlite3_column_double(stmt, 4);
+        }
+        stmtCache->release(stmt);
+    }
+    QUERY_ROWS(stats.questions);
+    return stats;
+}
+
+vector<Question> DatabaseManager::getCourseAnswerKey(int courseId) {
+    QUERY_TIMER(QOP_ANSWER_KEY);
+    const char* sql = "SELECT id, correct_answer, points FROM questions WHERE course_id = ?";
+    vector<Question> questions;
+    
+    sqlite3_stmt* stmt = stmtCache->acquire(sql);
+    if (stmt) {
+        sqlite3_bind_int(stmt, 1, courseId);
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            Question q;
+            q.id = sqlite3_column_int(stmt, 0);
+            q.courseId = courseId;
+            q.correctAnswer = string((char*)sqlite3_column_text(stmt, 1));
+            q.points = sqlite3_column_int(stmt, 2);
+            questions.push_back(q);
+        }
+        stmtCache->release(stmt);
+    }
+    QUERY_ROWS(questions.size());
     return questions;
 }
 
+bool DatabaseManager::updateCorrectAnswer(int questionId, const string& correctAnswer) {
+    QUERY_TIMER(QOP_UPDATE_ANSWER_KEY);
+    const char* sql = "UPDATE questions SET correct_answer = ? WHERE id = ?";
+    
+    sqlite3_stmt* stmt = stmtCache->acquire(sql);
+    if (stmt) {
+        sqlite3_bind_text(stmt, 1, correctAnswer.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int(stmt, 2, questionId);
+        int result = stepWrite(stmt);
+        int changed = sqlite3_changes(db);
+        stmtCache->release(stmt);
+        return result == SQLITE_DONE && changed == 1;
+    }
+    return false;
+}
+
 // ============================================================================
 // Result Management Methods
 // ============================================================================
 
 int DatabaseManager::saveResult(Result r) {
+    QUERY_TIMER(QOP_SAVE_RESULT);
     const char* sql = "INSERT INTO results (user_id, username, course_id, course_code, "
                      "course_title, score, total_questions, total_points, percentage, "
-                     "time_spent, passed) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
-    sqlite3_stmt* stmt;
+                     "time_spent, passed, date_time) "
+                     "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, COALESCE(?, CURRENT_TIMESTAMP))";
     
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, 0) == SQLITE_OK) {
+    sqlite3_stmt* stmt = stmtCache->acquire(sql);
+    if (stmt) {
         sqlite3_bind_int(stmt, 1, r.userId);
         sqlite3_bind_text(stmt, 2, r.username.c_str(), -1, SQLITE_TRANSIENT);
         sqlite3_bind_int(stmt, 3, r.courseId);
@@ -363,46 +1269,767 @@ int DatabaseManager::saveResult(Result r) {
         sqlite3_bind_double(stmt, 9, r.percentage);
         sqlite3_bind_int(stmt, 10, r.timeSpent);
         sqlite3_bind_int(stmt, 11, r.passed ? 1 : 0);
+        // Normally stamped by SQLite; set only for imported or seeded history
+        if (!r.dateTime.empty()) {
+            sqlite3_bind_text(stmt, 12, r.dateTime.c_str(), -1, SQLITE_TRANSIENT);
+        } else {
+            sqlite3_bind_null(stmt, 12);
+        }
         
-        if (sqlite3_step(stmt) == SQLITE_DONE) {
+        if (stepWrite(stmt) == SQLITE_DONE) {
             int resultId = sqlite3_last_insert_rowid(db);
-            sqlite3_finalize(stmt);
+            stmtCache->release(stmt);
+            QUERY_ROWS(1);
             return resultId;
         }
-        sqlite3_finalize(stmt);
+        stmtCache->release(stmt);
     }
     return -1;
 }
 
-vector<Result> DatabaseManager::getResults(int userId) {
-    vector<Result> results;
+int DatabaseManager::submitResult(const Result& r, const ResultPaper& paper, int sessionId,
+                                  const vector<SessionAnswer>& finalChanges) {
+    QUERY_TIMER(QOP_SUBMIT_RESULT);
+    bool ownTransaction = sqlite3_get_autocommit(db) != 0;
+    if (ownTransaction && !beginTransaction()) {
+        return -1;
+    }
+    
+    // The last answers go in only if the sitting is still open: a second
+    // submit of it (a resend, another terminal) stops here having written
+    // nothing. The close then can't miss inside this transaction.
+    bool ok = true;
+    bool alreadyClosed = false;
+    if (sessionId > 0) {
+        int saved = writeSessionProgress(sessionId, finalChanges, 0, 0, r.timeSpent);
+        ok = saved > 0;
+        alreadyClosed = saved == 0;
+        ok = ok && closeExamSession(sessionId) && sqlite3_changes(db) == 1;
+    }
+    int resultId = ok ? saveResult(r) : -1;
+    ok = ok && resultId > 0;
+    if (ok && (!paper.questionIds.empty() || paper.seed.isSeeded())) {
+        ok = saveResultPaper(resultId, paper);
+    }
+    
+    if (ownTransaction) {
+        if (ok) {
+            ok = commitTransaction();
+        }
+        if (!ok) {
+            rollbackTransaction();
+        }
+    }
+    if (!ok) {
+        return alreadyClosed ? 0 : -1;
+    }
+    QUERY_ROWS(1);
+    return resultId;
+}
+
+// Blob layouts of result_papers: question ids as packIds, answers as the
+// sheet's code words followed by its answered words, as packWords
+static void packAnswers(const AnswerSheet& sheet, vector<unsigned char>& bytes) {
+    vector<uint64_t> words(sheet.codes.begin(), sheet.codes.end());
+    words.insert(words.end(), sheet.answered.begin(), sheet.answered.end());
+    packWords(words, bytes);
+}
+
+// False if the blob doesn't fit a sheet of questionCount questions
+static bool unpackAnswers(const void* blob, int bytes, int questionCount, AnswerSheet& sheet) {
+    sheet = AnswerSheet(questionCount);
+    size_t half = sheet.codes.size();
+    if (bytes != (int)(2 * half * 8)) {
+        return false;
+    }
+    unpackWords(blob, half, sheet.codes);
+    unpackWords((const unsigned char*)blob + half * 8, half, sheet.answered);
+    return true;
+}
+
+bool DatabaseManager::saveResultPaper(int resultId, const ResultPaper& paper) {
+    QUERY_TIMER(QOP_SAVE_RESULT_PAPER);
+    // A seeded paper stores its seed; the question list is rebuilt on load
+    const char* sql = "INSERT OR REPLACE INTO result_papers (course_id, result_id, "
+                     "question_ids, answers, pool_version, paper_seed, question_count, "
+                     "shuffled_options) VALUES (?, ?, ?, ?, ?, ?, ?, ?)";
+    vector<unsigned char> ids, answers;
+    if (!paper.seed.isSeeded()) {
+        packIds(paper.questionIds, ids);
+    }
+    packAnswers(paper.answers, answers);
+    
+    sqlite3_stmt* stmt = stmtCache->acquire(sql);
+    if (stmt) {
+        sqlite3_bind_int(stmt, 1, paper.courseId);
+        sqlite3_bind_int(stmt, 2, resultId);
+        bindBytes(stmt, 3, ids);
+        bindBytes(stmt, 4, answers);
+        sqlite3_bind_int(stmt, 5, paper.seed.poolVersion);
+        sqlite3_bind_int64(stmt, 6, (sqlite3_int64)paper.seed.value);
+        sqlite3_bind_int(stmt, 7, paper.seed.questionCount);
+        sqlite3_bind_int(stmt, 8, paper.seed.shuffledOptions ? 1 : 0);
+        int result = stepWrite(stmt);
+        stmtCache->release(stmt);
+        QUERY_ROWS(result == SQLITE_DONE ? 1 : 0);
+        return result == SQLITE_DONE;
+    }
+    return false;
+}
+
+int DatabaseManager::getResultPaperRange(int courseId, int& firstResultId, int& lastResultId) {
+    QUERY_TIMER(QOP_RESULT_PAPER_RANGE);
+    const char* sql = "SELECT MIN(result_id), MAX(result_id), COUNT(*) "
+                     "FROM result_papers WHERE course_id = ?";
+    int count = 0;
+    
+    sqlite3_stmt* stmt = stmtCache->acquire(sql);
+    if (stmt) {
+        sqlite3_bind_int(stmt, 1, courseId);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            firstResultId = sqlite3_column_int(stmt, 0);
+            lastResultId = sqlite3_column_int(stmt, 1);
+            count = sqlite3_column_int(stmt, 2);
+        }
+        stmtCache->release(stmt);
+    }
+    QUERY_ROWS(count);
+    return count;
+}
+
+int DatabaseManager::loadResultPapers(int courseId, int afterResultId, int lastResultId,
+                                      int limit, vector<ResultPaper>& papers) {
+    QUERY_TIMER(QOP_RESULT_PAPERS);
+    const char* sql = "SELECT result_id, question_ids, answers, pool_version, paper_seed, "
+                     "question_count, shuffled_options FROM result_papers "
+                     "WHERE course_id = ? AND result_id > ? AND result_id <= ? "
+                     "ORDER BY result_id LIMIT ?";
+    papers.clear();
+    
+    sqlite3_stmt* stmt = stmtCache->acquire(sql);
+    if (stmt) {
+        sqlite3_bind_int(stmt, 1, courseId);
+        sqlite3_bind_int(stmt, 2, afterResultId);
+        sqlite3_bind_int(stmt, 3, lastResultId);
+        sqlite3_bind_int(stmt, 4, limit);
+        
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            papers.push_back(ResultPaper());
+            ResultPaper& paper = papers.back();
+            paper.resultId = sqlite3_column_int(stmt, 0);
+            paper.courseId = courseId;
+            
+            paper.seed = PaperSeed(sqlite3_column_int(stmt, 3),
+                                   (uint64_t)sqlite3_column_int64(stmt, 4),
+                                   sqlite3_column_int(stmt, 5));
+            paper.seed.shuffledOptions = sqlite3_column_int(stmt, 6) != 0;
+            bool readable = unpackIds(sqlite3_column_blob(stmt, 1),
+                                      sqlite3_column_bytes(stmt, 1), paper.questionIds);
+            int idCount = (int)paper.questionIds.size();
+            if (readable && paper.questionIds.empty() && paper.seed.isSeeded()) {
+                PaperSeed seed = paper.seed;
+                getPaperQuestionIds(courseId, seed, paper.questionIds);
+                idCount = paper.seed.questionCount;
+            }
+            if (!readable || !unpackAnswers(sqlite3_column_blob(stmt, 2),
+                                            sqlite3_column_bytes(stmt, 2), idCount,
+                                            paper.answers)) {
+                // Corrupt ids or answers: grading a blank sheet would fail the candidate
+                paper.questionIds.clear();
+            }
+        }
+        stmtCache->release(stmt);
+    }
+    QUERY_ROWS(papers.size());
+    return (int)papers.size();
+}
+
+int DatabaseManager::updateResultScores(const vector<Result>& results) {
+    QUERY_TIMER(QOP_UPDATE_SCORES);
+    // Only rows whose marks actually move are rewritten
+    const char* sql = "UPDATE results SET score = ?, total_points = ?, percentage = ?, "
+                     "passed = ? WHERE id = ? AND (score <> ? OR total_points <> ? OR passed <> ?)";
+    bool ownTransaction = sqlite3_get_autocommit(db) != 0;
+    if (ownTransaction && !beginTransaction()) {
+        return -1;
+    }
+    
+    int changed = 0;
+    bool ok = true;
+    sqlite3_stmt* stmt = stmtCache->acquire(sql);
+    ok = stmt != NULL;
+    for (size_t i = 0; ok && i < results.size(); i++) {
+        const Result& r = results[i];
+        sqlite3_bind_int(stmt, 1, r.score);
+        sqlite3_bind_int(stmt, 2, r.totalPoints);
+        sqlite3_bind_double(stmt, 3, r.percentage);
+        sqlite3_bind_int(stmt, 4, r.passed ? 1 : 0);
+        sqlite3_bind_int(stmt, 5, r.id);
+        sqlite3_bind_int(stmt, 6, r.score);
+        sqlite3_bind_int(stmt, 7, r.totalPoints);
+        sqlite3_bind_int(stmt, 8, r.passed ? 1 : 0);
+        ok = sqlite3_step(stmt) == SQLITE_DONE;
+        changed += sqlite3_changes(db);
+        sqlite3_reset(stmt);
+    }
+    if (stmt) stmtCache->release(stmt);
+    
+    if (ownTransaction) {
+        if (ok) {
+            ok = commitTransaction();
+        }
+        if (!ok) {
+            rollbackTransaction();
+        }
+    }
+    QUERY_ROWS(ok ? changed : 0);
+    return ok ? changed : -1;
+}
+
+int DatabaseManager::saveAssignedPapers(const vector<AssignedPaper>& papers) {
+    QUERY_TIMER(QOP_SAVE_ASSIGNED_PAPERS);
+    // A candidate drawn again gets the new paper
+    const char* sql = "INSERT OR REPLACE INTO assigned_papers "
+                     "(user_id, course_id, question_ids) VALUES (?, ?, ?)";
+    bool ownTransaction = sqlite3_get_autocommit(db) != 0;
+    if (ownTransaction && !beginTransaction()) {
+        return -1;
+    }
+    
+    bool ok = true;
+    sqlite3_stmt* stmt = stmtCache->acquire(sql);
+    ok = stmt != NULL;
+    vector<unsigned char> bytes;
+    for (size_t i = 0; ok && i < papers.size(); i++) {
+        const AssignedPaper& paper = papers[i];
+        sqlite3_bind_int(stmt, 1, paper.userId);
+        sqlite3_bind_int(stmt, 2, paper.courseId);
+        packIds(paper.questionIds, bytes);
+        bindBytes(stmt, 3, bytes);
+        ok = sqlite3_step(stmt) == SQLITE_DONE;
+        sqlite3_reset(stmt);
+    }
+    if (stmt) stmtCache->release(stmt);
+    
+    if (ownTransaction) {
+        if (ok) {
+            ok = commitTransaction();
+        }
+        if (!ok) {
+            rollbackTransaction();
+        }
+    }
+    QUERY_ROWS(ok ? papers.size() : 0);
+    return ok ? (int)papers.size() : -1;
+}
+
+bool DatabaseManager::findAssignedPaper(int userId, int courseId, AssignedPaper& paper) {
+    QUERY_TIMER(QOP_FIND_ASSIGNED_PAPER);
+    const char* sql = "SELECT question_ids FROM assigned_papers "
+                     "WHERE user_id = ? AND course_id = ?";
+    bool found = false;
+    
+    sqlite3_stmt* stmt = stmtCache->acquire(sql);
+    if (stmt) {
+        sqlite3_bind_int(stmt, 1, userId);
+        sqlite3_bind_int(stmt, 2, courseId);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            paper.userId = userId;
+            paper.courseId = courseId;
+            found = unpackIds(sqlite3_column_blob(stmt, 0), sqlite3_column_bytes(stmt, 0),
+                              paper.questionIds);
+        }
+        stmtCache->release(stmt);
+    }
+    QUERY_ROWS(found ? 1 : 0);
+    return found;
+}
+
+bool DatabaseManager::deleteAssignedPaper(int userId, int courseId) {
+    QUERY_TIMER(QOP_DELETE_ASSIGNED_PAPER);
+    const char* sql = "DELETE FROM assigned_papers WHERE user_id = ? AND course_id = ?";
+    
+    sqlite3_stmt* stmt = stmtCache->acquire(sql);
+    if (stmt) {
+        sqlite3_bind_int(stmt, 1, userId);
+        sqlite3_bind_int(stmt, 2, courseId);
+        int result = stepWrite(stmt);
+        stmtCache->release(stmt);
+        QUERY_ROWS(result == SQLITE_DONE ? sqlite3_changes(db) : 0);
+        return result == SQLITE_DONE;
+    }
+    return false;
+}
+
+int DatabaseManager::countAssignedPapers(int courseId) {
+    QUERY_TIMER(QOP_COUNT_ASSIGNED_PAPERS);
+    const char* sql = "SELECT COUNT(*) FROM assigned_papers WHERE course_id = ?";
+    int count = 0;
+    
+    sqlite3_stmt* stmt = stmtCache->acquire(sql);
+    if (stmt) {
+        sqlite3_bind_int(stmt, 1, courseId);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            count = sqlite3_column_int(stmt, 0);
+        }
+        stmtCache->release(stmt);
+    }
+    QUERY_ROWS(1);
+    return count;
+}
+
+int DatabaseManager::saveSeatPapers(int courseId, const vector<SeatPaper>& papers) {
+    QUERY_TIMER(QOP_SAVE_SEAT_PAPERS);
+    // A new plan replaces the whole hall, so no seat keeps an old paper
+    const char* clearSql = "DELETE FROM seat_papers WHERE course_id = ?";
+    const char* sql = "INSERT INTO seat_papers "
+                     "(course_id, seat_row, seat_column, question_ids, option_seed) "
+                     "VALUES (?, ?, ?, ?, ?)";
+    bool ownTransaction = sqlite3_get_autocommit(db) != 0;
+    if (ownTransaction && !beginTransaction()) {
+        return -1;
+    }
+    
+    bool ok = false;
+    sqlite3_stmt* stmt = stmtCache->acquire(clearSql);
+    if (stmt) {
+        sqlite3_bind_int(stmt, 1, courseId);
+        ok = sqlite3_step(stmt) == SQLITE_DONE;
+        stmtCache->release(stmt);
+    }
+    
+    stmt = ok ? stmtCache->acquire(sql) : NULL;
+    ok = stmt != NULL;
+    vector<unsigned char> bytes;
+    for (size_t i = 0; ok && i < papers.size(); i++) {
+        const SeatPaper& paper = papers[i];
+        sqlite3_bind_int(stmt, 1, courseId);
+        sqlite3_bind_int(stmt, 2, paper.seat.row);
+        sqlite3_bind_int(stmt, 3, paper.seat.column);
+        packIds(paper.questionIds, bytes);
+        bindBytes(stmt, 4, bytes);
+        sqlite3_bind_int64(stmt, 5, (sqlite3_int64)paper.optionSeed);
+        ok = sqlite3_step(stmt) == SQLITE_DONE;
+        sqlite3_reset(stmt);
+    }
+    if (stmt) stmtCache->release(stmt);
+    
+    if (ownTransaction) {
+        if (ok) {
+            ok = commitTransaction();
+        }
+        if (!ok) {
+            rollbackTransaction();
+        }
+    }
+    QUERY_ROWS(ok ? papers.size() : 0);
+    return ok ? (int)papers.size() : -1;
+}
+
+bool DatabaseManager::findSeatPaper(int courseId, const Seat& seat, SeatPaper& paper) {
+    QUERY_TIMER(QOP_FIND_SEAT_PAPER);
+    const char* sql = "SELECT question_ids, option_seed FROM seat_papers "
+                     "WHERE course_id = ? AND seat_row = ? AND seat_column = ?";
+    bool found = false;
+    
+    sqlite3_stmt* stmt = stmtCache->acquire(sql);
+    if (stmt) {
+        sqlite3_bind_int(stmt, 1, courseId);
+        sqlite3_bind_int(stmt, 2, seat.row);
+        sqlite3_bind_int(stmt, 3, seat.column);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            paper.courseId = courseId;
+            paper.seat = seat;
+            paper.optionSeed = (uint64_t)sqlite3_column_int64(stmt, 1);
+            found = unpackIds(sqlite3_column_blob(stmt, 0), sqlite3_column_bytes(stmt, 0),
+                              paper.questionIds);
+        }
+        stmtCache->release(stmt);
+    }
+    QUERY_ROWS(found ? 1 : 0);
+    return found;
+}
+
+bool DatabaseManager::deleteSeatPaper(int courseId, const Seat& seat) {
+    QUERY_TIMER(QOP_DELETE_SEAT_PAPER);
+    const char* sql = "DELETE FROM seat_papers "
+                     "WHERE course_id = ? AND seat_row = ? AND seat_column = ?";
+    
+    sqlite3_stmt* stmt = stmtCache->acquire(sql);
+    if (stmt) {
+        sqlite3_bind_int(stmt, 1, courseId);
+        sqlite3_bind_int(stmt, 2, seat.row);
+        sqlite3_bind_int(stmt, 3, seat.column);
+        int result = stepWrite(stmt);
+        stmtCache->release(stmt);
+        QUERY_ROWS(result == SQLITE_DONE ? sqlite3_changes(db) : 0);
+        return result == SQLITE_DONE;
+    }
+    return false;
+}
+
+int DatabaseManager::countSeatPapers(int courseId) {
+    QUERY_TIMER(QOP_COUNT_SEAT_PAPERS);
+    const char* sql = "SELECT COUNT(*) FROM seat_papers WHERE course_id = ?";
+    int count = 0;
+    
+    sqlite3_stmt* stmt = stmtCache->acquire(sql);
+    if (stmt) {
+        sqlite3_bind_int(stmt, 1, courseId);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            count = sqlite3_column_int(stmt, 0);
+        }
+        stmtCache->release(stmt);
+    }
+    QUERY_ROWS(1);
+    return count;
+}
+
+static const char* resultSortColumn(ResultSort sortBy) {
+    switch (sortBy) {
+        case SORT_USERNAME: return "username";
+        case SORT_COURSE: return "course_code";
+        case SORT_SCORE: return "percentage";
+        default: return "date_time";
+    }
+}
+
+static void appendResultFilters(stringstream& sql, const ResultQuery& query) {
+    if (query.userId > 0) sql << " AND user_id = ?";
+    if (query.courseId > 0) sql << " AND course_id = ?";
+    if (query.passed >= 0) sql << " AND passed = ?";
+    if (!query.fromDate.empty()) sql << " AND date_time >= ?";
+    if (!query.toDate.empty()) sql << " AND date_time < ?";
+}
+
+static void bindResultFilters(sqlite3_stmt* stmt, const ResultQuery& query, int& param) {
+    if (query.userId > 0) sqlite3_bind_int(stmt, param++, query.userId);
+    if (query.courseId > 0) sqlite3_bind_int(stmt, param++, query.courseId);
+    if (query.passed >= 0) sqlite3_bind_int(stmt, param++, query.passed);
+    if (!query.fromDate.empty()) {
+        sqlite3_bind_text(stmt, param++, query.fromDate.c_str(), -1, SQLITE_STATIC);
+    }
+    if (!query.toDate.empty()) {
+        sqlite3_bind_text(stmt, param++, query.toDate.c_str(), -1, SQLITE_STATIC);
+    }
+}
+
+int DatabaseManager::countResults(const ResultQuery& query) {
+    QUERY_TIMER(QOP_COUNT_RESULTS);
+    stringstream sql;
+    sql << "SELECT COUNT(*) FROM results WHERE 1";
+    appendResultFilters(sql, query);
+    
+    int count = 0;
+    sqlite3_stmt* stmt = stmtCache->acquire(sql.str().c_str());
+    if (stmt) {
+        int param = 1;
+        bindResultFilters(stmt, query, param);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            count = sqlite3_column_int(stmt, 0);
+        }
+        stmtCache->release(stmt);
+    }
+    QUERY_ROWS(1);
+    return count;
+}
+
+int DatabaseManager::streamResults(ResultQuery& query, ResultCallback callback, void* data) {
+    QUERY_TIMER(QOP_STREAM_RESULTS);
+    const char* sortColumn = resultSortColumn(query.sortBy);
+    const char* direction = query.ascending ? "ASC" : "DESC";
+    
+    // One SQL string per filter/sort combination, so each shape is prepared once
     stringstream sql;
-    sql << "SELECT * FROM results";
-    if (userId > 0) {
-        sql << " WHERE user_id = " << userId;
+    sql << "SELECT id, user_id, username, course_id, course_code, course_title, "
+           "date_time, score, total_questions, total_points, percentage, "
+           "time_spent, passed FROM results WHERE 1";
+    appendResultFilters(sql, query);
+    if (query.afterId > 0) {
+        sql << " AND (" << sortColumn << ", id) " << (query.ascending ? ">" : "<") << " (?, ?)";
     }
-    sql << " ORDER BY date_time DESC";
+    sql << " ORDER BY " << sortColumn << " " << direction << ", id " << direction
+        << " LIMIT ? OFFSET ?";
     
-    sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db, sql.str().c_str(), -1, &stmt, 0) == SQLITE_OK) {
+    int streamed = 0;
+    sqlite3_stmt* stmt = stmtCache->acquire(sql.str().c_str());
+    if (stmt) {
+        int param = 1;
+        bindResultFilters(stmt, query, param);
+        if (query.afterId > 0) {
+            if (query.sortBy == SORT_SCORE) {
+                sqlite3_bind_double(stmt, param++, query.afterScore);
+            } else {
+                sqlite3_bind_text(stmt, param++, query.afterKey.c_str(), -1, SQLITE_TRANSIENT);
+            }
+            sqlite3_bind_int(stmt, param++, query.afterId);
+        }
+        sqlite3_bind_int(stmt, param++, query.pageSize > 0 ? query.pageSize : -1);
+        sqlite3_bind_int(stmt, param++, query.offset > 0 ? query.offset : 0);
+        
+        // One Result reused for every row keeps string buffers allocated
+        Result r;
         while (sqlite3_step(stmt) == SQLITE_ROW) {
-            Result r;
             r.id = sqlite3_column_int(stmt, 0);
             r.userId = sqlite3_column_int(stmt, 1);
-            r.username = string((char*)sqlite3_column_text(stmt, 2));
+            r.username.assign((const char*)sqlite3_column_text(stmt, 2));
             r.courseId = sqlite3_column_int(stmt, 3);
-            r.courseCode = string((char*)sqlite3_column_text(stmt, 4));
-            r.courseTitle = string((char*)sqlite3_column_text(stmt, 5));
-            r.dateTime = string((char*)sqlite3_column_text(stmt, 6));
+            r.courseCode.assign((const char*)sqlite3_column_text(stmt, 4));
+            r.courseTitle.assign((const char*)sqlite3_column_text(stmt, 5));
+            r.dateTime.assign((const char*)sqlite3_column_text(stmt, 6));
             r.score = sqlite3_column_int(stmt, 7);
             r.totalQuestions = sqlite3_column_int(stmt, 8);
             r.totalPoints = sqlite3_column_int(stmt, 9);
             r.percentage = sqlite3_column_double(stmt, 10);
             r.timeSpent = sqlite3_column_int(stmt, 11);
             r.passed = sqlite3_column_int(stmt, 12) == 1;
-            results.push_back(r);
+            
+            query.resumeAfter(r);
+            streamed++;
+            
+            if (!callback(r, data)) break;
         }
-        sqlite3_finalize(stmt);
+        stmtCache->release(stmt);
+    }
+    // The cursor now holds the position; an offset only applies once
+    query.offset = 0;
+    QUERY_ROWS(streamed);
+    return streamed;
+}
+
+bool DatabaseManager::openExamSession(ExamSession& session) {
+    QUERY_TIMER(QOP_OPEN_SESSION);
+    stringstream ids;
+    for (size_t i = 0; i < session.questionIds.size(); i++) {
+        if (i > 0) ids << ",";
+        ids << session.questionIds[i];
+    }
+    string idList = ids.str();
+    
+    // A seeded paper stores its seed; the question list is rebuilt on resume
+    if (session.seed.isSeeded()) {
+        idList.clear();
+    }
+    const char* sql = "INSERT INTO exam_sessions (user_id, course_id, question_ids, "
+                     "current_index, time_remaining, time_spent, pool_version, paper_seed, "
+                     "question_count, shuffled_options) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+    
+    // The paper's exposure counts go in with the session
+    bool ownTransaction = sqlite3_get_autocommit(db) != 0;
+    if (ownTransaction && !beginTransaction()) {
+        return false;
+    }
+    
+    // Checked under the write lock, so no prune can slip in before the insert
+    bool ok = !session.seed.isSeeded() ||
+              keepPoolSnapshot(session.courseId, session.seed.poolVersion);
+    sqlite3_stmt* stmt = ok ? stmtCache->acquire(sql) : NULL;
+    ok = stmt != NULL;
+    if (stmt) {
+        sqlite3_bind_int(stmt, 1, session.userId);
+        sqlite3_bind_int(stmt, 2, session.courseId);
+        sqlite3_bind_text(stmt, 3, idList.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 4, session.currentIndex);
+        sqlite3_bind_int(stmt, 5, session.timeRemaining);
+        sqlite3_bind_int(stmt, 6, session.timeSpent);
+        sqlite3_bind_int(stmt, 7, session.seed.poolVersion);
+        sqlite3_bind_int64(stmt, 8, (sqlite3_int64)session.seed.value);
+        sqlite3_bind_int(stmt, 9, session.seed.questionCount);
+        sqlite3_bind_int(stmt, 10, session.seed.shuffledOptions ? 1 : 0);
+        
+        ok = sqlite3_step(stmt) == SQLITE_DONE;
+        stmtCache->release(stmt);
+        if (ok) {
+            session.id = (int)sqlite3_last_insert_rowid(db);
+            // started_at defaults to the same clock
+            session.startedAt = (long long)time(NULL);
+        }
+    }
+    
+    if (ok && !session.questionIds.empty()) {
+        const char* exposureSql = "UPDATE questions SET exposure_count = exposure_count + 1 "
+                                 "WHERE id = ?";
+        sqlite3_stmt* update = stmtCache->acquire(exposureSql);
+        ok = update != NULL;
+        for (size_t i = 0; ok && i < session.questionIds.size(); i++) {
+            sqlite3_bind_int(update, 1, session.questionIds[i]);
+            ok = sqlite3_step(update) == SQLITE_DONE;
+            sqlite3_reset(update);
+        }
+        if (update) stmtCache->release(update);
+    }
+    
+    if (ownTransaction) {
+        if (ok) {
+            ok = commitTransaction();
+        } else {
+            rollbackTransaction();
+        }
+    }
+    if (!ok) {
+        session.id = 0;
+    }
+    return ok;
+}
+
+bool DatabaseManager::saveSessionProgress(int sessionId, const vector<SessionAnswer>& changes,
+                                          int currentIndex, int timeRemaining, int timeSpent) {
+    return writeSessionProgress(sessionId, changes, currentIndex, timeRemaining, timeSpent) > 0;
+}
+
+int DatabaseManager::writeSessionProgress(int sessionId, const vector<SessionAnswer>& changes,
+                                          int currentIndex, int timeRemaining, int timeSpent) {
+    QUERY_TIMER(QOP_SAVE_SESSION);
+    // Joins the caller's transaction if there is one (see submission)
+    bool ownTransaction = sqlite3_get_autocommit(db) != 0;
+    if (ownTransaction && !beginTransaction()) {
+        return -1;
+    }
+    
+    // The clock first, and only while the sitting is open: answers from a
+    // terminal still on a sitting submitted elsewhere are not written
+    bool ok = true;
+    bool closed = false;
+    const char* sessionSql = "UPDATE exam_sessions SET current_index = ?, "
+                            "time_remaining = ?, time_spent = ?, "
+                            "updated_at = CURRENT_TIMESTAMP WHERE id = ? AND status = 'open'";
+    sqlite3_stmt* stmt = stmtCache->acquire(sessionSql);
+    ok = stmt != NULL;
+    if (stmt) {
+        sqlite3_bind_int(stmt, 1, currentIndex);
+        sqlite3_bind_int(stmt, 2, timeRemaining);
+        sqlite3_bind_int(stmt, 3, timeSpent);
+        sqlite3_bind_int(stmt, 4, sessionId);
+        ok = sqlite3_step(stmt) == SQLITE_DONE;
+        stmtCache->release(stmt);
+    }
+    if (ok && sqlite3_changes(db) == 0) {
+        ok = false;
+        closed = true;
+    }
+    
+    if (ok && !changes.empty()) {
+        const char* answerSql = "INSERT OR REPLACE INTO session_answers "
+                               "(session_id, position, answer) VALUES (?, ?, ?)";
+        stmt = stmtCache->acquire(answerSql);
+        if (!stmt) {
+            ok = false;
+        }
+        for (size_t i = 0; ok && i < changes.size(); i++) {
+            sqlite3_bind_int(stmt, 1, sessionId);
+            sqlite3_bind_int(stmt, 2, changes[i].position);
+            sqlite3_bind_text(stmt, 3, changes[i].answer.c_str(), -1, SQLITE_STATIC);
+            ok = sqlite3_step(stmt) == SQLITE_DONE;
+            sqlite3_reset(stmt);
+        }
+        if (stmt) stmtCache->release(stmt);
+    }
+    
+    if (ownTransaction) {
+        if (ok) {
+            ok = commitTransaction();
+        }
+        if (!ok) {
+            rollbackTransaction();
+        }
+    }
+    QUERY_ROWS(ok ? changes.size() : 0);
+    if (!ok) {
+        return closed ? 0 : -1;
+    }
+    return 1;
+}
+
+bool DatabaseManager::findOpenExamSession(int userId, int courseId, ExamSession& session) {
+    QUERY_TIMER(QOP_FIND_SESSION);
+    const char* sql = "SELECT id, question_ids, current_index, time_remaining, time_spent, "
+                     "pool_version, paper_seed, question_count, shuffled_options, "
+                     "CAST(strftime('%s', started_at) AS INTEGER) "
+                     "FROM exam_sessions WHERE user_id = ? AND status = 'open' "
+                     "AND course_id = ? ORDER BY id DESC LIMIT 1";
+    bool found = false;
+    
+    sqlite3_stmt* stmt = stmtCache->acquire(sql);
+    if (stmt) {
+        sqlite3_bind_int(stmt, 1, userId);
+        sqlite3_bind_int(stmt, 2, courseId);
+        
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            session.id = sqlite3_column_int(stmt, 0);
+            session.userId = userId;
+            session.courseId = courseId;
+            session.currentIndex = sqlite3_column_int(stmt, 2);
+            session.timeRemaining = sqlite3_column_int(stmt, 3);
+            session.timeSpent = sqlite3_column_int(stmt, 4);
+            session.seed = PaperSeed(sqlite3_column_int(stmt, 5),
+                                     (uint64_t)sqlite3_column_int64(stmt, 6),
+                                     sqlite3_column_int(stmt, 7));
+            session.seed.shuffledOptions = sqlite3_column_int(stmt, 8) != 0;
+            session.startedAt = sqlite3_column_int64(stmt, 9);
+            
+            session.questionIds.clear();
+            stringstream ids((const char*)sqlite3_column_text(stmt, 1));
+            string id;
+            while (getline(ids, id, ',')) {
+                session.questionIds.push_back(atoi(id.c_str()));
+            }
+            found = true;
+        }
+        stmtCache->release(stmt);
+    }
+    if (!found) return false;
+    
+    if (session.questionIds.empty() && session.seed.isSeeded()) {
+        PaperSeed seed = session.seed;
+        getPaperQuestionIds(courseId, seed, session.questionIds);
+    }
+    session.answers.assign(session.questionIds.size(), "");
+    const char* answerSql = "SELECT position, answer FROM session_answers WHERE session_id = ?";
+    stmt = stmtCache->acquire(answerSql);
+    if (stmt) {
+        sqlite3_bind_int(stmt, 1, session.id);
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            int position = sqlite3_column_int(stmt, 0);
+            if (position >= 0 && position < (int)session.answers.size()) {
+                session.answers[position] = (const char*)sqlite3_column_text(stmt, 1);
+            }
+        }
+        stmtCache->release(stmt);
+    }
+    QUERY_ROWS(1);
+    return true;
+}
+
+int DatabaseManager::countExamSessions(int userId, int courseId) {
+    QUERY_TIMER(QOP_COUNT_SESSIONS);
+    const char* sql = "SELECT COUNT(*) FROM exam_sessions WHERE user_id = ? AND course_id = ?";
+    int count = 0;
+    
+    sqlite3_stmt* stmt = stmtCache->acquire(sql);
+    if (stmt) {
+        sqlite3_bind_int(stmt, 1, userId);
+        sqlite3_bind_int(stmt, 2, courseId);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            count = sqlite3_column_int(stmt, 0);
+        }
+        stmtCache->release(stmt);
+    }
+    QUERY_ROWS(1);
+    return count;
+}
+
+bool DatabaseManager::closeExamSession(int sessionId, const string& status) {
+    QUERY_TIMER(QOP_CLOSE_SESSION);
+    const char* sql = "UPDATE exam_sessions SET status = ?, "
+                     "updated_at = CURRENT_TIMESTAMP WHERE id = ? AND status = 'open'";
+    
+    sqlite3_stmt* stmt = stmtCache->acquire(sql);
+    if (stmt) {
+        sqlite3_bind_text(stmt, 1, status.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 2, sessionId);
+        int result = stepWrite(stmt);
+        stmtCache->release(stmt);
+        return result == SQLITE_DONE;
     }
-    return results;
-}
\ No newline at end of file
+    return false;
+}
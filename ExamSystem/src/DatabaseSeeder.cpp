@@ -0,0 +1,262 @@
+#include "DatabaseSeeder.h"
+#include <random>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+
+using namespace std;
+
+const char* SEED_PASSWORD = "seedpass";
+
+static const int SEED_CHUNK = 10000;
+static const int SEED_PAPER_SIZE = 40;
+static const int SEED_PASS_MARK = 40;
+
+// Results are dated back from a fixed day (2025-01-01, in days since
+// 1970-01-01) rather than today, so a seed gives the same rows whenever it runs
+static const int SEED_LAST_DAY = 20089;
+
+SeedSpec::SeedSpec()
+    : courses(10), questionsPerCourse(10000), topics(5), users(5000), results(100000),
+      historyDays(730), seed(20250101), codePrefix("SEED"), papers(true) {}
+
+string seedUsername(int index) {
+    char name[32];
+    sprintf(name, "seed%06d", index + 1);
+    return name;
+}
+
+string seedCourseCode(const SeedSpec& spec, int index) {
+    char code[32];
+    sprintf(code, "%s%03d", spec.codePrefix.c_str(), index + 1);
+    return code;
+}
+
+// Day number to calendar date (proleptic Gregorian, day 0 = 1970-01-01)
+static void civilFromDays(int days, int& year, int& month, int& day) {
+    days += 719468;
+    int era = (days >= 0 ? days : days - 146096) / 146097;
+    int dayOfEra = days - era * 146097;
+    int yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    int dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    int mp = (5 * dayOfYear + 2) / 153;
+    day = dayOfYear - (153 * mp + 2) / 5 + 1;
+    month = mp < 10 ? mp + 3 : mp - 9;
+    year = yearOfEra + era * 400 + (month <= 2 ? 1 : 0);
+}
+
+static string seedDateTime(int daysBack, int secondOfDay) {
+    int year, month, day;
+    civilFromDays(SEED_LAST_DAY - daysBack, year, month, day);
+    char text[32];
+    sprintf(text, "%04d-%02d-%02d %02d:%02d:%02d", year, month, day,
+            secondOfDay / 3600, secondOfDay / 60 % 60, secondOfDay % 60);
+    return text;
+}
+
+// Only raw mt19937 output is used: the standard fixes its sequence, while
+// the <random> distributions may differ between library implementations
+static int pick(mt19937& rng, int n) {
+    return n > 0 ? (int)(rng() % (unsigned int)n) : 0;
+}
+
+// Correct option of each question of a course, by question id - firstId
+struct SeedKey {
+    int firstId;
+    vector<signed char> codes;
+};
+
+static SeedKey seedKey(const vector<Question>& questions) {
+    SeedKey key;
+    key.firstId = questions.empty() ? 0 : questions[0].id;
+    int lastId = key.firstId;
+    for (size_t i = 0; i < questions.size(); i++) {
+        key.firstId = min(key.firstId, questions[i].id);
+        lastId = max(lastId, questions[i].id);
+    }
+    key.codes.assign(lastId - key.firstId + 1, -1);
+    for (size_t i = 0; i < questions.size(); i++) {
+        int slot = questions[i].id - key.firstId;
+        key.codes[slot] = (signed char)(questions[i].correctAnswer[0] - 'A');
+    }
+    return key;
+}
+
+static bool seedCourses(DatabaseManager* db, const SeedSpec& spec, mt19937& rng,
+                        vector<Course>& courses, vector<SeedKey>& keys,
+                        SeedStats& stats) {
+    int paperSize = spec.questionsPerCourse < SEED_PAPER_SIZE ? spec.questionsPerCourse
+                                                               : SEED_PAPER_SIZE;
+    for (int c = 0; c < spec.courses; c++) {
+        char title[64];
+        sprintf(title, "Seeded Course %d", c + 1);
+        string code = seedCourseCode(spec, c);
+        if (!db->addCourse(code, title, 60, paperSize, SEED_PASS_MARK)) {
+            return false;
+        }
+
+        Course course;
+        course.id = db->getCourseIdByCode(code);
+        course.courseCode = code;
+        course.courseTitle = title;
+        course.questionsPerExam = paperSize;
+        course.passingMark = SEED_PASS_MARK;
+        courses.push_back(course);
+        stats.courses++;
+
+        vector<Question> questions;
+        questions.reserve(spec.questionsPerCourse);
+        for (int i = 0; i < spec.questionsPerCourse; i++) {
+            char text[96];
+            sprintf(text, "%s question %d: which of the following is correct?",
+                    code.c_str(), i + 1);
+            Question q;
+            q.courseId = course.id;
+            q.questionText = text;
+            q.optionA = "First option";
+            q.optionB = "Second option";
+            q.optionC = "Third option";
+            q.optionD = "Fourth option";
+            q.correctAnswer = string(1, "ABCD"[pick(rng, 4)]);
+            q.points = 1;
+            if (spec.topics > 0) {
+                // Fixed pattern rather than rng draws, so the rest of the rows
+                // are the same whatever the topic count
+                char topic[32];
+                sprintf(topic, "topic%d", i % spec.topics + 1);
+                q.topic = topic;
+                q.difficulty = DIFFICULTY_EASY + (i / spec.topics) % 3;
+            }
+            questions.push_back(q);
+        }
+        int inserted = db->addQuestions(questions, NULL, SEED_CHUNK);
+        stats.questions += inserted;
+        if (inserted != (int)questions.size()) {
+            return false;
+        }
+        keys.push_back(seedKey(db->getCourseAnswerKey(course.id)));
+    }
+    return true;
+}
+
+static bool seedUsers(DatabaseManager* db, const SeedSpec& spec, vector<int>& userIds,
+                      SeedStats& stats) {
+    bool ok = db->beginTransaction();
+    for (int i = 0; ok && i < spec.users; i++) {
+        ok = db->addUser(seedUsername(i), SEED_PASSWORD, "candidate");
+        if (ok && i % SEED_CHUNK == SEED_CHUNK - 1) {
+            ok = db->commitTransaction() && db->beginTransaction();
+        }
+        if (ok) stats.users++;
+    }
+    if (!ok || !db->commitTransaction()) {
+        db->rollbackTransaction();
+        return false;
+    }
+
+    userIds.reserve(spec.users);
+    for (int i = 0; i < spec.users; i++) {
+        userIds.push_back(db->getUserIdByUsername(seedUsername(i)));
+    }
+    return true;
+}
+
+// A seeded paper of the course, answered by a candidate of the given
+// ability (0..999 = chance in a thousand of knowing each answer). Returns
+// the number answered correctly, or -1 if the paper couldn't be drawn.
+static int seedPaper(DatabaseManager* db, mt19937& rng, const SeedKey& key, int courseId,
+                     int paperSize, uint64_t seed, int ability, ResultPaper& paper) {
+    paper.courseId = courseId;
+    paper.seed = PaperSeed(0, seed, paperSize);
+    if (!db->getPaperQuestionIds(courseId, paper.seed, paper.questionIds)) {
+        return -1;
+    }
+    paper.answers.reset((int)paper.questionIds.size());
+    int correct = 0;
+    
+    for (size_t i = 0; i < paper.questionIds.size(); i++) {
+        int right = key.codes[paper.questionIds[i] - key.firstId];
+        // Known answers are right; guesses are any option or a blank (4)
+        int answer = pick(rng, 1000) < ability ? right : pick(rng, 5);
+        paper.answers.setCode((int)i, answer);
+        if (answer == right) correct++;
+    }
+    return correct;
+}
+
+static bool seedResults(DatabaseManager* db, const SeedSpec& spec, mt19937& rng,
+                        const vector<Course>& courses, const vector<SeedKey>& keys,
+                        const vector<int>& userIds, SeedStats& stats) {
+    if (courses.empty() || userIds.empty()) {
+        return true;
+    }
+
+    ResultPaper paper;
+    bool ok = db->beginTransaction();
+    for (int i = 0; ok && i < spec.results; i++) {
+        int user = pick(rng, (int)userIds.size());
+        int c = pick(rng, (int)courses.size());
+        const Course& course = courses[c];
+        int total = course.questionsPerExam > 0 ? course.questionsPerExam : 1;
+        // Mean of three draws: abilities bunch in the middle like a real cohort
+        int ability = (pick(rng, 1000) + pick(rng, 1000) + pick(rng, 1000)) / 3;
+
+        Result r;
+        r.userId = userIds[user];
+        r.username = seedUsername(user);
+        r.courseId = course.id;
+        r.courseCode = course.courseCode;
+        r.courseTitle = course.courseTitle;
+        r.dateTime = seedDateTime(pick(rng, spec.historyDays), pick(rng, 86400));
+        if (course.questionsPerExam > 0) {
+            // Negative sitting numbers keep seeded history apart from live attempts
+            uint64_t seed = paperSeedFor(r.userId, course.id, -(i + 1));
+            r.score = seedPaper(db, rng, keys[c], course.id, course.questionsPerExam, seed,
+                                ability, paper);
+            ok = r.score >= 0;
+        } else {
+            r.score = 0;
+        }
+        r.totalQuestions = total;
+        r.totalPoints = total;
+        r.percentage = r.score * 100.0 / total;
+        r.timeSpent = 300 + pick(rng, 3300);
+        r.passed = r.percentage >= course.passingMark;
+
+        int resultId = ok ? db->saveResult(r) : -1;
+        ok = resultId > 0;
+        if (ok && spec.papers && course.questionsPerExam > 0) {
+            ok = db->saveResultPaper(resultId, paper);
+        }
+        if (ok && i % SEED_CHUNK == SEED_CHUNK - 1) {
+            ok = db->commitTransaction() && db->beginTransaction();
+        }
+        if (ok) stats.results++;
+    }
+    if (!ok || !db->commitTransaction()) {
+        db->rollbackTransaction();
+        return false;
+    }
+    return true;
+}
+
+bool seedDatabase(DatabaseManager* db, const SeedSpec& spec, SeedStats* stats) {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    SeedStats local;
+    mt19937 rng(spec.seed);
+    vector<Course> courses;
+    vector<SeedKey> keys;
+    vector<int> userIds;
+
+    bool ok = seedCourses(db, spec, rng, courses, keys, local) &&
+              seedUsers(db, spec, userIds, local) &&
+              seedResults(db, spec, rng, courses, keys, userIds, local);
+
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    local.seconds = elapsed.count();
+    if (stats) {
+        *stats = local;
+    }
+    return ok;
+}
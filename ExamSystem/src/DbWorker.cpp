@@ -0,0 +1,95 @@
+#include "DbWorker.h"
+#include <FL/Fl.H>
+#include <chrono>
+
+using namespace std;
+
+DbWorker::DbWorker(const string& path, const StorageProfile& profile)
+    : stopping(false), busy(0) {
+    // Opened here so a failure shows up at startup; from now on only the
+    // worker thread touches this connection. A terminal of a hall server
+    // has no database; its jobs talk to the server instead.
+    db = path.empty() ? NULL : new DatabaseManager(path, profile);
+    if (!db || db->isReady()) {
+        worker = thread(&DbWorker::run, this);
+    }
+}
+
+DbWorker::~DbWorker() {
+    {
+        lock_guard<mutex> guard(queueLock);
+        stopping = true;
+    }
+    queueReady.notify_one();
+    if (worker.joinable()) {
+        worker.join();
+    }
+    delete db;
+}
+
+bool DbWorker::isReady() {
+    return !db || db->isReady();
+}
+
+string DbWorker::getLastError() {
+    return db ? db->getLastError() : "";
+}
+
+void DbWorker::post(DbJob job, DbDone done, void* data) {
+    Request request;
+    request.job = job;
+    request.done = done;
+    request.data = data;
+    {
+        lock_guard<mutex> guard(queueLock);
+        queue.push_back(request);
+    }
+    queueReady.notify_one();
+}
+
+int DbWorker::pending() {
+    lock_guard<mutex> guard(queueLock);
+    return (int)queue.size() + busy;
+}
+
+void DbWorker::notify(DbDone callback, void* data) {
+    // Fl::awake only fails when its queue is full; give the UI up to a
+    // second to drain it (it may already have left the event loop)
+    for (int attempt = 0; attempt < 200; attempt++) {
+        if (Fl::awake(callback, data) == 0) {
+            return;
+        }
+        this_thread::sleep_for(chrono::milliseconds(5));
+    }
+}
+
+void DbWorker::run() {
+    for (;;) {
+        Request request;
+        {
+            unique_lock<mutex> guard(queueLock);
+            while (queue.empty() && !stopping) {
+                queueReady.wait(guard);
+            }
+            if (queue.empty()) {
+                return;
+            }
+            request = queue.front();
+            queue.pop_front();
+            busy = 1;
+        }
+        
+        request.job(db, request.data);
+        
+        // Once shutting down the event loop has exited and nobody is listening
+        bool deliver;
+        {
+            lock_guard<mutex> guard(queueLock);
+            busy = 0;
+            deliver = !stopping;
+        }
+        if (request.done && deliver) {
+            notify(request.done, request.data);
+        }
+    }
+}
@@ -0,0 +1,10 @@
+#include "ExamSession.h"
+
+SessionAnswer::SessionAnswer() : position(0) {}
+
+SessionAnswer::SessionAnswer(int position, const string& answer)
+    : position(position), answer(answer) {}
+
+ExamSession::ExamSession()
+    : id(0), userId(0), courseId(0), currentIndex(0), timeRemaining(0), timeSpent(0),
+      startedAt(0) {}
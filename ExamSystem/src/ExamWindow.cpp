@@ -3,6 +3,8 @@
 #include "DatabaseManager.h"
 #include "CourseSelectionWindow.h"
 #include "ResultWindow.h"
+#include "PaperGenerator.h"
+#include "Grader.h"
 
 #include <FL/fl_ask.H>
 #include <cstdio>
@@ -11,6 +13,87 @@
 
 using namespace std;
 
+// Changed answers are written this often; the clock alone only every
+// CLOCK_SAVE_SECONDS, so an idle candidate costs almost nothing
+static const int AUTOSAVE_SECONDS = 5;
+static const int CLOCK_SAVE_SECONDS = 30;
+
+// Paper draw (or resume) and session start, run on the database worker
+struct PaperJob {
+    ExamWindow* exam;
+    int userId;
+    int courseId;
+    int count;
+    int timeAllocation;
+    SelectionMode mode;
+    Seat seat;
+    vector<Question> questions;
+    ExamSession session;
+    PaperSource source;
+    string error;           // why the hall server gave no paper
+};
+
+static void runPaperDraw(DatabaseManager* db, void* data) {
+    PaperJob* job = (PaperJob*)data;
+    if (hallClient) {
+        // The server sizes, times and draws the paper from the course
+        job->source = hallClient->startPaper(job->courseId, job->seat, job->questions,
+                                             job->session);
+        if (job->source == PAPER_NONE) job->error = hallClient->getLastError();
+        return;
+    }
+    job->source = preparePaper(db, job->userId, job->courseId, job->count,
+                               job->timeAllocation, job->questions, job->session, job->mode,
+                               job->seat);
+}
+
+// Periodic autosave, run on the database worker
+struct AutosaveJob {
+    ExamWindow* exam;
+    int sessionId;
+    int courseId;
+    vector<SessionAnswer> changes;
+    int currentIndex;
+    int timeRemaining;
+    int timeSpent;
+    bool saved;
+};
+
+static void runAutosave(DatabaseManager* db, void* data) {
+    AutosaveJob* job = (AutosaveJob*)data;
+    if (hallClient) {
+        job->saved = hallClient->saveSessionProgress(job->sessionId, job->courseId, job->changes,
+                                                     job->currentIndex, job->timeRemaining,
+                                                     job->timeSpent);
+        return;
+    }
+    job->saved = db->saveSessionProgress(job->sessionId, job->changes, job->currentIndex,
+                                         job->timeRemaining, job->timeSpent);
+}
+
+// Result write at submission, run on the database worker
+struct SubmitJob {
+    ExamWindow* exam;
+    Result result;
+    ResultPaper paper;
+    int resultId;
+    int sessionId;
+    vector<SessionAnswer> changes;
+    int timeSpent;
+};
+
+static void runSaveResult(DatabaseManager* db, void* data) {
+    SubmitJob* job = (SubmitJob*)data;
+    if (hallClient) {
+        // Graded by the server, which fills in the result
+        job->resultId = hallClient->submitResult(job->sessionId, job->paper.courseId,
+                                                 job->paper.answers.toAnswers(), job->changes,
+                                                 job->timeSpent, job->result);
+        return;
+    }
+    job->resultId = db->submitResult(job->result, job->paper, job->sessionId, job->changes);
+}
+
 void ExamWindow::timerCallback(void* data) {
     ExamWindow* exam = (ExamWindow*)data;
     exam->updateTimer();
@@ -78,8 +161,8 @@ void ExamWindow::updateTimer() {
             timerBox->labelcolor(fl_rgb_color(255, 140, 0));
         }
 
-        if (timeSpent % 30 == 0) {
-            saveCurrentAnswer();
+        if (timeSpent % AUTOSAVE_SECONDS == 0) {
+            autosave();
         }
 
         if (timeRemaining == 0) {
@@ -107,10 +190,13 @@ void ExamWindow::displayQuestion() {
 
     questionBox->value(q.questionText.c_str());
 
-    optionA->copy_label(("A. " + q.optionA).c_str());
-    optionB->copy_label(("B. " + q.optionB).c_str());
-    optionC->copy_label(("C. " + q.optionC).c_str());
-    optionD->copy_label(("D. " + q.optionD).c_str());
+    // Options in this candidate's order; the letters shown are what is recorded
+    const string* options[4] = { &q.optionA, &q.optionB, &q.optionC, &q.optionD };
+    int order = optionOrders[currentQuestionIndex];
+    optionA->copy_label(("A. " + *options[storedOption(order, 0)]).c_str());
+    optionB->copy_label(("B. " + *options[storedOption(order, 1)]).c_str());
+    optionC->copy_label(("C. " + *options[storedOption(order, 2)]).c_str());
+    optionD->copy_label(("D. " + *options[storedOption(order, 3)]).c_str());
 
     string prev = candidateAnswers[currentQuestionIndex];
     optionA->value(prev == "A" ? 1 : 0);
@@ -135,40 +221,179 @@ void ExamWindow::saveCurrentAnswer() {
     candidateAnswers[currentQuestionIndex] = answer;
 }
 
+vector<SessionAnswer> ExamWindow::changedAnswers() {
+    vector<SessionAnswer> changes;
+    for (size_t i = 0; i < candidateAnswers.size(); i++) {
+        if (candidateAnswers[i] != savedAnswers[i]) {
+            changes.push_back(SessionAnswer((int)i, candidateAnswers[i]));
+        }
+    }
+    return changes;
+}
+
+void ExamWindow::autosave() {
+    saveCurrentAnswer();
+    // One save in flight at a time; anything newer goes in the next one
+    if (sessionId <= 0 || autosaving) return;
+    
+    vector<SessionAnswer> changes = changedAnswers();
+    if (changes.empty() && timeSpent - clockSavedAt < CLOCK_SAVE_SECONDS) return;
+    
+    AutosaveJob* job = new AutosaveJob;
+    job->exam = this;
+    job->sessionId = sessionId;
+    job->courseId = selectedCourse->id;
+    job->changes.swap(changes);
+    job->currentIndex = currentQuestionIndex;
+    job->timeRemaining = timeRemaining;
+    job->timeSpent = timeSpent;
+    job->saved = false;
+    
+    autosaving = true;
+    dbWorker->post(runAutosave, autosaved, job);
+}
+
+void ExamWindow::autosaved(void* data) {
+    // Jobs complete in order, so the exam is still open: submission is
+    // queued behind any autosave already in flight
+    AutosaveJob* job = (AutosaveJob*)data;
+    ExamWindow* exam = job->exam;
+    exam->autosaving = false;
+    if (job->saved) {
+        for (size_t i = 0; i < job->changes.size(); i++) {
+            exam->savedAnswers[job->changes[i].position] = job->changes[i].answer;
+        }
+        exam->clockSavedAt = job->timeSpent;
+    }
+    // On failure the answers stay changed and go out with the next save
+    delete job;
+}
+
 void ExamWindow::submitExam() {
+    if (submitting) return;
+    submitting = true;
+    
     saveCurrentAnswer();
+    Fl::remove_timeout(timerCallback, this);
+
+    // A hall server's terminal has no answer key; the server grades
+    Result result;
+    if (!hallClient) {
+        result = gradeExam(examQuestions, candidateAnswers, *currentUser, *selectedCourse,
+                           timeSpent, paperSeed);
+    }
 
-    int totalScore = 0;
-    int totalPoints = 0;
+    prevBtn->deactivate();
+    nextBtn->deactivate();
+    submitBtn->deactivate();
+    submitBtn->label("Submitting...");
 
+    SubmitJob* job = new SubmitJob;
+    job->exam = this;
+    job->result = result;
+    job->paper.courseId = selectedCourse->id;
     for (size_t i = 0; i < examQuestions.size(); i++) {
-        Question& q = examQuestions[i];
-        string userAns = candidateAnswers[i];
-        bool correct = (userAns == q.correctAnswer);
-        totalPoints += q.points;
-        if (correct) totalScore += q.points;
+        job->paper.questionIds.push_back(examQuestions[i].id);
     }
+    job->paper.answers = AnswerSheet::fromAnswers(candidateAnswers);
+    job->paper.seed = paperSeed;
+    job->resultId = -1;
+    job->sessionId = sessionId;
+    job->changes = changedAnswers();
+    job->timeSpent = timeSpent;
+    dbWorker->post(runSaveResult, resultSaved, job);
+}
 
-    Result result;
-    result.userId = currentUser->id;
-    result.username = currentUser->username;
-    result.courseCode = selectedCourse->courseCode;
-    result.courseTitle = selectedCourse->courseTitle;
-    result.score = totalScore;
-    result.totalQuestions = examQuestions.size();
-    result.totalPoints = totalPoints;
-    result.percentage = (totalPoints > 0) ? (totalScore * 100.0 / totalPoints) : 0;
-    result.timeSpent = timeSpent;
-    result.passed = (result.percentage >= selectedCourse->passingMark);
-
-    dbManager->saveResult(result);
-
-    window->hide();
-    delete this;
+void ExamWindow::resultSaved(void* data) {
+    SubmitJob* job = (SubmitJob*)data;
+    ExamWindow* exam = job->exam;
+    Result result = job->result;
+    int resultId = job->resultId;
+    delete job;
+
+    if (resultId == 0) {
+        // Submitted already: by another terminal, or by this one on a hall
+        // server when the reply to the first submit was lost
+        fl_alert("This exam has already been submitted.");
+        exam->window->hide();
+        delete exam;
+        showCourseSelectionWindow();
+        return;
+    }
+    if (resultId < 0) {
+        // Answers are still in memory; let the candidate try again
+        fl_alert("Your exam could not be saved. Please click Submit Exam again.");
+        exam->submitting = false;
+        exam->submitBtn->label("Submit Exam");
+        exam->submitBtn->activate();
+        exam->displayQuestion();
+        // The clock, autosave and time-up submit carry on until it succeeds
+        if (exam->timeRemaining > 0) {
+            Fl::add_timeout(1.0, timerCallback, exam);
+        }
+        return;
+    }
+
+    result.id = resultId;
+    exam->window->hide();
+    delete exam;
 
     showResultWindow(result);
 }
 
+void ExamWindow::paperDrawn(void* data) {
+    PaperJob* job = (PaperJob*)data;
+    ExamWindow* exam = job->exam;
+    ExamSession& session = job->session;
+    bool resumed = job->source == PAPER_RESUMED;
+    exam->examQuestions.swap(job->questions);
+
+    if (job->source == PAPER_NONE) {
+        string error = job->error.empty() ? "No questions available for this course!" : job->error;
+        delete job;
+        fl_alert("Error: %s", error.c_str());
+        exam->window->hide();
+        delete exam;
+        showCourseSelectionWindow();
+        return;
+    }
+
+    // Fresh papers start blank; a resumed one picks up the saved state
+    exam->sessionId = session.id;
+    exam->paperSeed = session.seed;
+    exam->optionOrders = session.seed.optionOrders((int)exam->examQuestions.size());
+    exam->candidateAnswers = session.answers;
+    exam->savedAnswers = session.answers;
+    exam->timeRemaining = session.timeRemaining;
+    exam->timeSpent = session.timeSpent;
+    exam->clockSavedAt = session.timeSpent;
+    if (session.currentIndex >= 0 && session.currentIndex < (int)exam->examQuestions.size()) {
+        exam->currentQuestionIndex = session.currentIndex;
+    }
+    delete job;
+
+    char timerText[50];
+    sprintf(timerText, "Time: %02d:%02d", exam->timeRemaining / 60, exam->timeRemaining % 60);
+    exam->timerBox->copy_label(timerText);
+
+    exam->radioGroup->activate();
+    exam->submitBtn->activate();
+    exam->displayQuestion();
+
+    if (resumed) {
+        fl_message("Your unfinished exam has been restored.\n\n"
+                   "Your saved answers and remaining time have been kept.");
+        if (exam->timeRemaining <= 0) {
+            fl_alert("Time is up! Exam will be auto-submitted.");
+            exam->submitExam();
+            return;
+        }
+    }
+
+    // The clock starts once the candidate can see the first question
+    Fl::add_timeout(1.0, timerCallback, exam);
+}
+
 // ======================
 // Constructor & Destructor
 // ======================
@@ -182,19 +407,13 @@ ExamWindow::ExamWindow() {
     window = new Fl_Window(950, 700, "Examination in Progress");
     window->color(fl_rgb_color(245, 245, 250));
 
-    examQuestions = dbManager->getRandomQuestions(selectedCourse->id, selectedCourse->questionsPerExam);
-    if (examQuestions.empty()) {
-        fl_alert("Error: No questions available for this course!");
-        window->hide();
-        delete this;
-        showCourseSelectionWindow();
-        return;
-    }
-
-    candidateAnswers.resize(examQuestions.size(), "");
     currentQuestionIndex = 0;
     timeRemaining = selectedCourse->timeAllocation * 60;
     timeSpent = 0;
+    submitting = false;
+    sessionId = 0;
+    autosaving = false;
+    clockSavedAt = 0;
 
     // --- UI elements ---
     Fl_Box* header = new Fl_Box(300, 10, 350, 30, "Course-Based Examination");
@@ -263,14 +482,32 @@ ExamWindow::ExamWindow() {
     submitBtn->callback(submitCallback, this);
 
     Fl_Box* warning = new Fl_Box(30, 475, 890, 30);
-    warning->copy_label("Security: Copy/Paste disabled | Auto-save every 30 seconds | Answer all questions");
+    warning->copy_label("Security: Copy/Paste disabled | Answers auto-saved every 5 seconds | Answer all questions");
     warning->labelsize(10); warning->labelcolor(FL_RED); warning->labelfont(FL_BOLD);
 
     window->end();
 
     Fl::add_handler(eventHandler);
-    displayQuestion();
-    Fl::add_timeout(1.0, timerCallback, this);
+
+    // The paper is drawn on the database worker; until it arrives the
+    // window shows a placeholder and nothing can be answered
+    questionNumberBox->label("Preparing your paper...");
+    questionBox->value("Please wait while your examination paper is prepared.");
+    radioGroup->deactivate();
+    prevBtn->deactivate();
+    nextBtn->deactivate();
+    submitBtn->deactivate();
+
+    PaperJob* job = new PaperJob;
+    job->exam = this;
+    job->userId = currentUser->id;
+    job->courseId = selectedCourse->id;
+    job->count = selectedCourse->questionsPerExam;
+    job->timeAllocation = timeRemaining;
+    job->mode = selectedCourse->selectionMode;
+    job->seat = terminalSeat;
+    job->source = PAPER_NONE;
+    dbWorker->post(runPaperDraw, paperDrawn, job);
 }
 
 ExamWindow::~ExamWindow() {
@@ -0,0 +1,31 @@
+#include "Grader.h"
+
+using namespace std;
+
+Result gradeExam(const vector<Question>& questions, const vector<string>& answers,
+                 const User& candidate, const Course& course, int timeSpent,
+                 const PaperSeed& seed) {
+    AnswerKey key(questions);
+    key.applyOptionOrders(seed.optionOrders((int)questions.size()));
+    return gradeExam(key, AnswerSheet::fromAnswers(answers), candidate, course, timeSpent);
+}
+
+Result gradeExam(const AnswerKey& key, const AnswerSheet& sheet,
+                 const User& candidate, const Course& course, int timeSpent) {
+    int totalScore = scoreSheet(key, sheet);
+    int totalPoints = key.totalPoints;
+    
+    Result result;
+    result.userId = candidate.id;
+    result.username = candidate.username;
+    result.courseId = course.id;
+    result.courseCode = course.courseCode;
+    result.courseTitle = course.courseTitle;
+    result.score = totalScore;
+    result.totalQuestions = key.options.size;
+    result.totalPoints = totalPoints;
+    result.percentage = (totalPoints > 0) ? (totalScore * 100.0 / totalPoints) : 0;
+    result.timeSpent = timeSpent;
+    result.passed = (result.percentage >= course.passingMark);
+    return result;
+}
@@ -0,0 +1,400 @@
+#include "HallClient.h"
+#include "HallProtocol.h"
+#include <cstring>
+#include <cstdlib>
+#include <errno.h>
+#ifndef _WIN32
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// A reply slower than this means the server is gone or stuck
+static const int REPLY_TIMEOUT_SECONDS = 30;
+
+HallClient::HallClient() : fd(-1), userId(0) {}
+
+HallClient::~HallClient() {
+    closeSocket();
+}
+
+string HallClient::getLastError() {
+    lock_guard<mutex> guard(callLock);
+    return lastError;
+}
+
+bool HallClient::connect(const string& serverAddress) {
+    lock_guard<mutex> guard(callLock);
+    closeSocket();
+    address = serverAddress;
+    return open();
+}
+
+void HallClient::closeSocket() {
+#ifndef _WIN32
+    if (fd >= 0) {
+        close(fd);
+    }
+#endif
+    fd = -1;
+}
+
+#ifdef _WIN32
+
+bool HallClient::open() {
+    lastError = "Terminals can't connect to a hall server on Windows yet";
+    return false;
+}
+
+bool HallClient::sendFrame(const vector<unsigned char>& frame) {
+    return false;
+}
+
+bool HallClient::readFrame(vector<unsigned char>& frame) {
+    return false;
+}
+
+#else
+
+bool HallClient::open() {
+    size_t colon = address.rfind(':');
+    if (address.empty()) {
+        lastError = "No server address";
+        return false;
+    }
+
+    if (address.find('/') != string::npos || colon == string::npos) {
+        sockaddr_un local;
+        memset(&local, 0, sizeof(local));
+        local.sun_family = AF_UNIX;
+        if (address.size() >= sizeof(local.sun_path)) {
+            lastError = "Socket path too long: " + address;
+            return false;
+        }
+        strcpy(local.sun_path, address.c_str());
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && ::connect(fd, (sockaddr*)&local, sizeof(local)) != 0) {
+            closeSocket();
+        }
+    } else {
+        string host = colon == 0 ? "127.0.0.1" : address.substr(0, colon);
+        string port = address.substr(colon + 1);
+        addrinfo hints;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* found = NULL;
+        if (getaddrinfo(host.c_str(), port.c_str(), &hints, &found) != 0 || !found) {
+            lastError = "Unknown server address: " + address;
+            return false;
+        }
+        fd = socket(found->ai_family, found->ai_socktype, found->ai_protocol);
+        if (fd >= 0 && ::connect(fd, found->ai_addr, found->ai_addrlen) != 0) {
+            closeSocket();
+        }
+        freeaddrinfo(found);
+        if (fd >= 0) {
+            int on = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        }
+    }
+
+    if (fd < 0) {
+        lastError = "Could not reach the exam server at " + address + ": " + strerror(errno);
+        return false;
+    }
+    timeval timeout;
+    timeout.tv_sec = REPLY_TIMEOUT_SECONDS;
+    timeout.tv_usec = 0;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+    return true;
+}
+
+bool HallClient::sendFrame(const vector<unsigned char>& frame) {
+    size_t sent = 0;
+    while (sent < frame.size()) {
+#ifdef MSG_NOSIGNAL
+        ssize_t n = send(fd, &frame[sent], frame.size() - sent, MSG_NOSIGNAL);
+#else
+        ssize_t n = send(fd, &frame[sent], frame.size() - sent, 0);
+#endif
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        sent += n;
+    }
+    return true;
+}
+
+bool HallClient::readFrame(vector<unsigned char>& frame) {
+    unsigned char header[HALL_FRAME_HEADER];
+    size_t got = 0;
+    while (got < sizeof(header)) {
+        ssize_t n = recv(fd, header + got, sizeof(header) - got, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        got += n;
+    }
+    uint32_t length = hallFrameLength(header);
+    if (length == 0 || length > HALL_MAX_FRAME) {
+        return false;
+    }
+    frame.resize(length);
+    got = 0;
+    while (got < length) {
+        ssize_t n = recv(fd, &frame[got], length - got, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        got += n;
+    }
+    return true;
+}
+
+#endif
+
+bool HallClient::resume() {
+    MessageWriter request(HALL_RESUME);
+    request.putString(sessionToken);
+    vector<unsigned char> reply;
+    if (!sendFrame(request.finish()) || !readFrame(reply)) {
+        closeSocket();
+        return true;
+    }
+    MessageReader reader(&reply[0], reply.size());
+    int id = reader.getInt();
+    reader.getString();
+    reader.getString();
+    if (reader.type == HALL_OK && reader.ok && id == userId) {
+        return true;
+    }
+    username.clear();
+    sessionToken.clear();
+    userId = 0;
+    lastError = "The exam server rejected the login; please sign in again";
+    return false;
+}
+
+bool HallClient::exchange(const vector<unsigned char>& request, vector<unsigned char>& reply) {
+    // Caller holds callLock
+    bool sent = false;
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (fd < 0) {
+            if (!open()) return false;
+            // A new connection is a new terminal to the server
+            if (!sessionToken.empty()) {
+                if (!resume()) return false;
+                if (fd < 0) continue;
+            }
+        }
+        sent = sendFrame(request);
+        if (sent && readFrame(reply)) {
+            return true;
+        }
+        closeSocket();
+        if (sent) {
+            // It may have been acted on; only the caller can tell
+            break;
+        }
+    }
+    lastError = sent ? "The exam server did not answer" : "Lost the connection to the exam server";
+    return false;
+}
+
+bool HallClient::call(const vector<unsigned char>& request, vector<unsigned char>& reply) {
+    if (!exchange(request, reply)) {
+        reply.clear();
+        return false;
+    }
+    MessageReader reader(&reply[0], reply.size());
+    if (reader.type == HALL_ERROR || reader.type == HALL_CLOSED) {
+        lastError = reader.getString();
+        return false;
+    }
+    if (reader.type != HALL_OK) {
+        lastError = "Unexpected reply from the exam server";
+        return false;
+    }
+    return true;
+}
+
+User* HallClient::login(const string& user, const string& pass) {
+    lock_guard<mutex> guard(callLock);
+    // A connection lost now is signed in by this login, not the last one's token
+    username.clear();
+    sessionToken.clear();
+    userId = 0;
+    MessageWriter request(HALL_LOGIN);
+    request.putString(user);
+    request.putString(pass);
+    vector<unsigned char> reply;
+    if (!call(request.finish(), reply)) {
+        return NULL;
+    }
+    MessageReader reader(&reply[0], reply.size());
+    User* signedIn = new User();
+    signedIn->id = reader.getInt();
+    signedIn->username = reader.getString();
+    signedIn->role = reader.getString();
+    string token = reader.getString();
+    if (!reader.ok || token.empty()) {
+        delete signedIn;
+        lastError = "Malformed reply from the exam server";
+        return NULL;
+    }
+    username = signedIn->username;
+    sessionToken = token;
+    userId = signedIn->id;
+    return signedIn;
+}
+
+vector<Course> HallClient::getCourses() {
+    lock_guard<mutex> guard(callLock);
+    vector<Course> courses;
+    vector<unsigned char> reply;
+    if (!call(MessageWriter(HALL_COURSES).finish(), reply)) {
+        return courses;
+    }
+    MessageReader reader(&reply[0], reply.size());
+    courses.resize(reader.getCount(29));
+    for (size_t i = 0; i < courses.size(); i++) {
+        courses[i].id = reader.getInt();
+        courses[i].courseCode = reader.getString();
+        courses[i].courseTitle = reader.getString();
+        courses[i].timeAllocation = reader.getInt();
+        courses[i].questionsPerExam = reader.getInt();
+        courses[i].passingMark = reader.getInt();
+        courses[i].totalQuestions = reader.getInt();
+        courses[i].selectionMode = (SelectionMode)reader.getU8();
+    }
+    if (!reader.ok) {
+        lastError = "Malformed reply from the exam server";
+        courses.clear();
+    }
+    return courses;
+}
+
+PaperSource HallClient::startPaper(int courseId, const Seat& seat, vector<Question>& questions,
+                                   ExamSession& session) {
+    lock_guard<mutex> guard(callLock);
+    MessageWriter request(HALL_START_PAPER);
+    request.putInt(courseId);
+    request.putInt(seat.row);
+    request.putInt(seat.column);
+    vector<unsigned char> reply;
+    questions.clear();
+    if (!call(request.finish(), reply)) {
+        return PAPER_NONE;
+    }
+
+    MessageReader reader(&reply[0], reply.size());
+    PaperSource source = (PaperSource)reader.getU8();
+    session = ExamSession();
+    session.id = reader.getInt();
+    session.userId = userId;
+    session.courseId = courseId;
+    session.answers.resize(reader.getCount(1));
+    for (size_t i = 0; i < session.answers.size(); i++) {
+        session.answers[i] = reader.getAnswer();
+    }
+    session.currentIndex = reader.getInt();
+    session.timeRemaining = reader.getInt();
+    session.timeSpent = reader.getInt();
+    session.seed.poolVersion = reader.getInt();
+    session.seed.value = reader.getU64();
+    session.seed.questionCount = reader.getInt();
+    session.seed.shuffledOptions = reader.getU8() != 0;
+    questions.resize(reader.getCount(28));
+    for (size_t i = 0; i < questions.size(); i++) {
+        questions[i].id = reader.getInt();
+        questions[i].courseId = courseId;
+        questions[i].questionText = reader.getString();
+        questions[i].optionA = reader.getString();
+        questions[i].optionB = reader.getString();
+        questions[i].optionC = reader.getString();
+        questions[i].optionD = reader.getString();
+        questions[i].points = reader.getInt();
+        session.questionIds.push_back(questions[i].id);
+    }
+    if (!reader.ok || session.answers.size() != questions.size()) {
+        lastError = "Malformed reply from the exam server";
+        questions.clear();
+        return PAPER_NONE;
+    }
+    return source;
+}
+
+bool HallClient::saveSessionProgress(int sessionId, int courseId,
+                                     const vector<SessionAnswer>& changes, int currentIndex,
+                                     int timeRemaining, int timeSpent) {
+    lock_guard<mutex> guard(callLock);
+    MessageWriter request(HALL_SAVE_PROGRESS);
+    request.putInt(sessionId);
+    request.putInt(courseId);
+    request.putInt((int)changes.size());
+    for (size_t i = 0; i < changes.size(); i++) {
+        request.putInt(changes[i].position);
+        request.putAnswer(changes[i].answer);
+    }
+    request.putInt(currentIndex);
+    request.putInt(timeRemaining);
+    request.putInt(timeSpent);
+    vector<unsigned char> reply;
+    return call(request.finish(), reply);
+}
+
+int HallClient::submitResult(int sessionId, int courseId, const vector<string>& answers,
+                             const vector<SessionAnswer>& finalChanges, int timeSpent,
+                             Result& result) {
+    lock_guard<mutex> guard(callLock);
+    MessageWriter request(HALL_SUBMIT);
+    request.putInt(sessionId);
+    request.putInt(courseId);
+    request.putInt(timeSpent);
+    request.putInt((int)answers.size());
+    for (size_t i = 0; i < answers.size(); i++) {
+        request.putAnswer(answers[i]);
+    }
+    request.putInt((int)finalChanges.size());
+    for (size_t i = 0; i < finalChanges.size(); i++) {
+        request.putInt(finalChanges[i].position);
+        request.putAnswer(finalChanges[i].answer);
+    }
+    vector<unsigned char> reply;
+    if (!call(request.finish(), reply)) {
+        // Already submitted, most likely by the send whose reply was lost
+        if (!reply.empty() && MessageReader(&reply[0], reply.size()).type == HALL_CLOSED) {
+            return 0;
+        }
+        return -1;
+    }
+
+    MessageReader reader(&reply[0], reply.size());
+    result = Result();
+    result.id = reader.getInt();
+    result.userId = userId;
+    result.username = username;
+    result.courseId = courseId;
+    result.score = reader.getInt();
+    result.totalQuestions = reader.getInt();
+    result.totalPoints = reader.getInt();
+    result.percentage = reader.getDouble();
+    result.passed = reader.getU8() != 0;
+    result.courseCode = reader.getString();
+    result.courseTitle = reader.getString();
+    result.timeSpent = timeSpent;
+    if (!reader.ok) {
+        lastError = "Malformed reply from the exam server";
+        return -1;
+    }
+    return result.id;
+}
@@ -0,0 +1,132 @@
+#include "HallProtocol.h"
+#include <cstring>
+
+using namespace std;
+
+MessageWriter::MessageWriter(int type) {
+    bytes.reserve(64);
+    bytes.resize(HALL_FRAME_HEADER);
+    putU8(type);
+}
+
+void MessageWriter::putU8(int value) {
+    bytes.push_back((unsigned char)value);
+}
+
+void MessageWriter::putInt(int value) {
+    uint32_t v = (uint32_t)value;
+    for (int i = 0; i < 4; i++) {
+        bytes.push_back((unsigned char)(v >> (8 * i)));
+    }
+}
+
+void MessageWriter::putU64(uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        bytes.push_back((unsigned char)(value >> (8 * i)));
+    }
+}
+
+void MessageWriter::putDouble(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    putU64(bits);
+}
+
+void MessageWriter::putString(const string& value) {
+    putInt((int)value.size());
+    bytes.insert(bytes.end(), value.begin(), value.end());
+}
+
+void MessageWriter::putAnswer(const string& answer) {
+    bool valid = answer.size() == 1 && answer[0] >= 'A' && answer[0] <= 'D';
+    putU8(valid ? answer[0] : 0);
+}
+
+const vector<unsigned char>& MessageWriter::finish() {
+    uint32_t length = (uint32_t)(bytes.size() - HALL_FRAME_HEADER);
+    for (int i = 0; i < 4; i++) {
+        bytes[i] = (unsigned char)(length >> (8 * i));
+    }
+    return bytes;
+}
+
+uint32_t hallFrameLength(const unsigned char* header) {
+    return (uint32_t)header[0] | ((uint32_t)header[1] << 8) |
+           ((uint32_t)header[2] << 16) | ((uint32_t)header[3] << 24);
+}
+
+MessageReader::MessageReader(const unsigned char* frame, size_t frameSize)
+    : data(frame), size(frameSize), pos(0), ok(true), type(0) {
+    type = getU8();
+}
+
+int MessageReader::getU8() {
+    if (!ok || pos + 1 > size) {
+        ok = false;
+        return 0;
+    }
+    return data[pos++];
+}
+
+int MessageReader::getInt() {
+    if (!ok || pos + 4 > size) {
+        ok = false;
+        return 0;
+    }
+    uint32_t v = hallFrameLength(data + pos);
+    pos += 4;
+    return (int)v;
+}
+
+uint64_t MessageReader::getU64() {
+    if (!ok || pos + 8 > size) {
+        ok = false;
+        return 0;
+    }
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) {
+        v = (v << 8) | data[pos + i];
+    }
+    pos += 8;
+    return v;
+}
+
+double MessageReader::getDouble() {
+    uint64_t bits = getU64();
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+string MessageReader::getString() {
+    int length = getInt();
+    if (!ok || length < 0 || pos + (size_t)length > size) {
+        ok = false;
+        return "";
+    }
+    string value((const char*)data + pos, (size_t)length);
+    pos += length;
+    return value;
+}
+
+string MessageReader::getAnswer() {
+    int code = getU8();
+    if (code >= 'A' && code <= 'D') {
+        return string(1, (char)code);
+    }
+    if (code != 0) ok = false;
+    return "";
+}
+
+int MessageReader::getCount(size_t minItemBytes) {
+    int count = getInt();
+    if (!ok || count < 0 || (size_t)count * minItemBytes > size - pos) {
+        ok = false;
+        return 0;
+    }
+    return count;
+}
+
+bool MessageReader::atEnd() const {
+    return pos == size;
+}
@@ -0,0 +1,911 @@
+#include "HallServer.h"
+#include "HallProtocol.h"
+#include "PaperGenerator.h"
+#include "Grader.h"
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <openssl/rand.h>
+#include <errno.h>
+#include <cstring>
+#include <cstdio>
+#include <ctime>
+#include <algorithm>
+#ifdef __linux__
+#include <sys/epoll.h>
+#else
+#include <poll.h>
+#endif
+
+using namespace std;
+
+static const int MAX_WORKERS = 16;
+// A terminal waits for each reply, so more than this queued is abuse
+static const size_t MAX_QUEUED_REQUESTS = 16;
+static const size_t READ_CHUNK = 65536;
+static const int MAX_EVENTS = 256;
+// Allowance past a sitting's time for the terminal's own clock and the
+// time-up submit's trip; after it only the saved answers count
+static const int DEADLINE_GRACE_SECONDS = 30;
+
+// Which of the server's sockets are ready: epoll where there is one,
+// poll() elsewhere, which is fine for a hall's few hundred sockets
+class Poller {
+public:
+    enum { READABLE = 1, WRITABLE = 2 };
+    struct Event {
+        int fd;
+        int flags;
+    };
+
+#ifdef __linux__
+    int epollFd;
+
+    Poller() : epollFd(epoll_create1(EPOLL_CLOEXEC)) {}
+    ~Poller() {
+        if (epollFd >= 0) close(epollFd);
+    }
+    bool isReady() {
+        return epollFd >= 0;
+    }
+    bool add(int fd) {
+        epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        return epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) == 0;
+    }
+    void setWritable(int fd, bool writable) {
+        epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = writable ? EPOLLIN | EPOLLOUT : EPOLLIN;
+        ev.data.fd = fd;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &ev);
+    }
+    void remove(int fd) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, NULL);
+    }
+    void wait(vector<Event>& events) {
+        epoll_event ready[MAX_EVENTS];
+        events.clear();
+        int n = epoll_wait(epollFd, ready, MAX_EVENTS, -1);
+        for (int i = 0; i < n; i++) {
+            Event e;
+            e.fd = ready[i].data.fd;
+            // A hang-up or error is seen by the next read
+            e.flags = (ready[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR) ? READABLE : 0) |
+                      (ready[i].events & EPOLLOUT ? WRITABLE : 0);
+            events.push_back(e);
+        }
+    }
+#else
+    map<int, short> watched;
+
+    bool isReady() {
+        return true;
+    }
+    bool add(int fd) {
+        watched[fd] = POLLIN;
+        return true;
+    }
+    void setWritable(int fd, bool writable) {
+        watched[fd] = writable ? POLLIN | POLLOUT : POLLIN;
+    }
+    void remove(int fd) {
+        watched.erase(fd);
+    }
+    void wait(vector<Event>& events) {
+        vector<pollfd> fds;
+        for (map<int, short>::iterator it = watched.begin(); it != watched.end(); ++it) {
+            pollfd p;
+            p.fd = it->first;
+            p.events = it->second;
+            p.revents = 0;
+            fds.push_back(p);
+        }
+        events.clear();
+        if (poll(&fds[0], fds.size(), -1) <= 0) return;
+        for (size_t i = 0; i < fds.size(); i++) {
+            if (!fds[i].revents) continue;
+            Event e;
+            e.fd = fds[i].fd;
+            e.flags = (fds[i].revents & (POLLIN | POLLHUP | POLLERR) ? READABLE : 0) |
+                      (fds[i].revents & POLLOUT ? WRITABLE : 0);
+            events.push_back(e);
+        }
+    }
+#endif
+};
+
+static bool setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+static ssize_t sendSome(int fd, const unsigned char* data, size_t size) {
+#ifdef MSG_NOSIGNAL
+    return send(fd, data, size, MSG_NOSIGNAL);
+#else
+    return send(fd, data, size, 0);
+#endif
+}
+
+static void errorReply(vector<unsigned char>& reply, const string& message) {
+    MessageWriter writer(HALL_ERROR);
+    writer.putString(message);
+    reply = writer.finish();
+}
+
+// The sitting was submitted; retrying won't help
+static void closedReply(vector<unsigned char>& reply) {
+    MessageWriter writer(HALL_CLOSED);
+    writer.putString("This exam has already been submitted");
+    reply = writer.finish();
+}
+
+HallServer::HallServer(const string& path, const StorageProfile& storage, int workerThreads)
+    : dbPath(path), profile(storage), workerCount(workerThreads), submissions(NULL),
+      wakeRead(-1), wakeWrite(-1), poller(NULL), nextTerminalId(1), stopping(false), stopRequested(false) {
+    // Also the first connection; if it can't open the database nothing can
+    submissions = new SubmissionQueue(dbPath, profile);
+    if (!submissions->isReady()) {
+        lastError = submissions->getLastError();
+        return;
+    }
+
+    // Workers and stop() wake the event loop through this pipe
+    int wake[2];
+    if (pipe(wake) != 0) {
+        lastError = string("Could not create the wake-up pipe: ") + strerror(errno);
+        return;
+    }
+    wakeRead = wake[0];
+    wakeWrite = wake[1];
+    setNonBlocking(wakeRead);
+    setNonBlocking(wakeWrite);
+
+    if (workerCount <= 0) {
+        workerCount = (int)thread::hardware_concurrency();
+    }
+    workerCount = max(1, min(workerCount, MAX_WORKERS));
+    for (int i = 0; i < workerCount; i++) {
+        workers.push_back(thread(&HallServer::workerLoop, this));
+    }
+}
+
+HallServer::~HallServer() {
+    {
+        lock_guard<mutex> guard(jobLock);
+        stopping = true;
+    }
+    jobReady.notify_all();
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+    // Waits for submissions still being written; their replies go nowhere
+    delete submissions;
+    for (size_t i = 0; i < jobs.size(); i++) delete jobs[i];
+    for (size_t i = 0; i < replies.size(); i++) delete replies[i];
+
+    while (!terminals.empty()) {
+        closeTerminal(terminals.begin()->first);
+    }
+    for (size_t i = 0; i < listeners.size(); i++) {
+        close(listeners[i]);
+    }
+    if (!unixPath.empty()) {
+        unlink(unixPath.c_str());
+    }
+    if (wakeRead >= 0) close(wakeRead);
+    if (wakeWrite >= 0) close(wakeWrite);
+}
+
+bool HallServer::isReady() {
+    return wakeRead >= 0 && !workers.empty();
+}
+
+string HallServer::getLastError() {
+    return lastError;
+}
+
+bool HallServer::addListener(int fd) {
+    if (listen(fd, SOMAXCONN) != 0 || !setNonBlocking(fd)) {
+        lastError = string("Could not listen: ") + strerror(errno);
+        close(fd);
+        return false;
+    }
+    listeners.push_back(fd);
+    return true;
+}
+
+bool HallServer::listenUnix(const string& socketPath) {
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path)) {
+        lastError = "Socket path is empty or too long: " + socketPath;
+        return false;
+    }
+    strcpy(address.sun_path, socketPath.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        lastError = string("Could not create a socket: ") + strerror(errno);
+        return false;
+    }
+    // A socket file left behind by a server that died
+    unlink(socketPath.c_str());
+    if (bind(fd, (sockaddr*)&address, sizeof(address)) != 0) {
+        lastError = "Could not bind " + socketPath + ": " + strerror(errno);
+        close(fd);
+        return false;
+    }
+    unixPath = socketPath;
+    return addListener(fd);
+}
+
+bool HallServer::listenTcp(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        lastError = string("Could not create a socket: ") + strerror(errno);
+        return false;
+    }
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    // Terminals on this box only; the protocol has no encryption
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons((unsigned short)port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, (sockaddr*)&address, sizeof(address)) != 0) {
+        char msg[100];
+        sprintf(msg, "Could not bind 127.0.0.1:%d: ", port);
+        lastError = msg + string(strerror(errno));
+        close(fd);
+        return false;
+    }
+    return addListener(fd);
+}
+
+void HallServer::stop() {
+    // Only async-signal-safe calls here
+    stopRequested = true;
+    if (wakeWrite >= 0) {
+        ssize_t written = write(wakeWrite, "s", 1);
+        (void)written;
+    }
+}
+
+HallServerStats HallServer::getStats() {
+    lock_guard<mutex> guard(statsLock);
+    return totals;
+}
+
+// Finishes a SUBMIT once its group is committed, on the queue's writer thread
+struct SubmitReply {
+    HallServer* server;
+    void* job;
+    Result result;
+};
+
+void HallServer::workerLoop() {
+    DatabaseManager db(dbPath, profile);
+    for (;;) {
+        Job* job = NULL;
+        {
+            unique_lock<mutex> guard(jobLock);
+            while (jobs.empty() && !stopping) {
+                jobReady.wait(guard);
+            }
+            if (stopping) {
+                return;
+            }
+            job = jobs.front();
+            jobs.pop_front();
+        }
+
+        if (!db.isReady()) {
+            job->failed = true;
+            errorReply(job->reply, "The server cannot open the exam database");
+        } else if (!handle(&db, job)) {
+            // Submitted; the queue hands the reply back when it is committed
+            continue;
+        }
+        complete(job);
+    }
+}
+
+void HallServer::complete(Job* job) {
+    {
+        lock_guard<mutex> guard(statsLock);
+        totals.requests++;
+        if (job->failed) totals.errors++;
+    }
+    {
+        lock_guard<mutex> guard(jobLock);
+        replies.push_back(job);
+    }
+    // A full pipe already holds a wake-up
+    ssize_t written = write(wakeWrite, "r", 1);
+    (void)written;
+}
+
+void HallServer::submitted(int resultId, void* data) {
+    SubmitReply* pending = (SubmitReply*)data;
+    Job* job = (Job*)pending->job;
+    const Result& r = pending->result;
+    if (resultId > 0) {
+        MessageWriter writer(HALL_OK);
+        writer.putInt(resultId);
+        writer.putInt(r.score);
+        writer.putInt(r.totalQuestions);
+        writer.putInt(r.totalPoints);
+        writer.putDouble(r.percentage);
+        writer.putU8(r.passed ? 1 : 0);
+        writer.putString(r.courseCode);
+        writer.putString(r.courseTitle);
+        job->reply = writer.finish();
+        job->state.sessionId = 0;
+        job->failed = false;
+    } else if (resultId == 0) {
+        job->failed = true;
+        job->state.sessionId = 0;
+        closedReply(job->reply);
+    } else {
+        job->failed = true;
+        errorReply(job->reply, "Your exam could not be saved");
+    }
+    HallServer* server = pending->server;
+    delete pending;
+    server->complete(job);
+}
+
+// A terminal's clock is only a hint: a sitting can't have taken longer than
+// it has been open on the server, nor have more time left than that leaves
+static void capTimes(long long startedAt, int timeAllowed, int& timeRemaining, int& timeSpent) {
+    long long elapsed = max(0LL, (long long)time(NULL) - startedAt);
+    int serverSpent = (int)min(elapsed, (long long)timeAllowed);
+    timeSpent = max(0, min(timeSpent, serverSpent));
+    timeRemaining = max(0, min(timeRemaining, timeAllowed - serverSpent));
+}
+
+static bool pastDeadline(long long startedAt, int timeAllowed) {
+    return (long long)time(NULL) > startedAt + timeAllowed + DEADLINE_GRACE_SECONDS;
+}
+
+string HallServer::issueToken(int userId, const string& username) {
+    unsigned char bytes[16];
+    if (RAND_bytes(bytes, sizeof(bytes)) != 1) {
+        return "";
+    }
+    static const char hex[] = "0123456789abcdef";
+    string token;
+    for (size_t i = 0; i < sizeof(bytes); i++) {
+        token += hex[bytes[i] >> 4];
+        token += hex[bytes[i] & 15];
+    }
+
+    lock_guard<mutex> guard(tokenLock);
+    map<int, string>::iterator previous = tokenByUser.find(userId);
+    if (previous != tokenByUser.end()) {
+        signedIn.erase(previous->second);
+    }
+    tokenByUser[userId] = token;
+    SignedIn& user = signedIn[token];
+    user.userId = userId;
+    user.username = username;
+    return token;
+}
+
+// Every answer a terminal sends must be for a question on the paper
+static bool onPaper(const vector<SessionAnswer>& changes, int questionCount) {
+    for (size_t i = 0; i < changes.size(); i++) {
+        if (changes[i].position >= questionCount) return false;
+    }
+    return true;
+}
+
+bool HallServer::handle(DatabaseManager* db, Job* job) {
+    MessageReader request(job->request.empty() ? NULL : &job->request[0], job->request.size());
+    TerminalState& state = job->state;
+    job->failed = true;
+
+    if (request.type != HALL_LOGIN && request.type != HALL_RESUME && state.userId <= 0) {
+        errorReply(job->reply, "Not logged in");
+        return true;
+    }
+
+    switch (request.type) {
+    case HALL_LOGIN: {
+        string username = request.getString();
+        string password = request.getString();
+        if (!request.ok || !request.atEnd()) break;
+        User* user = db->authenticateUser(username, password);
+        if (!user) {
+            errorReply(job->reply, "Invalid credentials or account locked");
+            return true;
+        }
+        if (user->role != "candidate") {
+            delete user;
+            errorReply(job->reply, "Administrators sign in on the server itself");
+            return true;
+        }
+        string token = issueToken(user->id, user->username);
+        if (token.empty()) {
+            delete user;
+            errorReply(job->reply, "Could not start a session");
+            return true;
+        }
+        state.userId = user->id;
+        state.username = user->username;
+        state.sessionId = 0;
+        MessageWriter writer(HALL_OK);
+        writer.putInt(user->id);
+        writer.putString(user->username);
+        writer.putString(user->role);
+        writer.putString(token);
+        delete user;
+        job->reply = writer.finish();
+        job->failed = false;
+        return true;
+    }
+
+    case HALL_RESUME: {
+        string token = request.getString();
+        if (!request.ok || !request.atEnd()) break;
+        {
+            lock_guard<mutex> guard(tokenLock);
+            map<string, SignedIn>::iterator it = signedIn.find(token);
+            if (it == signedIn.end()) {
+                errorReply(job->reply, "Session expired; please sign in again");
+                return true;
+            }
+            state.userId = it->second.userId;
+            state.username = it->second.username;
+        }
+        state.sessionId = 0;
+        MessageWriter writer(HALL_OK);
+        writer.putInt(state.userId);
+        writer.putString(state.username);
+        writer.putString("candidate");
+        job->reply = writer.finish();
+        job->failed = false;
+        return true;
+    }
+
+    case HALL_COURSES: {
+        if (!request.atEnd()) break;
+        vector<Course> courses = db->getAllCourses();
+        MessageWriter writer(HALL_OK);
+        writer.putInt((int)courses.size());
+        for (size_t i = 0; i < courses.size(); i++) {
+            writer.putInt(courses[i].id);
+            writer.putString(courses[i].courseCode);
+            writer.putString(courses[i].courseTitle);
+            writer.putInt(courses[i].timeAllocation);
+            writer.putInt(courses[i].questionsPerExam);
+            writer.putInt(courses[i].passingMark);
+            writer.putInt(courses[i].totalQuestions);
+            writer.putU8(courses[i].selectionMode);
+        }
+        job->reply = writer.finish();
+        job->failed = false;
+        return true;
+    }
+
+    case HALL_START_PAPER: {
+        int courseId = request.getInt();
+        Seat seat;
+        seat.row = request.getInt();
+        seat.column = request.getInt();
+        if (!request.ok || !request.atEnd()) break;
+        // Length, time and mode come from the course, not the terminal
+        Course* course = db->getCourseById(courseId);
+        if (!course) {
+            errorReply(job->reply, "No such course");
+            return true;
+        }
+        vector<Question> questions;
+        ExamSession session;
+        int timeAllowed = course->timeAllocation * 60;
+        PaperSource source = preparePaper(db, state.userId, courseId, course->questionsPerExam,
+                                          timeAllowed, questions, session,
+                                          course->selectionMode, seat);
+        delete course;
+        if (source == PAPER_NONE) {
+            errorReply(job->reply, "No questions available for this course");
+            return true;
+        }
+        state.sessionId = session.id;
+        state.startedAt = session.startedAt;
+        state.timeAllowed = timeAllowed;
+        state.questionCount = (int)questions.size();
+        // A resumed sitting's clock kept running while the terminal was away
+        capTimes(state.startedAt, state.timeAllowed, session.timeRemaining, session.timeSpent);
+
+        MessageWriter writer(HALL_OK);
+        writer.putU8(source);
+        writer.putInt(session.id);
+        writer.putInt((int)session.answers.size());
+        for (size_t i = 0; i < session.answers.size(); i++) {
+            writer.putAnswer(session.answers[i]);
+        }
+        writer.putInt(session.currentIndex);
+        writer.putInt(session.timeRemaining);
+        writer.putInt(session.timeSpent);
+        writer.putInt(session.seed.poolVersion);
+        writer.putU64(session.seed.value);
+        writer.putInt(session.seed.questionCount);
+        writer.putU8(session.seed.shuffledOptions ? 1 : 0);
+        writer.putInt((int)questions.size());
+        for (size_t i = 0; i < questions.size(); i++) {
+            writer.putInt(questions[i].id);
+            writer.putString(questions[i].questionText);
+            writer.putString(questions[i].optionA);
+            writer.putString(questions[i].optionB);
+            writer.putString(questions[i].optionC);
+            writer.putString(questions[i].optionD);
+            writer.putInt(questions[i].points);
+        }
+        job->reply = writer.finish();
+        job->failed = false;
+        return true;
+    }
+
+    case HALL_SAVE_PROGRESS: {
+        int sessionId = request.getInt();
+        int courseId = request.getInt();
+        vector<SessionAnswer> changes(request.getCount(5));
+        for (size_t i = 0; i < changes.size(); i++) {
+            changes[i].position = request.getInt();
+            changes[i].answer = request.getAnswer();
+            if (changes[i].position < 0) request.ok = false;
+        }
+        int currentIndex = request.getInt();
+        int timeRemaining = request.getInt();
+        int timeSpent = request.getInt();
+        if (!request.ok || !request.atEnd()) break;
+
+        // Checked once per terminal and sitting; later saves skip the read
+        if (sessionId != state.sessionId) {
+            ExamSession open;
+            if (!db->findOpenExamSession(state.userId, courseId, open) || open.id != sessionId) {
+                closedReply(job->reply);
+                return true;
+            }
+            Course* course = db->getCourseById(courseId);
+            if (!course) {
+                errorReply(job->reply, "No such course");
+                return true;
+            }
+            state.sessionId = sessionId;
+            state.startedAt = open.startedAt;
+            state.timeAllowed = course->timeAllocation * 60;
+            state.questionCount = (int)open.questionIds.size();
+            delete course;
+        }
+        if (!onPaper(changes, state.questionCount) || currentIndex < 0 ||
+            currentIndex >= state.questionCount) {
+            errorReply(job->reply, "Answers and the current question must be on the paper");
+            return true;
+        }
+        if (pastDeadline(state.startedAt, state.timeAllowed)) {
+            errorReply(job->reply, "Time is up; the exam can only be submitted");
+            return true;
+        }
+        capTimes(state.startedAt, state.timeAllowed, timeRemaining, timeSpent);
+        if (!db->saveSessionProgress(sessionId, changes, currentIndex, timeRemaining,
+                                     timeSpent)) {
+            // Another terminal of the candidate may have submitted it since
+            ExamSession open;
+            if (!db->findOpenExamSession(state.userId, courseId, open) || open.id != sessionId) {
+                state.sessionId = 0;
+                closedReply(job->reply);
+            } else {
+                errorReply(job->reply, "Could not save the answers");
+            }
+            return true;
+        }
+        {
+            lock_guard<mutex> guard(statsLock);
+            totals.saves++;
+        }
+        job->reply = MessageWriter(HALL_OK).finish();
+        job->failed = false;
+        return true;
+    }
+
+    case HALL_SUBMIT: {
+        int sessionId = request.getInt();
+        int courseId = request.getInt();
+        int timeSpent = request.getInt();
+        vector<string> answers(request.getCount(1));
+        for (size_t i = 0; i < answers.size(); i++) {
+            answers[i] = request.getAnswer();
+        }
+        vector<SessionAnswer> changes(request.getCount(5));
+        for (size_t i = 0; i < changes.size(); i++) {
+            changes[i].position = request.getInt();
+            changes[i].answer = request.getAnswer();
+            if (changes[i].position < 0) request.ok = false;
+        }
+        if (!request.ok || !request.atEnd()) break;
+
+        // Graded here against the sitting's own paper and the current key.
+        // A sitting no longer open was submitted, typically by a resend
+        // after the reply to the first submit was lost.
+        ExamSession open;
+        if (!db->findOpenExamSession(state.userId, courseId, open) || open.id != sessionId) {
+            if (state.sessionId == sessionId) state.sessionId = 0;
+            closedReply(job->reply);
+            return true;
+        }
+        if (!onPaper(changes, (int)open.questionIds.size())) {
+            errorReply(job->reply, "Answer positions must be on the paper");
+            return true;
+        }
+        vector<Question> questions = db->getQuestionsByIds(open.questionIds);
+        Course* course = db->getCourseById(courseId);
+        if (course && pastDeadline(open.startedAt, course->timeAllocation * 60)) {
+            // Late: graded on the answers saved before time ran out, not on
+            // what the terminal sends now
+            answers = open.answers;
+            changes.clear();
+        }
+        if (!course || questions.size() != open.questionIds.size() ||
+            answers.size() != questions.size()) {
+            delete course;
+            errorReply(job->reply, "The paper no longer matches the course's questions");
+            return true;
+        }
+        int timeRemaining = 0;
+        capTimes(open.startedAt, course->timeAllocation * 60, timeRemaining, timeSpent);
+        User user(state.userId, state.username);
+        SubmitReply* pending = new SubmitReply;
+        pending->server = this;
+        pending->job = job;
+        pending->result = gradeExam(questions, answers, user, *course, timeSpent, open.seed);
+        delete course;
+
+        ResultPaper paper;
+        paper.courseId = courseId;
+        paper.questionIds = open.questionIds;
+        paper.answers = AnswerSheet::fromAnswers(answers);
+        paper.seed = open.seed;
+        if (!submissions->post(pending->result, paper, sessionId, changes, submitted, pending)) {
+            delete pending;
+            errorReply(job->reply, "Your exam could not be saved");
+            return true;
+        }
+        return false;
+    }
+
+    default:
+        errorReply(job->reply, "Unknown request");
+        return true;
+    }
+
+    errorReply(job->reply, "Malformed request");
+    return true;
+}
+
+void HallServer::dispatch(long long terminalId, Terminal* terminal) {
+    if (terminal->busy || terminal->requests.empty()) {
+        return;
+    }
+    Job* job = new Job;
+    job->terminalId = terminalId;
+    job->request.swap(terminal->requests.front());
+    job->state = terminal->state;
+    job->failed = false;
+    terminal->requests.pop_front();
+    terminal->busy = true;
+    {
+        lock_guard<mutex> guard(jobLock);
+        jobs.push_back(job);
+    }
+    jobReady.notify_one();
+}
+
+void HallServer::closeTerminal(long long terminalId) {
+    map<long long, Terminal*>::iterator it = terminals.find(terminalId);
+    if (it == terminals.end()) {
+        return;
+    }
+    Terminal* terminal = it->second;
+    if (poller) {
+        poller->remove(terminal->fd);
+    }
+    close(terminal->fd);
+    terminalByFd.erase(terminal->fd);
+    terminals.erase(it);
+    // A reply still being prepared is dropped when it arrives
+    delete terminal;
+}
+
+void HallServer::readTerminal(long long terminalId, Terminal* terminal) {
+    unsigned char buffer[READ_CHUNK];
+    for (;;) {
+        ssize_t n = recv(terminal->fd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            terminal->in.insert(terminal->in.end(), buffer, buffer + n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        // Hung up or failed
+        closeTerminal(terminalId);
+        return;
+    }
+
+    size_t used = 0;
+    while (terminal->in.size() - used >= HALL_FRAME_HEADER) {
+        uint32_t length = hallFrameLength(&terminal->in[used]);
+        if (length == 0 || length > HALL_MAX_FRAME ||
+            terminal->requests.size() >= MAX_QUEUED_REQUESTS) {
+            closeTerminal(terminalId);
+            return;
+        }
+        if (terminal->in.size() - used - HALL_FRAME_HEADER < length) break;
+        size_t start = used + HALL_FRAME_HEADER;
+        terminal->requests.push_back(vector<unsigned char>(terminal->in.begin() + start,
+                                                           terminal->in.begin() + start + length));
+        used = start + length;
+    }
+    terminal->in.erase(terminal->in.begin(), terminal->in.begin() + used);
+    dispatch(terminalId, terminal);
+}
+
+bool HallServer::flushTerminal(Terminal* terminal) {
+    while (terminal->outSent < terminal->out.size()) {
+        ssize_t n = sendSome(terminal->fd, &terminal->out[terminal->outSent],
+                             terminal->out.size() - terminal->outSent);
+        if (n > 0) {
+            terminal->outSent += n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            // The rest goes when the socket drains
+            if (!terminal->writing) {
+                poller->setWritable(terminal->fd, true);
+                terminal->writing = true;
+            }
+            return true;
+        }
+        return false;
+    }
+    terminal->out.clear();
+    terminal->outSent = 0;
+    if (terminal->writing) {
+        poller->setWritable(terminal->fd, false);
+        terminal->writing = false;
+    }
+    return true;
+}
+
+void HallServer::deliverReplies() {
+    char drain[256];
+    while (read(wakeRead, drain, sizeof(drain)) > 0) {
+    }
+
+    deque<Job*> ready;
+    {
+        lock_guard<mutex> guard(jobLock);
+        ready.swap(replies);
+    }
+    for (size_t i = 0; i < ready.size(); i++) {
+        Job* job = ready[i];
+        map<long long, Terminal*>::iterator it = terminals.find(job->terminalId);
+        if (it != terminals.end()) {
+            Terminal* terminal = it->second;
+            terminal->state = job->state;
+            terminal->out.insert(terminal->out.end(), job->reply.begin(), job->reply.end());
+            terminal->busy = false;
+            if (!flushTerminal(terminal)) {
+                closeTerminal(job->terminalId);
+            } else {
+                dispatch(job->terminalId, terminal);
+            }
+        }
+        delete job;
+    }
+}
+
+void HallServer::acceptTerminals(int listener) {
+    for (;;) {
+        int fd = accept(listener, NULL, NULL);
+        if (fd < 0) {
+            // EAGAIN: all taken; anything else (out of descriptors) waits
+            // for the next readiness event
+            return;
+        }
+        setNonBlocking(fd);
+        int on = 1;
+        // Replies are small and awaited; don't let Nagle hold them back
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+#ifdef SO_NOSIGPIPE
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+        if (!poller->add(fd)) {
+            close(fd);
+            continue;
+        }
+        Terminal* terminal = new Terminal;
+        terminal->fd = fd;
+        terminal->outSent = 0;
+        terminal->busy = false;
+        terminal->writing = false;
+        terminal->state.userId = 0;
+        terminal->state.sessionId = 0;
+        terminal->state.startedAt = 0;
+        terminal->state.timeAllowed = 0;
+        terminal->state.questionCount = 0;
+        long long id = nextTerminalId++;
+        terminals[id] = terminal;
+        terminalByFd[fd] = id;
+
+        lock_guard<mutex> guard(statsLock);
+        totals.connections++;
+    }
+}
+
+bool HallServer::run() {
+    if (!isReady() || listeners.empty()) {
+        if (lastError.empty()) lastError = "Nothing to listen on";
+        return false;
+    }
+    Poller events;
+    if (!events.isReady()) {
+        lastError = string("Could not create the event poller: ") + strerror(errno);
+        return false;
+    }
+    poller = &events;
+    for (size_t i = 0; i < listeners.size(); i++) {
+        poller->add(listeners[i]);
+    }
+    poller->add(wakeRead);
+
+    vector<Poller::Event> ready;
+    while (!stopRequested) {
+        poller->wait(ready);
+        for (size_t i = 0; i < ready.size() && !stopRequested; i++) {
+            int fd = ready[i].fd;
+            if (fd == wakeRead) {
+                deliverReplies();
+                continue;
+            }
+            if (find(listeners.begin(), listeners.end(), fd) != listeners.end()) {
+                acceptTerminals(fd);
+                continue;
+            }
+            map<int, long long>::iterator it = terminalByFd.find(fd);
+            if (it == terminalByFd.end()) {
+                continue;       // closed earlier in this batch
+            }
+            long long id = it->second;
+            Terminal* terminal = terminals[id];
+            if ((ready[i].flags & Poller::WRITABLE) && !flushTerminal(terminal)) {
+                closeTerminal(id);
+                continue;
+            }
+            if (ready[i].flags & Poller::READABLE) {
+                readTerminal(id, terminal);
+            }
+        }
+    }
+
+    while (!terminals.empty()) {
+        closeTerminal(terminals.begin()->first);
+    }
+    poller = NULL;
+    return true;
+}
@@ -62,7 +62,7 @@ InstructionsWindow::InstructionsWindow() {
         "3. Select ONE answer for each question.\n\n"
         "4. Navigate using Next and Previous buttons.\n\n"
         "5. A countdown timer will display remaining time.\n\n"
-        "6. Auto-save occurs every 30 seconds.\n\n"
+        "6. Your answers are saved automatically every few seconds.\n\n"
         "7. Exam auto-submits when time expires.\n\n"
         "8. Copy and Paste are disabled for security.\n\n"
         "9. Confirm before final submission.\n\n"
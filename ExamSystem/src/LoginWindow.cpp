@@ -5,6 +5,24 @@
 #include <FL/fl_ask.H>
 #include <cstdlib>
 
+// Credentials check, run on the database worker
+struct LoginJob {
+    LoginWindow* login;
+    string username;
+    string password;
+    User* user;
+    string error;       // the hall server's reason, when it refuses
+};
+
+static void runLogin(DatabaseManager* db, void* data) {
+    LoginJob* job = (LoginJob*)data;
+    if (hallClient) {
+        job->user = hallClient->login(job->username, job->password);
+        if (!job->user) job->error = hallClient->getLastError();
+        return;
+    }
+    job->user = db->authenticateUser(job->username, job->password);
+}
 
 void LoginWindow::loginCallback(Fl_Widget* w, void* data) {
     LoginWindow* login = (LoginWindow*)data;
@@ -17,7 +35,26 @@ void LoginWindow::loginCallback(Fl_Widget* w, void* data) {
         return;
     }
     
-    currentUser = dbManager->authenticateUser(userId, password);
+    LoginJob* job = new LoginJob;
+    job->login = login;
+    job->username = userId;
+    job->password = password;
+    job->user = NULL;
+    
+    login->loginBtn->deactivate();
+    login->loginBtn->label("Checking...");
+    dbWorker->post(runLogin, loginDone, job);
+}
+
+void LoginWindow::loginDone(void* data) {
+    LoginJob* job = (LoginJob*)data;
+    LoginWindow* login = job->login;
+    currentUser = job->user;
+    string error = job->error;
+    delete job;
+    
+    login->loginBtn->label("Login");
+    login->loginBtn->activate();
     
     if (currentUser != NULL) {
         login->window->hide();
@@ -28,6 +65,8 @@ void LoginWindow::loginCallback(Fl_Widget* w, void* data) {
         } else {
             showCourseSelectionWindow();
         }
+    } else if (!error.empty()) {
+        fl_alert("%s", error.c_str());
     } else {
         fl_alert("Invalid credentials or account locked!\n\nDefault accounts:\nAdmin: admin/admin123\nStudent: student1/pass123");
     }
@@ -68,7 +107,7 @@ LoginWindow::LoginWindow() {
     passLabel->align(FL_ALIGN_RIGHT | FL_ALIGN_INSIDE);
     passwordInput = new Fl_Secret_Input(200, 250, 220, 30);
     
-    Fl_Button* loginBtn = new Fl_Button(150, 310, 100, 40, "Login");
+    loginBtn = new Fl_Button(150, 310, 100, 40, "Login");
     loginBtn->color(FL_GREEN);
     loginBtn->labelsize(14);
     loginBtn->callback(loginCallback, this);
@@ -0,0 +1,201 @@
+#include "PaperGenerator.h"
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+using namespace std;
+
+static const int PREGEN_CHUNK = 1000;
+static const int MAX_PREGEN_THREADS = 8;
+// Below this many candidates per thread another connection isn't worth opening
+static const int MIN_PAPERS_PER_THREAD = 2000;
+
+// Session for a paper that is about to be shown for the first time
+static bool openNewSession(DatabaseManager* db, int userId, int courseId, int timeAllocation,
+                           const vector<Question>& questions, const PaperSeed& seed,
+                           ExamSession& session) {
+    session = ExamSession();
+    session.userId = userId;
+    session.courseId = courseId;
+    session.timeRemaining = timeAllocation;
+    for (size_t i = 0; i < questions.size(); i++) {
+        session.questionIds.push_back(questions[i].id);
+    }
+    session.answers.assign(questions.size(), "");
+    session.seed = seed;
+    if (!db->openExamSession(session)) {
+        session.id = 0;
+        return false;
+    }
+    return true;
+}
+
+PaperSource preparePaper(DatabaseManager* db, int userId, int courseId, int count,
+                         int timeAllocation, vector<Question>& questions,
+                         ExamSession& session, SelectionMode mode, const Seat& seat) {
+    // A sitting left open by a crash carries on where it was last saved
+    ExamSession saved;
+    if (db->findOpenExamSession(userId, courseId, saved)) {
+        questions = db->getQuestionsByIds(saved.questionIds);
+        if (!saved.questionIds.empty() && questions.size() == saved.questionIds.size()) {
+            session = saved;
+            return PAPER_RESUMED;
+        }
+        // Part of that paper has since been deleted, so it can't be shown as it was
+        db->closeExamSession(saved.id, "abandoned");
+    }
+    
+    // Every new paper gets a seed for the orders its options are shown in;
+    // a uniform draw takes its questions from the same seed
+    int sitting = db->countExamSessions(userId, courseId) + 1;
+    PaperSeed listSeed(0, paperSeedFor(userId, courseId, sitting), 0);
+    listSeed.shuffledOptions = true;
+    
+    // A seat's planned paper comes first; it was chosen against the papers
+    // of the seats around it, and so were its option orders
+    SeatPaper seatPaper;
+    if (seat.isSet() && db->findSeatPaper(courseId, seat, seatPaper)) {
+        questions = db->getQuestionsByIds(seatPaper.questionIds);
+        if ((int)seatPaper.questionIds.size() == count &&
+            questions.size() == seatPaper.questionIds.size()) {
+            PaperSeed seatSeed(0, seatPaper.optionSeed, 0);
+            seatSeed.shuffledOptions = true;
+            if (openNewSession(db, userId, courseId, timeAllocation, questions, seatSeed,
+                               session)) {
+                db->deleteSeatPaper(courseId, seat);
+            }
+            return PAPER_ASSIGNED;
+        }
+        db->deleteSeatPaper(courseId, seat);
+    }
+    
+    // A paper drawn ahead of the sitting is used once; one that no longer
+    // fits the course (size changed, questions deleted) is redrawn here
+    AssignedPaper assigned;
+    if (db->findAssignedPaper(userId, courseId, assigned)) {
+        questions = db->getQuestionsByIds(assigned.questionIds);
+        if ((int)assigned.questionIds.size() == count &&
+            questions.size() == assigned.questionIds.size()) {
+            if (openNewSession(db, userId, courseId, timeAllocation, questions, listSeed,
+                               session)) {
+                db->deleteAssignedPaper(userId, courseId);
+            }
+            return PAPER_ASSIGNED;
+        }
+        db->deleteAssignedPaper(userId, courseId);
+    }
+    
+    // A blueprint fixes the make-up of the paper. One the pool can no
+    // longer meet doesn't stop the sitting; the paper is drawn as usual.
+    Blueprint blueprint = db->getBlueprint(courseId);
+    if (!blueprint.rows.empty() && db->getBlueprintQuestions(courseId, blueprint, questions)) {
+        openNewSession(db, userId, courseId, timeAllocation, questions, listSeed, session);
+        return PAPER_NEW;
+    }
+    
+    if (mode == SELECT_BALANCED) {
+        questions = db->getRandomQuestions(courseId, count, SELECT_BALANCED);
+        if (questions.empty()) {
+            return PAPER_NONE;
+        }
+        openNewSession(db, userId, courseId, timeAllocation, questions, listSeed, session);
+        return PAPER_NEW;
+    }
+    
+    // Drawn from a seed, so the sitting only has to keep the seed: the
+    // same user, course and attempt always rebuild the same paper
+    PaperSeed seed(0, listSeed.value, count);
+    seed.shuffledOptions = true;
+    questions = db->getRandomQuestions(courseId, count, seed);
+    if (questions.empty()) {
+        return PAPER_NONE;
+    }
+    if (questions.size() < (size_t)seed.questionCount) {
+        // A question was deleted since the snapshot; store this paper as a list
+        seed = listSeed;
+    }
+    openNewSession(db, userId, courseId, timeAllocation, questions, seed, session);
+    return PAPER_NEW;
+}
+
+// Draws the papers of candidates [first, last) on a connection of its own
+static void drawPapers(const string& path, const StorageProfile& profile, int courseId,
+                       int count, SelectionMode mode, const Blueprint* blueprint,
+                       const vector<int>* userIds, int first, int last,
+                       vector<AssignedPaper>* papers, bool* ok) {
+    DatabaseManager db(path, profile);
+    *ok = db.isReady();
+    for (int i = first; *ok && i < last; i++) {
+        AssignedPaper& paper = (*papers)[i];
+        paper.userId = (*userIds)[i];
+        paper.courseId = courseId;
+        if (blueprint->rows.empty() ||
+            !db.sampleBlueprintIds(courseId, *blueprint, paper.questionIds)) {
+            paper.questionIds = db.sampleQuestionIds(courseId, count, mode);
+        }
+        *ok = !paper.questionIds.empty();
+    }
+}
+
+bool pregeneratePapers(DatabaseManager* db, int courseId, const vector<int>& userIds,
+                       PregenStats* stats, int threads, PregenProgress progress,
+                       void* progressData) {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    PregenStats local;
+    
+    Course* course = db->getCourseById(courseId);
+    if (!course) {
+        return false;
+    }
+    int count = course->questionsPerExam;
+    SelectionMode mode = course->selectionMode;
+    delete course;
+    Blueprint blueprint = db->getBlueprint(courseId);
+    
+    int total = (int)userIds.size();
+    if (threads <= 0) {
+        threads = (int)thread::hardware_concurrency();
+    }
+    threads = max(1, min(threads, MAX_PREGEN_THREADS));
+    threads = min(threads, total / MIN_PAPERS_PER_THREAD + 1);
+    
+    // Drawing is all in memory; each thread fills its own slice
+    vector<AssignedPaper> papers(total);
+    vector<thread> drawers;
+    bool* drawn = new bool[threads];
+    for (int t = 0; t < threads; t++) {
+        int first = (int)((long long)total * t / threads);
+        int last = (int)((long long)total * (t + 1) / threads);
+        drawers.push_back(thread(drawPapers, db->getDatabasePath(), db->getStorageProfile(),
+                                 courseId, count, mode, &blueprint, &userIds, first, last,
+                                 &papers, &drawn[t]));
+    }
+    bool ok = true;
+    for (int t = 0; t < threads; t++) {
+        drawers[t].join();
+        ok = ok && drawn[t];
+    }
+    delete[] drawn;
+    
+    // One writer, in chunks so exam traffic can get in between
+    for (int i = 0; ok && i < total; i += PREGEN_CHUNK) {
+        int end = min(total, i + PREGEN_CHUNK);
+        vector<AssignedPaper> chunk(papers.begin() + i, papers.begin() + end);
+        ok = db->saveAssignedPapers(chunk) == (int)chunk.size();
+        if (ok) {
+            local.papers = end;
+            if (progress) {
+                progress(local.papers, total, progressData);
+            }
+        }
+    }
+    
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    local.threads = threads;
+    local.seconds = elapsed.count();
+    local.papersPerSecond = local.seconds > 0 ? local.papers / local.seconds : 0;
+    if (stats) {
+        *stats = local;
+    }
+    return ok;
+}
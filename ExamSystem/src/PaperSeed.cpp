@@ -0,0 +1,126 @@
+#include "PaperSeed.h"
+#include <algorithm>
+
+using namespace std;
+
+// Every order of A..D, lexicographic
+static const unsigned char optionOrderTable[OPTION_ORDERS][4] = {
+    {0, 1, 2, 3}, {0, 1, 3, 2}, {0, 2, 1, 3}, {0, 2, 3, 1}, {0, 3, 1, 2}, {0, 3, 2, 1},
+    {1, 0, 2, 3}, {1, 0, 3, 2}, {1, 2, 0, 3}, {1, 2, 3, 0}, {1, 3, 0, 2}, {1, 3, 2, 0},
+    {2, 0, 1, 3}, {2, 0, 3, 1}, {2, 1, 0, 3}, {2, 1, 3, 0}, {2, 3, 0, 1}, {2, 3, 1, 0},
+    {3, 0, 1, 2}, {3, 0, 2, 1}, {3, 1, 0, 2}, {3, 1, 2, 0}, {3, 2, 0, 1}, {3, 2, 1, 0}
+};
+
+// Option orders are drawn from their own stream of the paper's seed
+static const uint64_t OPTION_STREAM = 0x6A09E667F3BCC909ULL;
+
+PaperSeed::PaperSeed()
+    : poolVersion(0), value(0), questionCount(0), shuffledOptions(false) {}
+
+PaperSeed::PaperSeed(int poolVersion, uint64_t value, int questionCount)
+    : poolVersion(poolVersion), value(value), questionCount(questionCount),
+      shuffledOptions(false) {}
+
+bool PaperSeed::isSeeded() const {
+    return poolVersion > 0;
+}
+
+int storedOption(int order, int slot) {
+    if (order < 0 || order >= OPTION_ORDERS || slot < 0 || slot > 3) {
+        return slot;
+    }
+    return optionOrderTable[order][slot];
+}
+
+int displaySlot(int order, int option) {
+    if (option < 0 || option > 3) {
+        return -1;
+    }
+    if (order < 0 || order >= OPTION_ORDERS) {
+        return option;
+    }
+    for (int slot = 0; slot < 4; slot++) {
+        if (optionOrderTable[order][slot] == option) return slot;
+    }
+    return option;
+}
+
+// SplitMix64: small, fast and fully specified, so draws never depend on
+// the standard library
+static uint64_t nextRandom(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Uniform in [0, bound) without modulo bias
+static uint64_t nextBelow(uint64_t& state, uint64_t bound) {
+    uint64_t threshold = (0 - bound) % bound;
+    uint64_t r;
+    do {
+        r = nextRandom(state);
+    } while (r < threshold);
+    return r % bound;
+}
+
+vector<unsigned char> PaperSeed::optionOrders(int count) const {
+    vector<unsigned char> orders(count > 0 ? count : 0, 0);
+    if (!shuffledOptions) {
+        return orders;
+    }
+    uint64_t state = value ^ OPTION_STREAM;
+    for (size_t i = 0; i < orders.size(); i++) {
+        orders[i] = (unsigned char)nextBelow(state, OPTION_ORDERS);
+    }
+    return orders;
+}
+
+uint64_t paperSeedFor(int userId, int courseId, int sitting) {
+    uint64_t state = ((uint64_t)(uint32_t)userId << 32) | (uint32_t)courseId;
+    uint64_t seed = nextRandom(state);
+    state ^= (uint64_t)(uint32_t)sitting * 0xD6E8FEB86659FD93ULL;
+    return seed ^ nextRandom(state);
+}
+
+vector<int> drawSeededPaper(const vector<int>& pool, int count, uint64_t seed) {
+    int n = (int)pool.size();
+    if (count > n) count = n;
+    if (count < 0) count = 0;
+    
+    vector<int> picked;
+    picked.reserve(count);
+    uint64_t state = seed;
+    
+    // Partial Fisher-Yates. A paper is usually a few dozen questions from
+    // thousands, so rather than copying the pool only the slots moved by a
+    // swap are remembered (slot, value) and looked up linearly; for large
+    // papers a plain copy is cheaper. Both give the same draw.
+    if (count * 16 < n) {
+        vector<pair<int, int> > moved;
+        moved.reserve(count);
+        for (int i = 0; i < count; i++) {
+            int j = i + (int)nextBelow(state, (uint64_t)(n - i));
+            int atI = i, atJ = j;
+            size_t slotJ = moved.size();
+            for (size_t m = 0; m < moved.size(); m++) {
+                if (moved[m].first == i) atI = moved[m].second;
+                if (moved[m].first == j) atJ = moved[m].second, slotJ = m;
+            }
+            if (slotJ < moved.size()) {
+                moved[slotJ].second = atI;
+            } else {
+                moved.push_back(make_pair(j, atI));
+            }
+            picked.push_back(pool[atJ]);
+        }
+    } else {
+        vector<int> slots(pool);
+        for (int i = 0; i < count; i++) {
+            int j = i + (int)nextBelow(state, (uint64_t)(n - i));
+            swap(slots[i], slots[j]);
+            picked.push_back(slots[i]);
+        }
+    }
+    return picked;
+}
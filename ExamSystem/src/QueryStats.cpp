@@ -0,0 +1,174 @@
+#include "QueryStats.h"
+#include <atomic>
+#include <mutex>
+#include <sstream>
+#include <fstream>
+#include <cstdio>
+
+using namespace std;
+
+static const char* queryOpNames[QUERY_OP_COUNT] = {
+    "addUser", "authenticateUser", "getUserIdByUsername", "getUserIdsByRole", "loginAttempts",
+    "addCourse", "setSelectionMode", "getAllCourses", "getCourseById", "getCourseIdByCode",
+    "addQuestion", "addQuestions", "getRandomQuestions", "sampleQuestionIds",
+    "getPaperQuestionIds", "getSeededQuestions", "getPoolVersion", "getQuestionsByIds",
+    "getCourseAnswerKey", "updateCorrectAnswer", "getExposureStats",
+    "setBlueprint", "getBlueprint", "getStrata", "getQuestionStrata",
+    "sampleBlueprintIds", "getBlueprintQuestions",
+    "saveResult", "submitResult", "streamResults", "countResults",
+    "saveResultPaper", "getResultPaperRange", "loadResultPapers", "updateResultScores",
+    "saveAssignedPapers", "findAssignedPaper", "deleteAssignedPaper", "countAssignedPapers",
+    "saveSeatPapers", "findSeatPaper", "deleteSeatPaper", "countSeatPapers",
+    "openExamSession", "saveSessionProgress", "findOpenExamSession",
+    "countExamSessions", "closeExamSession",
+    "beginTransaction", "commitTransaction", "rollbackTransaction"
+};
+
+// Counters of one thread. Only the owning thread writes them, so a plain
+// relaxed load + store is enough; atomics only keep concurrent readers safe.
+struct OpCounters {
+    atomic<unsigned long long> calls;
+    atomic<unsigned long long> rows;
+    atomic<unsigned long long> totalMicros;
+    atomic<unsigned long long> maxMicros;
+    atomic<unsigned long long> buckets[QUERY_BUCKETS];
+};
+
+struct ThreadCounters {
+    OpCounters ops[QUERY_OP_COUNT];
+};
+
+// Blocks are never freed: a finished thread's calls still count, and the
+// number of threads touching the database is small and bounded
+static mutex registryMutex;
+static vector<ThreadCounters*> registry;
+static thread_local ThreadCounters* localCounters = NULL;
+
+static ThreadCounters* threadCounters() {
+    if (!localCounters) {
+        ThreadCounters* counters = new ThreadCounters();
+        for (int op = 0; op < QUERY_OP_COUNT; op++) {
+            OpCounters& c = counters->ops[op];
+            c.calls.store(0);
+            c.rows.store(0);
+            c.totalMicros.store(0);
+            c.maxMicros.store(0);
+            for (int b = 0; b < QUERY_BUCKETS; b++) c.buckets[b].store(0);
+        }
+        lock_guard<mutex> lock(registryMutex);
+        registry.push_back(counters);
+        localCounters = counters;
+    }
+    return localCounters;
+}
+
+static void add(atomic<unsigned long long>& counter, unsigned long long n) {
+    counter.store(counter.load(memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+static int bucketFor(unsigned long long micros) {
+    int bucket = 0;
+    while (micros > 0 && bucket < QUERY_BUCKETS - 1) {
+        micros >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+const char* queryOpName(QueryOp op) {
+    return op >= 0 && op < QUERY_OP_COUNT ? queryOpNames[op] : "?";
+}
+
+void recordQuery(QueryOp op, unsigned long long micros, unsigned long long rows) {
+    OpCounters& c = threadCounters()->ops[op];
+    add(c.calls, 1);
+    add(c.rows, rows);
+    add(c.totalMicros, micros);
+    add(c.buckets[bucketFor(micros)], 1);
+    if (micros > c.maxMicros.load(memory_order_relaxed)) {
+        c.maxMicros.store(micros, memory_order_relaxed);
+    }
+}
+
+QuerySummary::QuerySummary()
+    : name(""), calls(0), rows(0), totalMicros(0), maxMicros(0) {
+    for (int b = 0; b < QUERY_BUCKETS; b++) buckets[b] = 0;
+}
+
+double QuerySummary::averageMs() const {
+    return calls > 0 ? totalMicros / 1000.0 / calls : 0;
+}
+
+double QuerySummary::percentileMs(double p) const {
+    unsigned long long target = (unsigned long long)(p * calls + 0.5);
+    if (target < 1) target = 1;
+
+    unsigned long long seen = 0;
+    for (int b = 0; b < QUERY_BUCKETS; b++) {
+        seen += buckets[b];
+        if (seen >= target) {
+            unsigned long long upper = 1ULL << b;
+            return (upper < maxMicros ? upper : maxMicros) / 1000.0;
+        }
+    }
+    return maxMicros / 1000.0;
+}
+
+vector<QuerySummary> snapshotQueryStats() {
+    QuerySummary totals[QUERY_OP_COUNT];
+    {
+        lock_guard<mutex> lock(registryMutex);
+        for (size_t t = 0; t < registry.size(); t++) {
+            for (int op = 0; op < QUERY_OP_COUNT; op++) {
+                const OpCounters& c = registry[t]->ops[op];
+                QuerySummary& s = totals[op];
+                s.calls += c.calls.load(memory_order_relaxed);
+                s.rows += c.rows.load(memory_order_relaxed);
+                s.totalMicros += c.totalMicros.load(memory_order_relaxed);
+                unsigned long long threadMax = c.maxMicros.load(memory_order_relaxed);
+                if (threadMax > s.maxMicros) s.maxMicros = threadMax;
+                for (int b = 0; b < QUERY_BUCKETS; b++) {
+                    s.buckets[b] += c.buckets[b].load(memory_order_relaxed);
+                }
+            }
+        }
+    }
+
+    vector<QuerySummary> summaries;
+    for (int op = 0; op < QUERY_OP_COUNT; op++) {
+        if (totals[op].calls == 0) continue;
+        totals[op].name = queryOpNames[op];
+        summaries.push_back(totals[op]);
+    }
+    return summaries;
+}
+
+string formatQueryStats() {
+    vector<QuerySummary> summaries = snapshotQueryStats();
+    stringstream text;
+    char line[160];
+
+    sprintf(line, "%-20s %9s %10s %9s %9s %9s %9s\n",
+            "Query", "Calls", "Rows", "Avg ms", "p50 ms", "p99 ms", "Max ms");
+    text << line;
+    for (size_t i = 0; i < summaries.size(); i++) {
+        const QuerySummary& s = summaries[i];
+        sprintf(line, "%-20s %9llu %10llu %9.3f %9.3f %9.3f %9.3f\n", s.name, s.calls,
+                s.rows, s.averageMs(), s.percentileMs(0.50), s.percentileMs(0.99),
+                s.maxMicros / 1000.0);
+        text << line;
+    }
+    if (summaries.empty()) {
+        text << "(no queries recorded yet)\n";
+    }
+    return text.str();
+}
+
+bool dumpQueryStats(const string& path) {
+    ofstream file(path.c_str());
+    if (!file) {
+        return false;
+    }
+    file << formatQueryStats();
+    return file.good();
+}
@@ -1,4 +1,26 @@
 #include "Question.h"
+#include <cstdlib>
+#include <cctype>
 
 Question::Question() 
-    : id(0), courseId(0), points(1) {}
\ No newline at end of file
+    : id(0), courseId(0), points(1), difficulty(DIFFICULTY_NONE) {}
+
+const char* difficultyName(int difficulty) {
+    switch (difficulty) {
+        case DIFFICULTY_EASY: return "easy";
+        case DIFFICULTY_MEDIUM: return "medium";
+        case DIFFICULTY_HARD: return "hard";
+        default: return "";
+    }
+}
+
+int parseDifficulty(const string& text) {
+    string lower;
+    for (size_t i = 0; i < text.size(); i++) {
+        lower += (char)tolower((unsigned char)text[i]);
+    }
+    if (lower == "easy" || lower == "1") return DIFFICULTY_EASY;
+    if (lower == "medium" || lower == "2") return DIFFICULTY_MEDIUM;
+    if (lower == "hard" || lower == "3") return DIFFICULTY_HARD;
+    return -1;
+}
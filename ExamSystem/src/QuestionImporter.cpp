@@ -0,0 +1,109 @@
+#include "QuestionImporter.h"
+#include <fstream>
+#include <algorithm>
+#include <chrono>
+
+using namespace std;
+
+static string fieldValue(const string& line, size_t prefixLength) {
+    string value = line.substr(prefixLength);
+    if (!value.empty() && value[0] == ' ') {
+        value = value.substr(1);
+    }
+    return value;
+}
+
+bool parseQuestionFile(const string& filename, int courseId, vector<Question>& questions) {
+    ifstream file(filename.c_str());
+    if (!file.is_open()) {
+        return false;
+    }
+    
+    string line;
+    // Optional fields after ANSWER belong to the question just read
+    bool lastAccepted = false;
+    
+    while (getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        
+        if (line.substr(0, 6) == "TOPIC:") {
+            if (lastAccepted) questions.back().topic = fieldValue(line, 6);
+        } else if (line.substr(0, 11) == "DIFFICULTY:") {
+            int difficulty = parseDifficulty(fieldValue(line, 11));
+            if (lastAccepted && difficulty > 0) questions.back().difficulty = difficulty;
+        } else if (line.substr(0, 2) == "Q:") {
+            lastAccepted = false;
+            Question q;
+            q.courseId = courseId;
+            q.questionText = fieldValue(line, 2);
+            
+            if (getline(file, line) && line.substr(0, 2) == "A:") {
+                q.optionA = fieldValue(line, 2);
+            }
+            
+            if (getline(file, line) && line.substr(0, 2) == "B:") {
+                q.optionB = fieldValue(line, 2);
+            }
+            
+            if (getline(file, line) && line.substr(0, 2) == "C:") {
+                q.optionC = fieldValue(line, 2);
+            }
+            
+            if (getline(file, line) && line.substr(0, 2) == "D:") {
+                q.optionD = fieldValue(line, 2);
+            }
+            
+            if (getline(file, line) && line.substr(0, 7) == "ANSWER:") {
+                q.correctAnswer = fieldValue(line, 7);
+                if (!q.correctAnswer.empty()) q.correctAnswer = q.correctAnswer.substr(0, 1);
+            }
+            
+            if (!q.questionText.empty() && !q.optionA.empty() && !q.optionB.empty() && 
+                !q.optionC.empty() && !q.optionD.empty() && !q.correctAnswer.empty()) {
+                questions.push_back(q);
+                lastAccepted = true;
+            }
+        }
+    }
+    
+    file.close();
+    return true;
+}
+
+int importQuestionFile(DatabaseManager* db, const string& filename, int courseId,
+                       ImportStats* stats, ImportProgress progress, void* progressData) {
+    vector<Question> questions;
+    if (!parseQuestionFile(filename, courseId, questions)) {
+        return 0;
+    }
+    if (!progress) {
+        return db->addQuestions(questions, stats);
+    }
+    
+    // Same chunked inserts, handed over a slice at a time so the caller
+    // can show how far along it is
+    const size_t sliceSize = 5000;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    int inserted = 0;
+    int failed = 0;
+    
+    progress(0, (int)questions.size(), progressData);
+    for (size_t i = 0; i < questions.size(); i += sliceSize) {
+        size_t sliceEnd = min(i + sliceSize, questions.size());
+        vector<Question> slice(questions.begin() + i, questions.begin() + sliceEnd);
+        
+        ImportStats sliceStats;
+        inserted += db->addQuestions(slice, &sliceStats);
+        failed += sliceStats.failed;
+        progress((int)sliceEnd, (int)questions.size(), progressData);
+    }
+    
+    if (stats) {
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        stats->inserted = inserted;
+        stats->failed = failed;
+        stats->seconds = elapsed.count();
+        stats->rowsPerSecond = stats->seconds > 0 ? inserted / stats->seconds : 0;
+    }
+    return inserted;
+}
@@ -0,0 +1,266 @@
+#include "QuestionSampler.h"
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+
+// Weights are rescaled once the average one falls below 2^-REBASE_EXPONENT,
+// long before doubles lose precision
+static const int REBASE_EXPONENT = 16;
+
+QuestionSampler::QuestionSampler(sqlite3* database, StatementCache* cache)
+    : db(database), stmtCache(cache), rng(random_device()()) {}
+
+int QuestionSampler::currentPoolVersion(int courseId) {
+    int version = 0;
+    sqlite3_stmt* stmt = stmtCache->acquire("SELECT pool_version FROM courses WHERE id = ?");
+    if (stmt) {
+        sqlite3_bind_int(stmt, 1, courseId);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            version = sqlite3_column_int(stmt, 0);
+        }
+        stmtCache->release(stmt);
+    }
+    return version;
+}
+
+QuestionSampler::CoursePool& QuestionSampler::pool(int courseId) {
+    // One key lookup per draw; commits that don't touch the course's
+    // questions (autosaves, results) leave the pool alone
+    int version = currentPoolVersion(courseId);
+    map<int, CoursePool>::iterator it = pools.find(courseId);
+    if (it != pools.end() && it->second.poolVersion == version) {
+        return it->second;
+    }
+
+    CoursePool& p = pools[courseId];
+    p = CoursePool();
+    p.poolVersion = version;
+    const char* sql = "SELECT id FROM questions WHERE course_id = ?";
+    sqlite3_stmt* stmt = stmtCache->acquire(sql);
+    if (stmt) {
+        sqlite3_bind_int(stmt, 1, courseId);
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            p.ids.push_back(sqlite3_column_int(stmt, 0));
+        }
+        stmtCache->release(stmt);
+    }
+    return p;
+}
+
+double QuestionSampler::weightFor(const CoursePool& p, int exposure) {
+    return ldexp(1.0, p.baseExposure - exposure);
+}
+
+void QuestionSampler::rebase(CoursePool& p) {
+    // Only differences in exposure matter, so the least shown question
+    // gets weight 1 again; O(n) but needed once per many draws
+    p.baseExposure = 0;
+    for (size_t i = 0; i < p.exposures.size(); i++) {
+        if (i == 0 || p.exposures[i] < p.baseExposure) p.baseExposure = p.exposures[i];
+    }
+    p.weights.resize(p.exposures.size());
+    for (size_t i = 0; i < p.exposures.size(); i++) {
+        p.weights[i] = weightFor(p, p.exposures[i]);
+    }
+    rebuildTree(p);
+}
+
+void QuestionSampler::loadWeights(int courseId, CoursePool& p) {
+    p.weightedIds.clear();
+    p.exposures.clear();
+    const char* sql = "SELECT id, exposure_count FROM questions WHERE course_id = ?";
+    sqlite3_stmt* stmt = stmtCache->acquire(sql);
+    if (stmt) {
+        sqlite3_bind_int(stmt, 1, courseId);
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            p.weightedIds.push_back(sqlite3_column_int(stmt, 0));
+            p.exposures.push_back(sqlite3_column_int(stmt, 1));
+        }
+        stmtCache->release(stmt);
+    }
+    rebase(p);
+    p.weighted = true;
+    p.weightsLoaded = chrono::steady_clock::now();
+}
+
+void QuestionSampler::rebuildTree(CoursePool& p) {
+    // O(n) bottom-up build; also clears rounding drift left by updates
+    int n = (int)p.weights.size();
+    p.tree.assign(n + 1, 0.0);
+    p.totalWeight = 0;
+    for (int i = 1; i <= n; i++) {
+        p.tree[i] += p.weights[i - 1];
+        p.totalWeight += p.weights[i - 1];
+        int parent = i + (i & -i);
+        if (parent <= n) p.tree[parent] += p.tree[i];
+    }
+}
+
+void QuestionSampler::addWeight(CoursePool& p, int index, double delta) {
+    int n = (int)p.weights.size();
+    p.weights[index] += delta;
+    p.totalWeight += delta;
+    for (int i = index + 1; i <= n; i += i & -i) {
+        p.tree[i] += delta;
+    }
+}
+
+int QuestionSampler::findWeight(const CoursePool& p, double target) {
+    // Index of the first item whose running weight sum passes target
+    int n = (int)p.weights.size();
+    int step = 1;
+    while (step * 2 <= n) step *= 2;
+    int pos = 0;
+    for (; step > 0; step /= 2) {
+        if (pos + step <= n && p.tree[pos + step] <= target) {
+            pos += step;
+            target -= p.tree[pos];
+        }
+    }
+    return pos;
+}
+
+vector<int> QuestionSampler::sampleBalanced(int courseId, int count) {
+    CoursePool& p = pool(courseId);
+    chrono::duration<double> age = chrono::steady_clock::now() - p.weightsLoaded;
+    if (!p.weighted || age.count() > EXPOSURE_REFRESH_SECONDS) {
+        loadWeights(courseId, p);
+    }
+    int n = (int)p.weightedIds.size();
+    if (count > n) count = n;
+    if (count < 0) count = 0;
+
+    // Each pick takes its item out of the tree, so the k ids are distinct
+    vector<int> slots;
+    slots.reserve(count);
+    while ((int)slots.size() < count) {
+        uniform_real_distribution<double> dist(0.0, p.totalWeight);
+        int slot = findWeight(p, dist(rng));
+        if (slot >= n || p.weights[slot] <= 0) {
+            // Rounding pointed past the last live item; resum and try again
+            rebuildTree(p);
+            continue;
+        }
+        slots.push_back(slot);
+        addWeight(p, slot, -p.weights[slot]);
+    }
+
+    // Put the picks back at their new exposure
+    vector<int> picked;
+    picked.reserve(count);
+    for (size_t i = 0; i < slots.size(); i++) {
+        int slot = slots[i];
+        p.exposures[slot]++;
+        addWeight(p, slot, weightFor(p, p.exposures[slot]));
+        picked.push_back(p.weightedIds[slot]);
+    }
+    if (p.totalWeight < ldexp((double)n, -REBASE_EXPONENT)) {
+        rebase(p);
+    }
+    return picked;
+}
+
+vector<int> QuestionSampler::sample(int courseId, int count, SelectionMode mode) {
+    if (mode == SELECT_BALANCED) {
+        return sampleBalanced(courseId, count);
+    }
+
+    vector<int>& ids = pool(courseId).ids;
+    int n = (int)ids.size();
+    if (count > n) count = n;
+    if (count < 0) count = 0;
+
+    // Partial Fisher-Yates: the first count slots end up a uniform sample.
+    // The pool is only permuted, so it stays valid for the next draw.
+    vector<int> picked;
+    picked.reserve(count);
+    for (int i = 0; i < count; i++) {
+        uniform_int_distribution<int> dist(i, n - 1);
+        int j = dist(rng);
+        swap(ids[i], ids[j]);
+        picked.push_back(ids[i]);
+    }
+    return picked;
+}
+
+void QuestionSampler::loadStrata(int courseId, CoursePool& p) {
+    p.stratumIds.clear();
+    p.topics.clear();
+    p.difficulties.clear();
+    p.strata.clear();
+    const char* sql = "SELECT id, topic, difficulty FROM questions WHERE course_id = ?";
+    sqlite3_stmt* stmt = stmtCache->acquire(sql);
+    if (stmt) {
+        sqlite3_bind_int(stmt, 1, courseId);
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            p.stratumIds.push_back(sqlite3_column_int(stmt, 0));
+            p.topics.push_back(string((char*)sqlite3_column_text(stmt, 1)));
+            p.difficulties.push_back((signed char)sqlite3_column_int(stmt, 2));
+        }
+        stmtCache->release(stmt);
+    }
+    p.stratified = true;
+}
+
+vector<int>& QuestionSampler::stratum(CoursePool& p, const BlueprintRow& row) {
+    pair<string, int> key(topicKey(row.topic), row.difficulty);
+    map<pair<string, int>, vector<int> >::iterator it = p.strata.find(key);
+    if (it != p.strata.end()) {
+        return it->second;
+    }
+    
+    // Built once per row and pool version; later draws only permute it
+    vector<int>& ids = p.strata[key];
+    for (size_t i = 0; i < p.stratumIds.size(); i++) {
+        if (row.matches(p.topics[i], p.difficulties[i])) {
+            ids.push_back(p.stratumIds[i]);
+        }
+    }
+    return ids;
+}
+
+bool QuestionSampler::sample(int courseId, const Blueprint& blueprint, vector<int>& picked) {
+    CoursePool& p = pool(courseId);
+    if (!p.stratified) {
+        loadStrata(courseId, p);
+    }
+    
+    picked.clear();
+    picked.reserve(blueprint.totalQuestions());
+    bool complete = true;
+    for (size_t r = 0; r < blueprint.rows.size(); r++) {
+        vector<int>& ids = stratum(p, blueprint.rows[r]);
+        int n = (int)ids.size();
+        int wanted = blueprint.rows[r].count;
+        int taken = 0;
+        
+        // Partial Fisher-Yates over the row's questions, passing over any
+        // an earlier, overlapping row already took
+        for (int i = 0; i < n && taken < wanted; i++) {
+            uniform_int_distribution<int> dist(i, n - 1);
+            swap(ids[i], ids[dist(rng)]);
+            if (find(picked.begin(), picked.end(), ids[i]) == picked.end()) {
+                picked.push_back(ids[i]);
+                taken++;
+            }
+        }
+        if (taken < wanted) complete = false;
+    }
+    
+    // Rows were filled in blueprint order; don't let the paper show it
+    shuffle(picked.begin(), picked.end(), rng);
+    return complete;
+}
+
+int QuestionSampler::poolSize(int courseId) {
+    return (int)pool(courseId).ids.size();
+}
+
+void QuestionSampler::invalidate(int courseId) {
+    if (courseId < 0) {
+        pools.clear();
+    } else {
+        pools.erase(courseId);
+    }
+}
@@ -0,0 +1,231 @@
+#include "Regrader.h"
+#include "AnswerSheet.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <chrono>
+#include <algorithm>
+
+using namespace std;
+
+static const int REGRADE_CHUNK = 2000;
+static const int MAX_READER_THREADS = 8;
+// Graded chunks waiting for the writer, per reader; bounds memory when
+// writing is the slower side
+static const int QUEUED_CHUNKS_PER_READER = 2;
+
+// Current answer key of the course, indexed by question id - firstId
+struct CourseKey {
+    int firstId;
+    vector<signed char> codes;      // 0..3 = A..D, -1 = no valid answer
+    vector<int> points;             // -1 = not a question of the course (any more)
+    int passingMark;
+};
+
+struct RegradeShared {
+    DatabaseManager* db;
+    int courseId;
+    const CourseKey* key;
+
+    mutex lock;
+    condition_variable changed;
+    deque<vector<Result>*> graded;
+    int queueLimit;
+    int readersLeft;
+    int skipped;
+    bool failed;
+};
+
+static void buildKey(const vector<Question>& questions, int passingMark, CourseKey& key) {
+    int firstId = 0, lastId = -1;
+    for (size_t i = 0; i < questions.size(); i++) {
+        if (i == 0 || questions[i].id < firstId) firstId = questions[i].id;
+        if (i == 0 || questions[i].id > lastId) lastId = questions[i].id;
+    }
+    key.firstId = firstId;
+    key.codes.assign(lastId - firstId + 1, -1);
+    key.points.assign(lastId - firstId + 1, -1);
+    key.passingMark = passingMark;
+
+    for (size_t i = 0; i < questions.size(); i++) {
+        const string& answer = questions[i].correctAnswer;
+        int slot = questions[i].id - firstId;
+        if (answer.size() == 1 && answer[0] >= 'A' && answer[0] <= 'D') {
+            key.codes[slot] = (signed char)(answer[0] - 'A');
+        }
+        key.points[slot] = questions[i].points;
+    }
+}
+
+// Scores one paper through the packed kernel; paperKey is scratch space.
+// False if a question on it has been deleted since the sitting: its mark and
+// weight are gone with it, so the paper can't be re-graded fairly.
+static bool gradePaper(const CourseKey& key, const ResultPaper& paper, AnswerKey& paperKey,
+                       Result& result) {
+    int count = (int)paper.questionIds.size();
+    // Answers are the letters shown, so the key goes into the same order
+    vector<unsigned char> orders = paper.seed.optionOrders(count);
+    paperKey.options.reset(count);
+    paperKey.points.resize(count);
+    paperKey.totalPoints = 0;
+    paperKey.uniformPoints = true;
+
+    for (int i = 0; i < count; i++) {
+        int slot = paper.questionIds[i] - key.firstId;
+        if (slot < 0 || slot >= (int)key.codes.size() || key.points[slot] < 0) {
+            return false;
+        }
+        paperKey.options.setCode(i, displaySlot(orders[i], key.codes[slot]));
+        paperKey.points[i] = key.points[slot];
+        paperKey.totalPoints += paperKey.points[i];
+        if (paperKey.points[i] != paperKey.points[0]) paperKey.uniformPoints = false;
+    }
+
+    result.id = paper.resultId;
+    result.score = scoreSheet(paperKey, paper.answers);
+    result.totalPoints = paperKey.totalPoints;
+    result.percentage = paperKey.totalPoints > 0 ? result.score * 100.0 / paperKey.totalPoints : 0;
+    result.passed = result.percentage >= key.passingMark;
+    return true;
+}
+
+static void readAndGrade(RegradeShared* shared, int afterResultId, int lastResultId) {
+    DatabaseManager db(shared->db->getDatabasePath(), shared->db->getStorageProfile());
+    bool ok = db.isReady();
+
+    vector<ResultPaper> papers;
+    AnswerKey paperKey;
+    while (ok) {
+        if (db.loadResultPapers(shared->courseId, afterResultId, lastResultId,
+                                REGRADE_CHUNK, papers) == 0) {
+            break;
+        }
+        afterResultId = papers.back().resultId;
+
+        vector<Result>* chunk = new vector<Result>();
+        chunk->reserve(papers.size());
+        int skipped = 0;
+        for (size_t i = 0; i < papers.size(); i++) {
+            // Pool snapshot gone, answers corrupt or a question deleted:
+            // leave the stored marks alone
+            chunk->push_back(Result());
+            if (papers[i].questionIds.empty() ||
+                !gradePaper(*shared->key, papers[i], paperKey, chunk->back())) {
+                chunk->pop_back();
+                skipped++;
+            }
+        }
+
+        unique_lock<mutex> lock(shared->lock);
+        shared->skipped += skipped;
+        while ((int)shared->graded.size() >= shared->queueLimit && !shared->failed) {
+            shared->changed.wait(lock);
+        }
+        if (shared->failed) {
+            delete chunk;
+            ok = false;
+            break;
+        }
+        shared->graded.push_back(chunk);
+        shared->changed.notify_all();
+    }
+
+    lock_guard<mutex> lock(shared->lock);
+    if (!ok) shared->failed = true;
+    shared->readersLeft--;
+    shared->changed.notify_all();
+}
+
+bool regradeCourse(DatabaseManager* db, int courseId, RegradeStats* stats, int threads,
+                   RegradeProgress progress, void* progressData) {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    RegradeStats local;
+
+    Course* course = db->getCourseById(courseId);
+    if (!course) {
+        return false;
+    }
+    CourseKey key;
+    buildKey(db->getCourseAnswerKey(courseId), course->passingMark, key);
+    delete course;
+
+    int firstResultId = 0, lastResultId = 0;
+    int total = db->getResultPaperRange(courseId, firstResultId, lastResultId);
+
+    if (threads <= 0) {
+        threads = (int)thread::hardware_concurrency();
+    }
+    threads = max(1, min(threads, MAX_READER_THREADS));
+    threads = min(threads, total / REGRADE_CHUNK + 1);
+
+    RegradeShared shared;
+    shared.db = db;
+    shared.courseId = courseId;
+    shared.key = &key;
+    shared.queueLimit = threads * QUEUED_CHUNKS_PER_READER;
+    shared.readersLeft = 0;
+    shared.skipped = 0;
+    shared.failed = false;
+
+    // Result ids are split into equal ranges, one per reader
+    vector<thread> readers;
+    if (total > 0) {
+        shared.readersLeft = threads;
+        long long span = (long long)lastResultId - firstResultId + 1;
+        for (int t = 0; t < threads; t++) {
+            int rangeStart = firstResultId - 1 + (int)(span * t / threads);
+            int rangeEnd = firstResultId - 1 + (int)(span * (t + 1) / threads);
+            readers.push_back(thread(readAndGrade, &shared, rangeStart, rangeEnd));
+        }
+    }
+
+    // This thread is the only writer
+    bool ok = true;
+    while (true) {
+        vector<Result>* chunk = NULL;
+        {
+            unique_lock<mutex> lock(shared.lock);
+            while (shared.graded.empty() && shared.readersLeft > 0) {
+                shared.changed.wait(lock);
+            }
+            if (shared.graded.empty()) {
+                break;
+            }
+            chunk = shared.graded.front();
+            shared.graded.pop_front();
+            shared.changed.notify_all();
+        }
+
+        int changedRows = ok ? db->updateResultScores(*chunk) : -1;
+        local.papers += (int)chunk->size();
+        delete chunk;
+        if (changedRows < 0) {
+            if (ok) {
+                lock_guard<mutex> lock(shared.lock);
+                shared.failed = true;
+                shared.changed.notify_all();
+            }
+            ok = false;
+            continue;
+        }
+        local.changed += changedRows;
+        if (progress) {
+            progress(local.papers, total, progressData);
+        }
+    }
+
+    for (size_t t = 0; t < readers.size(); t++) {
+        readers[t].join();
+    }
+
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    local.skipped = shared.skipped;
+    local.threads = (int)readers.size();
+    local.seconds = elapsed.count();
+    local.papersPerSecond = local.seconds > 0 ? local.papers / local.seconds : 0;
+    if (stats) {
+        *stats = local;
+    }
+    return ok && !shared.failed;
+}
@@ -0,0 +1,3 @@
+#include "ResultPaper.h"
+
+ResultPaper::ResultPaper() : resultId(0), courseId(0) {}
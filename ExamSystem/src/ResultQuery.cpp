@@ -0,0 +1,21 @@
+#include "ResultQuery.h"
+
+ResultQuery::ResultQuery()
+    : userId(-1), courseId(-1), passed(-1), sortBy(SORT_DATE), ascending(false),
+      pageSize(100), offset(0), afterScore(0), afterId(0) {}
+
+void ResultQuery::rewind() {
+    afterKey = "";
+    afterScore = 0;
+    afterId = 0;
+}
+
+void ResultQuery::resumeAfter(const Result& r) {
+    switch (sortBy) {
+        case SORT_USERNAME: afterKey = r.username; break;
+        case SORT_COURSE: afterKey = r.courseCode; break;
+        case SORT_SCORE: afterScore = r.percentage; break;
+        default: afterKey = r.dateTime; break;
+    }
+    afterId = r.id;
+}
@@ -2,6 +2,7 @@
 #include "Result.h"
 #include "Globals.h"
 #include "DatabaseManager.h"
+#include "Analytics.h"
 #include "LoginWindow.h"
 #include "CourseSelectionWindow.h"
 #include <FL/fl_ask.H>
@@ -15,37 +16,28 @@
 using namespace std;
 
 void ResultWindow::viewAnalyticsCallback(Fl_Widget* w, void* data) {
-    ResultWindow* resWin = (ResultWindow*)data;
-
-    vector<Result> history = dbManager->getResults(currentUser->id);
+    HistorySummary summary;
+    summarizeHistory(dbManager, currentUser->id, summary);
 
     stringstream analytics;
     analytics << "=== PERFORMANCE ANALYTICS ===\n\n";
     analytics << "Student: " << currentUser->username << "\n\n";
-    analytics << "Total Exams Taken: " << history.size() << "\n\n";
+    analytics << "Total Exams Taken: " << summary.taken << "\n\n";
 
-    if (!history.empty()) {
-        double avgScore = 0;
-        int passed = 0;
-
-        for (size_t i = 0; i < history.size(); i++) {
-            avgScore += history[i].percentage;
-            if (history[i].passed) passed++;
-        }
-
-        avgScore /= history.size();
-
-        analytics << "Average Score: " << fixed << setprecision(1) << avgScore << "%\n";
-        analytics << "Exams Passed: " << passed << " / " << history.size() << "\n";
-        analytics << "Pass Rate: " << (passed * 100 / (int)history.size()) << "%\n\n";
+    if (summary.taken > 0) {
+        analytics << "Average Score: " << fixed << setprecision(1)
+                  << summary.averagePercentage() << "%\n";
+        analytics << "Exams Passed: " << summary.passed << " / " << summary.taken << "\n";
+        analytics << "Pass Rate: " << summary.passRate() << "%\n\n";
 
         analytics << "--- Recent Exam History ---\n\n";
-        for (size_t i = 0; i < min(history.size(), (size_t)10); i++) {
-            analytics << history[i].courseCode << " - " << history[i].courseTitle << "\n";
-            analytics << "Date: " << history[i].dateTime << "\n";
-            analytics << "Score: " << history[i].score << "/" << history[i].totalPoints
-                      << " (" << history[i].percentage << "%) - "
-                      << (history[i].passed ? "PASS" : "FAIL") << "\n\n";
+        for (size_t i = 0; i < summary.recent.size(); i++) {
+            const Result& r = summary.recent[i];
+            analytics << r.courseCode << " - " << r.courseTitle << "\n";
+            analytics << "Date: " << r.dateTime << "\n";
+            analytics << "Score: " << r.score << "/" << r.totalPoints
+                      << " (" << r.percentage << "%) - "
+                      << (r.passed ? "PASS" : "FAIL") << "\n\n";
         }
     }
 
@@ -171,6 +163,10 @@ ResultWindow::ResultWindow(Result r) : result(r) {
     analyticsBtn->color(fl_rgb_color(100, 149, 237));
     analyticsBtn->labelsize(12);
     analyticsBtn->callback(viewAnalyticsCallback, this);
+    if (!dbManager) {
+        // The history is on the hall server, which only serves the exam itself
+        analyticsBtn->deactivate();
+    }
 
     Fl_Button* newExamBtn = new Fl_Button(280, 490, 160, 40, "New Exam");
     newExamBtn->color(FL_GREEN);
@@ -0,0 +1,199 @@
+#include "ResultsTable.h"
+#include "Globals.h"
+#include <FL/Fl.H>
+#include <FL/fl_draw.H>
+#include <cstdio>
+
+using namespace std;
+
+static const int PAGE_SIZE = 100;
+static const int MAX_CACHED_PAGES = 30;
+
+static const int COLUMN_COUNT = 7;
+static const char* columnTitles[COLUMN_COUNT] = {
+    "Candidate", "Course", "Title", "Date", "Score", "Percent", "Status"
+};
+static const int columnWidths[COLUMN_COUNT] = { 150, 90, 230, 150, 80, 80, 85 };
+// Sort pushed into SQL for each column; -1 = not sortable
+static const int columnSorts[COLUMN_COUNT] = {
+    SORT_USERNAME, SORT_COURSE, -1, SORT_DATE, -1, SORT_SCORE, -1
+};
+
+ResultsTable::ResultsTable(int x, int y, int w, int h)
+    : Fl_Table(x, y, w, h), totalRows(0) {
+    cols(COLUMN_COUNT);
+    col_header(1);
+    col_header_height(25);
+    col_resize(1);
+    row_height_all(22);
+    for (int c = 0; c < COLUMN_COUNT; c++) {
+        col_width(c, columnWidths[c]);
+    }
+    rows(0);
+    callback(eventCallback, this);
+    when(FL_WHEN_NOT_CHANGED | FL_WHEN_RELEASE);
+    end();
+}
+
+void ResultsTable::setQuery(const ResultQuery& query, int rowCount) {
+    ResultSort sortBy = baseQuery.sortBy;
+    bool ascending = baseQuery.ascending;
+    
+    baseQuery = query;
+    baseQuery.sortBy = sortBy;
+    baseQuery.ascending = ascending;
+    baseQuery.rewind();
+    totalRows = rowCount;
+    reload();
+}
+
+void ResultsTable::reload() {
+    pages.clear();
+    pageOrder.clear();
+    pageEnds.clear();
+    
+    // Sorting doesn't change the row count, so it is kept across reloads
+    rows(totalRows);
+    top_row(0);
+    redraw();
+}
+
+int ResultsTable::totalCount() {
+    return totalRows;
+}
+
+bool ResultsTable::collectRow(const Result& result, void* data) {
+    ((vector<Result>*)data)->push_back(result);
+    return true;
+}
+
+vector<Result>* ResultsTable::loadPage(int page) {
+    map<int, vector<Result> >::iterator cached = pages.find(page);
+    if (cached != pages.end()) {
+        pageOrder.remove(page);
+        pageOrder.push_front(page);
+        return &cached->second;
+    }
+    
+    // Resume from the closest earlier page we know the end of, so only the
+    // gap between it and the wanted page is skipped with OFFSET
+    ResultQuery query = baseQuery;
+    query.pageSize = PAGE_SIZE;
+    map<int, Result>::iterator anchor = pageEnds.lower_bound(page);
+    if (anchor != pageEnds.begin()) {
+        --anchor;
+        query.resumeAfter(anchor->second);
+        query.offset = (page - anchor->first - 1) * PAGE_SIZE;
+    } else {
+        query.offset = page * PAGE_SIZE;
+    }
+    
+    vector<Result>& rowsOfPage = pages[page];
+    rowsOfPage.reserve(PAGE_SIZE);
+    dbManager->streamResults(query, collectRow, &rowsOfPage);
+    if (!rowsOfPage.empty()) {
+        pageEnds[page] = rowsOfPage.back();
+    }
+    
+    pageOrder.push_front(page);
+    if ((int)pageOrder.size() > MAX_CACHED_PAGES) {
+        pages.erase(pageOrder.back());
+        pageOrder.pop_back();
+    }
+    return &pages[page];
+}
+
+const Result* ResultsTable::rowAt(int row) {
+    vector<Result>* page = loadPage(row / PAGE_SIZE);
+    int index = row % PAGE_SIZE;
+    if (index >= (int)page->size()) {
+        return NULL;
+    }
+    return &(*page)[index];
+}
+
+void ResultsTable::drawHeader(int col, int X, int Y, int W, int H) {
+    char label[64];
+    const char* arrow = "";
+    if (columnSorts[col] == (int)baseQuery.sortBy) {
+        arrow = baseQuery.ascending ? " ^" : " v";
+    }
+    sprintf(label, "%s%s", columnTitles[col], arrow);
+    
+    fl_push_clip(X, Y, W, H);
+    fl_draw_box(FL_THIN_UP_BOX, X, Y, W, H, FL_BACKGROUND_COLOR);
+    fl_color(FL_BLACK);
+    fl_draw(label, X + 4, Y, W - 8, H, FL_ALIGN_LEFT);
+    fl_pop_clip();
+}
+
+void ResultsTable::drawCell(int row, int col, int X, int Y, int W, int H) {
+    const Result* r = rowAt(row);
+    // Names and titles are free text of any length; only numbers are formatted
+    char number[64] = "";
+    const char* text = number;
+    Fl_Color textColor = FL_BLACK;
+    
+    if (r) {
+        switch (col) {
+            case 0: text = r->username.c_str(); break;
+            case 1: text = r->courseCode.c_str(); break;
+            case 2: text = r->courseTitle.c_str(); break;
+            case 3: text = r->dateTime.c_str(); break;
+            case 4: snprintf(number, sizeof(number), "%d/%d", r->score, r->totalPoints); break;
+            case 5: snprintf(number, sizeof(number), "%.1f%%", r->percentage); break;
+            case 6:
+                text = r->passed ? "PASS" : "FAIL";
+                if (r->passed) textColor = FL_DARK_GREEN;
+                else textColor = FL_RED;
+                break;
+        }
+    }
+    
+    fl_push_clip(X, Y, W, H);
+    fl_color(row % 2 ? fl_rgb_color(240, 245, 250) : FL_WHITE);
+    fl_rectf(X, Y, W, H);
+    fl_color(textColor);
+    fl_draw(text, X + 4, Y, W - 8, H, FL_ALIGN_LEFT);
+    fl_color(FL_LIGHT2);
+    fl_rect(X, Y, W, H);
+    fl_pop_clip();
+}
+
+void ResultsTable::draw_cell(TableContext context, int R, int C, int X, int Y, int W, int H) {
+    switch (context) {
+        case CONTEXT_STARTPAGE:
+            fl_font(FL_HELVETICA, 12);
+            return;
+        case CONTEXT_COL_HEADER:
+            drawHeader(C, X, Y, W, H);
+            return;
+        case CONTEXT_CELL:
+            drawCell(R, C, X, Y, W, H);
+            return;
+        default:
+            return;
+    }
+}
+
+void ResultsTable::eventCallback(Fl_Widget* w, void* data) {
+    ResultsTable* table = (ResultsTable*)data;
+    if (table->callback_context() != CONTEXT_COL_HEADER || Fl::event() != FL_RELEASE) {
+        return;
+    }
+    
+    int sort = columnSorts[table->callback_col()];
+    if (sort < 0) {
+        return;
+    }
+    
+    if ((int)table->baseQuery.sortBy == sort) {
+        table->baseQuery.ascending = !table->baseQuery.ascending;
+    } else {
+        table->baseQuery.sortBy = (ResultSort)sort;
+        // Names read best A-Z; dates and scores newest/highest first
+        table->baseQuery.ascending = (sort == SORT_USERNAME || sort == SORT_COURSE);
+    }
+    table->baseQuery.rewind();
+    table->reload();
+}
@@ -0,0 +1,11 @@
+#include "SeatPaper.h"
+
+Seat::Seat() : row(0), column(0) {}
+
+Seat::Seat(int r, int c) : row(r), column(c) {}
+
+bool Seat::isSet() const {
+    return row > 0 && column > 0;
+}
+
+SeatPaper::SeatPaper() : courseId(0), optionSeed(0) {}
@@ -0,0 +1,410 @@
+#include "SeatPlanner.h"
+#include "PaperSeed.h"
+#include <thread>
+#include <chrono>
+#include <random>
+#include <algorithm>
+
+using namespace std;
+
+static const int MAX_PLAN_THREADS = 8;
+// Below this many seats per thread another thread isn't worth starting
+static const int MIN_SEATS_PER_THREAD = 64;
+static const int MAX_SWEEPS = 16;
+// A sweep must cut the cost by this much for another to run
+static const int MIN_SWEEP_GAIN_PERCENT = 1;
+
+// Cost of one question on both papers of a neighbouring pair, times the
+// pair's weight; the same position or option order makes it easy to copy
+static const int SHARED_COST = 1;
+static const int SAME_POSITION_COST = 4;
+static const int SAME_ORDER_COST = 2;
+// Side by side is easiest to read across, diagonal the hardest
+static const int SIDE_WEIGHT = 3;
+static const int FRONT_BACK_WEIGHT = 2;
+static const int DIAGONAL_WEIGHT = 1;
+
+// Tries per shared question, per seat and sweep
+static const int REPLACE_TRIES = 8;
+static const int RESEED_TRIES = 4;
+static const int SWAP_TRIES = 4;
+
+struct Neighbour {
+    int seat;
+    int weight;
+};
+
+// The hall while it is planned. Questions are indexes into the course's
+// pool, seats are numbered row by row from 0.
+struct Hall {
+    int rows;
+    int columns;
+    vector<vector<int> > papers;                // paper order
+    vector<uint64_t> seeds;
+    vector<vector<unsigned char> > orders;      // from seeds
+    vector<vector<Neighbour> > neighbours;
+    vector<int> groupOf;                        // replacements come from the same group
+    vector<vector<int> > groups;
+};
+
+// One entry per question on a neighbour's paper
+struct NeighbourQuestion {
+    int next;           // next entry for the same question, -1 = last
+    int position;
+    int order;
+    int weight;
+};
+
+// Per-thread working space, sized to the pool once
+struct SeatSearch {
+    vector<int> head;                   // first entry per question, -1 = none
+    vector<NeighbourQuestion> entries;
+    vector<int> touched;
+    vector<int> onPaper;                // == stamp while on the seat's paper
+    int stamp;
+    vector<int> costs;
+    vector<unsigned char> trialOrders;
+    mt19937_64 rng;
+    long long gained;
+
+    SeatSearch() : stamp(0), gained(0) {}
+};
+
+static vector<unsigned char> ordersFor(uint64_t seed, int count) {
+    PaperSeed paperSeed(0, seed, 0);
+    paperSeed.shuffledOptions = true;
+    return paperSeed.optionOrders(count);
+}
+
+static void buildNeighbours(Hall& hall) {
+    static const int offsets[8][3] = {
+        {0, -1, SIDE_WEIGHT}, {0, 1, SIDE_WEIGHT},
+        {-1, 0, FRONT_BACK_WEIGHT}, {1, 0, FRONT_BACK_WEIGHT},
+        {-1, -1, DIAGONAL_WEIGHT}, {-1, 1, DIAGONAL_WEIGHT},
+        {1, -1, DIAGONAL_WEIGHT}, {1, 1, DIAGONAL_WEIGHT}
+    };
+    hall.neighbours.assign(hall.rows * hall.columns, vector<Neighbour>());
+    for (int r = 0; r < hall.rows; r++) {
+        for (int c = 0; c < hall.columns; c++) {
+            for (int k = 0; k < 8; k++) {
+                int nr = r + offsets[k][0], nc = c + offsets[k][1];
+                if (nr < 0 || nr >= hall.rows || nc < 0 || nc >= hall.columns) continue;
+                Neighbour n;
+                n.seat = nr * hall.columns + nc;
+                n.weight = offsets[k][2];
+                hall.neighbours[r * hall.columns + c].push_back(n);
+            }
+        }
+    }
+}
+
+static void loadNeighbours(const Hall& hall, int seat, SeatSearch& search) {
+    const vector<Neighbour>& around = hall.neighbours[seat];
+    for (size_t k = 0; k < around.size(); k++) {
+        const vector<int>& paper = hall.papers[around[k].seat];
+        const vector<unsigned char>& orders = hall.orders[around[k].seat];
+        for (size_t p = 0; p < paper.size(); p++) {
+            int q = paper[p];
+            if (search.head[q] < 0) search.touched.push_back(q);
+            NeighbourQuestion e;
+            e.next = search.head[q];
+            e.position = (int)p;
+            e.order = orders[p];
+            e.weight = around[k].weight;
+            search.head[q] = (int)search.entries.size();
+            search.entries.push_back(e);
+        }
+    }
+}
+
+static void clearNeighbours(SeatSearch& search) {
+    for (size_t i = 0; i < search.touched.size(); i++) {
+        search.head[search.touched[i]] = -1;
+    }
+    search.touched.clear();
+    search.entries.clear();
+}
+
+// What question q at this position and option order costs against the
+// loaded neighbours
+static int costAt(const SeatSearch& search, int q, int position, int order) {
+    int cost = 0;
+    for (int e = search.head[q]; e >= 0; e = search.entries[e].next) {
+        const NeighbourQuestion& n = search.entries[e];
+        cost += n.weight * (SHARED_COST + (n.position == position ? SAME_POSITION_COST : 0) +
+                            (n.order == order ? SAME_ORDER_COST : 0));
+    }
+    return cost;
+}
+
+// One local-search step on a seat with its neighbours held fixed. Returns
+// how much the seat's cost fell.
+static long long improveSeat(Hall& hall, int seat, SeatSearch& search) {
+    vector<int>& paper = hall.papers[seat];
+    vector<unsigned char>& orders = hall.orders[seat];
+    int count = (int)paper.size();
+    loadNeighbours(hall, seat, search);
+
+    search.stamp++;
+    long long before = 0;
+    search.costs.resize(count);
+    for (int i = 0; i < count; i++) {
+        search.onPaper[paper[i]] = search.stamp;
+        search.costs[i] = costAt(search, paper[i], i, orders[i]);
+        before += search.costs[i];
+    }
+    if (before == 0) {
+        clearNeighbours(search);
+        return 0;
+    }
+
+    // Shared questions out for ones no neighbour has, if the pool has them
+    for (int i = 0; i < count; i++) {
+        if (search.costs[i] == 0) continue;
+        const vector<int>& group = hall.groups[hall.groupOf[paper[i]]];
+        int best = -1, bestCost = search.costs[i];
+        for (int t = 0; t < REPLACE_TRIES && bestCost > 0; t++) {
+            int q = group[search.rng() % group.size()];
+            if (search.onPaper[q] == search.stamp) continue;
+            int cost = costAt(search, q, i, orders[i]);
+            if (cost < bestCost) {
+                best = q;
+                bestCost = cost;
+            }
+        }
+        if (best >= 0) {
+            search.onPaper[paper[i]] = 0;
+            search.onPaper[best] = search.stamp;
+            paper[i] = best;
+            search.costs[i] = bestCost;
+        }
+    }
+
+    // Option orders for whatever is still shared
+    long long current = 0;
+    for (int i = 0; i < count; i++) current += search.costs[i];
+    for (int t = 0; t < RESEED_TRIES && current > 0; t++) {
+        uint64_t seed = search.rng();
+        search.trialOrders = ordersFor(seed, count);
+        long long cost = 0;
+        for (int i = 0; i < count; i++) {
+            cost += costAt(search, paper[i], i, search.trialOrders[i]);
+        }
+        if (cost < current) {
+            hall.seeds[seat] = seed;
+            orders.swap(search.trialOrders);
+            current = cost;
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        search.costs[i] = costAt(search, paper[i], i, orders[i]);
+    }
+
+    // Shared questions away from where their neighbours have them
+    for (int i = 0; i < count && count > 1; i++) {
+        for (int t = 0; t < SWAP_TRIES && search.costs[i] > 0; t++) {
+            int j = (int)(search.rng() % (count - 1));
+            if (j >= i) j++;
+            int costI = costAt(search, paper[j], i, orders[i]);
+            int costJ = costAt(search, paper[i], j, orders[j]);
+            if (costI + costJ < search.costs[i] + search.costs[j]) {
+                swap(paper[i], paper[j]);
+                search.costs[i] = costI;
+                search.costs[j] = costJ;
+            }
+        }
+    }
+
+    long long after = 0;
+    for (int i = 0; i < count; i++) after += search.costs[i];
+    clearNeighbours(search);
+    return before - after;
+}
+
+// Improves seats [first, last) of one colour class
+static void searchSeats(Hall* hall, const vector<int>* seats, int first, int last,
+                        SeatSearch* search) {
+    for (int i = first; i < last; i++) {
+        search->gained += improveSeat(*hall, (*seats)[i], *search);
+    }
+}
+
+static SeatOverlap measureOverlap(const Hall& hall, int poolSize) {
+    SeatOverlap overlap;
+    vector<int> positionOf(poolSize, -1);
+    for (size_t s = 0; s < hall.papers.size(); s++) {
+        const vector<int>& paper = hall.papers[s];
+        for (size_t i = 0; i < paper.size(); i++) positionOf[paper[i]] = (int)i;
+
+        // Each pair once, from its lower-numbered seat
+        const vector<Neighbour>& around = hall.neighbours[s];
+        for (size_t k = 0; k < around.size(); k++) {
+            int other = around[k].seat;
+            if (other < (int)s) continue;
+            overlap.adjacentPairs++;
+            int shared = 0;
+            for (size_t j = 0; j < hall.papers[other].size(); j++) {
+                int p = positionOf[hall.papers[other][j]];
+                if (p < 0) continue;
+                shared++;
+                bool samePosition = p == (int)j;
+                bool sameOrder = hall.orders[s][p] == hall.orders[other][j];
+                overlap.samePosition += samePosition ? 1 : 0;
+                overlap.sameOrder += sameOrder ? 1 : 0;
+                overlap.cost += around[k].weight * (SHARED_COST +
+                                (samePosition ? SAME_POSITION_COST : 0) +
+                                (sameOrder ? SAME_ORDER_COST : 0));
+            }
+            overlap.sharedQuestions += shared;
+            if (shared > 0) overlap.sharingPairs++;
+        }
+        for (size_t i = 0; i < paper.size(); i++) positionOf[paper[i]] = -1;
+    }
+    return overlap;
+}
+
+bool planSeating(DatabaseManager* db, int courseId, int rows, int columns,
+                 SeatPlanStats* stats, int threads) {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    SeatPlanStats local;
+    if (rows <= 0 || columns <= 0) {
+        return false;
+    }
+
+    Course* course = db->getCourseById(courseId);
+    if (!course) {
+        return false;
+    }
+    int count = course->questionsPerExam;
+    SelectionMode mode = course->selectionMode;
+    delete course;
+    Blueprint blueprint = db->getBlueprint(courseId);
+
+    // The pool, grouped so a replacement can't break the blueprint
+    vector<Question> pool = db->getQuestionStrata(courseId);
+    if (pool.empty()) {
+        return false;
+    }
+    Hall hall;
+    hall.rows = rows;
+    hall.columns = columns;
+    map<int, int> indexOf;
+    map<pair<string, int>, int> groupIndex;
+    hall.groupOf.resize(pool.size());
+    for (size_t i = 0; i < pool.size(); i++) {
+        indexOf[pool[i].id] = (int)i;
+        pair<string, int> key("", 0);
+        if (!blueprint.rows.empty()) {
+            key = pair<string, int>(topicKey(pool[i].topic), pool[i].difficulty);
+        }
+        map<pair<string, int>, int>::iterator it = groupIndex.find(key);
+        if (it == groupIndex.end()) {
+            it = groupIndex.insert(make_pair(key, (int)hall.groups.size())).first;
+            hall.groups.push_back(vector<int>());
+        }
+        hall.groupOf[i] = it->second;
+        hall.groups[it->second].push_back((int)i);
+    }
+
+    // Every seat's paper drawn as a sitting would draw it
+    int seats = rows * columns;
+    random_device device;
+    mt19937_64 rng(device());
+    hall.papers.resize(seats);
+    hall.seeds.resize(seats);
+    hall.orders.resize(seats);
+    for (int s = 0; s < seats; s++) {
+        vector<int> ids;
+        if (blueprint.rows.empty() || !db->sampleBlueprintIds(courseId, blueprint, ids)) {
+            ids = db->sampleQuestionIds(courseId, count, mode);
+        }
+        if (ids.empty()) {
+            return false;
+        }
+        for (size_t i = 0; i < ids.size(); i++) {
+            map<int, int>::iterator it = indexOf.find(ids[i]);
+            if (it == indexOf.end()) {
+                // Added since the pool was read
+                return false;
+            }
+            hall.papers[s].push_back(it->second);
+        }
+        hall.seeds[s] = rng();
+        hall.orders[s] = ordersFor(hall.seeds[s], (int)ids.size());
+    }
+    buildNeighbours(hall);
+    chrono::steady_clock::time_point drawn = chrono::steady_clock::now();
+    local.drawn = measureOverlap(hall, (int)pool.size());
+
+    if (threads <= 0) {
+        threads = (int)thread::hardware_concurrency();
+    }
+    threads = max(1, min(threads, MAX_PLAN_THREADS));
+    threads = min(threads, seats / MIN_SEATS_PER_THREAD + 1);
+
+    // Seats two apart in both directions are never neighbours
+    vector<vector<int> > colours(4);
+    for (int s = 0; s < seats; s++) {
+        colours[(s / columns % 2) * 2 + s % columns % 2].push_back(s);
+    }
+    vector<SeatSearch> searches(threads);
+    for (int t = 0; t < threads; t++) {
+        searches[t].head.assign(pool.size(), -1);
+        searches[t].onPaper.assign(pool.size(), 0);
+        searches[t].rng.seed(rng());
+    }
+
+    long long cost = local.drawn.cost;
+    while (cost > 0 && local.sweeps < MAX_SWEEPS) {
+        long long gained = 0;
+        for (int c = 0; c < 4; c++) {
+            const vector<int>& members = colours[c];
+            int total = (int)members.size();
+            vector<thread> workers;
+            for (int t = 1; t < threads; t++) {
+                int first = (int)((long long)total * t / threads);
+                int last = (int)((long long)total * (t + 1) / threads);
+                workers.push_back(thread(searchSeats, &hall, &members, first, last,
+                                         &searches[t]));
+            }
+            searchSeats(&hall, &members, 0, total / threads, &searches[0]);
+            for (size_t t = 0; t < workers.size(); t++) {
+                workers[t].join();
+            }
+        }
+        for (int t = 0; t < threads; t++) {
+            gained += searches[t].gained;
+            searches[t].gained = 0;
+        }
+        local.sweeps++;
+        cost -= gained;
+        // Later sweeps would only shave the last few percent
+        if (gained * 100 < cost * MIN_SWEEP_GAIN_PERCENT) break;
+    }
+    chrono::steady_clock::time_point searched = chrono::steady_clock::now();
+    local.planned = measureOverlap(hall, (int)pool.size());
+
+    vector<SeatPaper> papers(seats);
+    for (int s = 0; s < seats; s++) {
+        papers[s].courseId = courseId;
+        papers[s].seat = Seat(s / columns + 1, s % columns + 1);
+        papers[s].optionSeed = hall.seeds[s];
+        for (size_t i = 0; i < hall.papers[s].size(); i++) {
+            papers[s].questionIds.push_back(pool[hall.papers[s][i]].id);
+        }
+    }
+    bool ok = db->saveSeatPapers(courseId, papers) == seats;
+
+    chrono::duration<double> drawTime = drawn - start;
+    chrono::duration<double> searchTime = searched - drawn;
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    local.seats = seats;
+    local.threads = threads;
+    local.drawSeconds = drawTime.count();
+    local.searchSeconds = searchTime.count();
+    local.seconds = elapsed.count();
+    if (stats) {
+        *stats = local;
+    }
+    return ok;
+}
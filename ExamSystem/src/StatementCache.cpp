@@ -0,0 +1,64 @@
+#include "StatementCache.h"
+
+using namespace std;
+
+StatementCache::StatementCache(sqlite3* database)
+    : db(database), hitCount(0), missCount(0) {}
+
+StatementCache::~StatementCache() {
+    clear();
+}
+
+sqlite3_stmt* StatementCache::acquire(const char* sql) {
+    map<string, sqlite3_stmt*>::iterator it = statements.find(sql);
+    if (it != statements.end()) {
+        hitCount++;
+        sqlite3_reset(it->second);
+        return it->second;
+    }
+    
+    missCount++;
+    sqlite3_stmt* stmt = NULL;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, 0) != SQLITE_OK) {
+        sqlite3_finalize(stmt);
+        return NULL;
+    }
+    statements[sql] = stmt;
+    return stmt;
+}
+
+void StatementCache::release(sqlite3_stmt* stmt) {
+    if (stmt) {
+        sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
+    }
+}
+
+void StatementCache::clear() {
+    for (map<string, sqlite3_stmt*>::iterator it = statements.begin();
+         it != statements.end(); ++it) {
+        sqlite3_finalize(it->second);
+    }
+    statements.clear();
+}
+
+unsigned long StatementCache::hits() const {
+    return hitCount;
+}
+
+unsigned long StatementCache::misses() const {
+    return missCount;
+}
+
+int StatementCache::size() const {
+    return (int)statements.size();
+}
+
+vector<string> StatementCache::statementsSql() const {
+    vector<string> sql;
+    for (map<string, sqlite3_stmt*>::const_iterator it = statements.begin();
+         it != statements.end(); ++it) {
+        sql.push_back(it->first);
+    }
+    return sql;
+}
@@ -0,0 +1,113 @@
+#include "StorageProfile.h"
+#include <sstream>
+#include <thread>
+#include <chrono>
+
+using namespace std;
+
+StorageProfile::StorageProfile()
+    : name("exam-hall"), journalMode("WAL"), synchronous("NORMAL"),
+      cacheSizeKb(16384), mmapSize(64LL * 1024 * 1024), tempStore("MEMORY"),
+      busyTimeoutMs(5000), backoffInitialMs(1), backoffMaxMs(50) {}
+
+StorageProfile StorageProfile::examHall() {
+    return StorageProfile();
+}
+
+StorageProfile StorageProfile::bulkImport() {
+    StorageProfile p;
+    p.name = "bulk-import";
+    p.synchronous = "OFF";
+    p.cacheSizeKb = 65536;
+    p.mmapSize = 256LL * 1024 * 1024;
+    p.busyTimeoutMs = 30000;
+    p.backoffMaxMs = 100;
+    return p;
+}
+
+StorageProfile StorageProfile::durable() {
+    StorageProfile p;
+    p.name = "durable";
+    p.journalMode = "DELETE";
+    p.synchronous = "FULL";
+    p.cacheSizeKb = 8192;
+    p.mmapSize = 0;
+    p.tempStore = "DEFAULT";
+    p.busyTimeoutMs = 10000;
+    return p;
+}
+
+bool StorageProfile::byName(const string& presetName, StorageProfile& profile) {
+    if (presetName == "exam-hall") {
+        profile = examHall();
+    } else if (presetName == "bulk-import") {
+        profile = bulkImport();
+    } else if (presetName == "durable") {
+        profile = durable();
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// SQLite calls this with the number of times it has already retried.
+// Delays double from backoffInitialMs up to backoffMaxMs until the total
+// wait would pass busyTimeoutMs, at which point SQLITE_BUSY is returned.
+static int busyBackoff(void* data, int retries) {
+    const StorageProfile* profile = (const StorageProfile*)data;
+    
+    int waited = 0;
+    int delay = profile->backoffInitialMs > 0 ? profile->backoffInitialMs : 1;
+    for (int i = 0; i < retries; i++) {
+        waited += delay;
+        if (delay < profile->backoffMaxMs) delay *= 2;
+        if (delay > profile->backoffMaxMs) delay = profile->backoffMaxMs;
+        if (waited >= profile->busyTimeoutMs) return 0;
+    }
+    
+    if (waited + delay > profile->busyTimeoutMs) {
+        delay = profile->busyTimeoutMs - waited;
+    }
+    this_thread::sleep_for(chrono::milliseconds(delay));
+    return 1;
+}
+
+bool StorageProfile::apply(sqlite3* db, string& error) const {
+    // Installed first: the journal_mode change itself may have to wait
+    sqlite3_busy_handler(db, busyBackoff, (void*)this);
+    
+    // SQLite keeps the old mode, without an error, where the new one isn't
+    // possible (WAL without shared memory); the reply says which it kept
+    string journal = "PRAGMA journal_mode = " + journalMode;
+    string mode;
+    sqlite3_stmt* stmt = NULL;
+    if (sqlite3_prepare_v2(db, journal.c_str(), -1, &stmt, NULL) == SQLITE_OK &&
+        sqlite3_step(stmt) == SQLITE_ROW) {
+        mode = (const char*)sqlite3_column_text(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    if (mode.empty()) {
+        error = string("Cannot apply storage profile ") + name + ": " + sqlite3_errmsg(db);
+        return false;
+    }
+    if (sqlite3_stricmp(mode.c_str(), journalMode.c_str()) != 0) {
+        error = string("Cannot apply storage profile ") + name + ": journal mode stayed " +
+                mode + " instead of " + journalMode +
+                " (use the durable profile where WAL is unavailable)";
+        return false;
+    }
+    
+    stringstream sql;
+    sql << "PRAGMA synchronous = " << synchronous << ";"
+        << "PRAGMA cache_size = " << -cacheSizeKb << ";"
+        << "PRAGMA mmap_size = " << mmapSize << ";"
+        << "PRAGMA temp_store = " << tempStore << ";";
+    
+    char* errMsg = 0;
+    if (sqlite3_exec(db, sql.str().c_str(), NULL, 0, &errMsg) != SQLITE_OK) {
+        error = string("Cannot apply storage profile ") + name + ": " + errMsg;
+        sqlite3_free(errMsg);
+        return false;
+    }
+    return true;
+}
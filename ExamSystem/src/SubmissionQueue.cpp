@@ -0,0 +1,172 @@
+#include "SubmissionQueue.h"
+#include <chrono>
+
+using namespace std;
+
+SubmissionQueue::SubmissionQueue(const string& path, const StorageProfile& profile,
+                                 int groupLimit, int delayMs)
+    : maxGroup(groupLimit > 0 ? groupLimit : 1), maxDelayMs(delayMs > 0 ? delayMs : 0),
+      stopping(false) {
+    // Only the writer thread touches this connection once it is running
+    db = new DatabaseManager(path, profile);
+    if (db->isReady()) {
+        writer = thread(&SubmissionQueue::run, this);
+    }
+}
+
+SubmissionQueue::~SubmissionQueue() {
+    {
+        lock_guard<mutex> guard(queueLock);
+        stopping = true;
+    }
+    queued.notify_one();
+    if (writer.joinable()) {
+        writer.join();
+    }
+    delete db;
+}
+
+bool SubmissionQueue::isReady() {
+    return db->isReady();
+}
+
+string SubmissionQueue::getLastError() {
+    return db->getLastError();
+}
+
+void SubmissionQueue::enqueue(Submission* submission) {
+    // Caller holds queueLock
+    queue.push_back(submission);
+    queued.notify_one();
+}
+
+int SubmissionQueue::submit(const Result& r, const ResultPaper& paper, int sessionId,
+                            const vector<SessionAnswer>& finalChanges) {
+    if (!writer.joinable()) {
+        return -1;
+    }
+    // Lives on this stack until the writer marks it done
+    Submission submission;
+    submission.result = r;
+    submission.paper = paper;
+    submission.sessionId = sessionId;
+    submission.finalChanges = finalChanges;
+    submission.resultId = -1;
+    submission.done = false;
+    submission.callback = NULL;
+    submission.callbackData = NULL;
+
+    unique_lock<mutex> guard(queueLock);
+    enqueue(&submission);
+    while (!submission.done) {
+        committed.wait(guard);
+    }
+    return submission.resultId;
+}
+
+bool SubmissionQueue::post(const Result& r, const ResultPaper& paper, int sessionId,
+                           const vector<SessionAnswer>& finalChanges, SubmissionDone done,
+                           void* data) {
+    if (!writer.joinable()) {
+        return false;
+    }
+    // Deleted by the writer after the callback
+    Submission* submission = new Submission;
+    submission->result = r;
+    submission->paper = paper;
+    submission->sessionId = sessionId;
+    submission->finalChanges = finalChanges;
+    submission->resultId = -1;
+    submission->done = false;
+    submission->callback = done;
+    submission->callbackData = data;
+
+    lock_guard<mutex> guard(queueLock);
+    enqueue(submission);
+    return true;
+}
+
+SubmissionStats SubmissionQueue::getStats() {
+    lock_guard<mutex> guard(queueLock);
+    return totals;
+}
+
+void SubmissionQueue::writeGroup(vector<Submission*>& group) {
+    bool ok = db->beginTransaction();
+    bool began = ok;
+    for (size_t i = 0; ok && i < group.size(); i++) {
+        Submission* s = group[i];
+        s->resultId = db->submitResult(s->result, s->paper, s->sessionId, s->finalChanges);
+        // A sitting already submitted wrote nothing; the rest can still commit
+        ok = s->resultId >= 0;
+    }
+    if (ok) {
+        ok = db->commitTransaction();
+    }
+    if (ok) {
+        return;
+    }
+    if (began) {
+        db->rollbackTransaction();
+    }
+
+    // Nothing of the group was kept; each one on its own this time
+    for (size_t i = 0; i < group.size(); i++) {
+        Submission* s = group[i];
+        s->resultId = db->submitResult(s->result, s->paper, s->sessionId, s->finalChanges);
+    }
+    lock_guard<mutex> guard(queueLock);
+    totals.retried += (int)group.size();
+}
+
+void SubmissionQueue::run() {
+    unique_lock<mutex> guard(queueLock);
+    for (;;) {
+        while (queue.empty() && !stopping) {
+            queued.wait(guard);
+        }
+        if (queue.empty()) {
+            return;
+        }
+
+        // Give the rest of a storm a moment to join this group
+        chrono::steady_clock::time_point deadline =
+            chrono::steady_clock::now() + chrono::milliseconds(maxDelayMs);
+        while ((int)queue.size() < maxGroup && !stopping &&
+               queued.wait_until(guard, deadline) != cv_status::timeout) {
+        }
+
+        vector<Submission*> group;
+        while (!queue.empty() && (int)group.size() < maxGroup) {
+            group.push_back(queue.front());
+            queue.pop_front();
+        }
+
+        guard.unlock();
+        writeGroup(group);
+        guard.lock();
+
+        totals.submissions += (int)group.size();
+        totals.groups++;
+        if ((int)group.size() > totals.largestGroup) {
+            totals.largestGroup = (int)group.size();
+        }
+        vector<Submission*> posted;
+        for (size_t i = 0; i < group.size(); i++) {
+            if (group[i]->callback) {
+                posted.push_back(group[i]);
+            } else {
+                group[i]->done = true;
+            }
+        }
+        committed.notify_all();
+
+        // Callbacks may take locks of their own; not while holding ours
+        guard.unlock();
+        for (size_t i = 0; i < posted.size(); i++) {
+            posted[i]->callback(posted[i]->resultId, posted[i]->callbackData);
+            delete posted[i];
+        }
+        guard.lock();
+    }
+}
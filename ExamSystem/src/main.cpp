@@ -1,8 +1,12 @@
 
 
 #include <FL/Fl.H>
+#include <FL/fl_ask.H>
+#include <cstdio>
+#include <cstring>
 #include "Globals.h"
 #include "DatabaseManager.h"
+#include "QueryStats.h"
 #include "LoginWindow.h"
 #include "AdminDashboard.h"
 #include "CourseSelectionWindow.h"
@@ -11,8 +15,11 @@
 #include "ResultWindow.h"
 
 DatabaseManager* dbManager = NULL;
+HallClient* hallClient = NULL;
+DbWorker* dbWorker = NULL;
 User* currentUser = NULL;
 Course* selectedCourse = NULL;
+Seat terminalSeat;
 
 
 void showLoginWindow() {
@@ -48,11 +55,53 @@ void showResultWindow(Result result) {
 
 
 int main(int argc, char** argv) {
-    // Initialize database manager
-    dbManager = new DatabaseManager();
+    // A terminal in a planned hall is started as exam_system --seat <row>,<column>;
+    // one served by exam_hallserver adds --server <socket-path|host:port>
+    const char* serverAddress = NULL;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--seat") == 0 &&
+            sscanf(argv[i + 1], "%d,%d", &terminalSeat.row, &terminalSeat.column) != 2) {
+            terminalSeat = Seat();
+        }
+        if (strcmp(argv[i], "--server") == 0) {
+            serverAddress = argv[i + 1];
+        }
+    }
+    
+    // Enables Fl::awake, which the database worker reports back through
+    Fl::lock();
     
-    if (!dbManager) {
-        return 1;
+    if (serverAddress) {
+        // The hall server owns the database; calls to it still run off the UI thread
+        hallClient = new HallClient();
+        if (!hallClient->connect(serverAddress)) {
+            fl_alert("%s", hallClient->getLastError().c_str());
+            delete hallClient;
+            return 1;
+        }
+        dbWorker = new DbWorker("", StorageProfile());
+    } else {
+        // Initialize database manager
+        dbManager = new DatabaseManager();
+        
+        if (!dbManager->isReady()) {
+            fl_alert("%s", dbManager->getLastError().c_str());
+            delete dbManager;
+            return 1;
+        }
+        
+        // Opened after the UI connection, which has already created the schema
+        dbWorker = new DbWorker(dbManager->getDatabasePath(), dbManager->getStorageProfile());
+        
+        if (!dbWorker->isReady()) {
+            fl_alert("%s", dbWorker->getLastError().c_str());
+            delete dbWorker;
+            delete dbManager;
+            return 1;
+        }
+        
+        fl_message("Database initialized successfully!\nPath: %s",
+                   dbManager->getDatabasePath().c_str());
     }
     
     // Show login window
@@ -62,10 +111,21 @@ int main(int argc, char** argv) {
     int result = Fl::run();
     
     // Cleanup
+    if (dbWorker) {
+        delete dbWorker;
+    }
+    
     if (dbManager) {
+#ifdef EXAM_QUERY_STATS
+        dumpQueryStats(dbManager->getDatabasePath() + ".querystats.txt");
+#endif
         delete dbManager;
     }
     
+    if (hallClient) {
+        delete hallClient;
+    }
+    
     if (currentUser) {
         delete currentUser;
     }
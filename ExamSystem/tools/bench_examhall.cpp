@@ -0,0 +1,315 @@
+// Benchmark: a whole exam hall against one database. Each candidate is a
+// thread with its own connection (as each desk runs its own copy of the
+// program) and goes through a sitting on the clock:
+//
+//   login     staggered over the first LOGIN_WINDOW_SECONDS
+//   paper     draw (or resume) and session start, as ExamWindow does; with
+//             the pregen paper mode every paper is drawn before the doors
+//             open and the start only reads it back
+//   autosave  changed answers every AUTOSAVE_SECONDS, as ExamWindow does
+//   submit    everyone at the same deadline (time-up), result + session close;
+//             with the group submit mode through one SubmissionQueue, as a
+//             hall server would, instead of each candidate committing alone
+//
+// Reports p50/p99/p999 latency per operation and overall throughput.
+//
+// Usage: bench_examhall [candidates] [questions] [results] [exam-seconds]
+//                       [database-path] [storage-preset] [draw|pregen]
+//                       [direct|group]
+
+#include "DatabaseManager.h"
+#include "PaperGenerator.h"
+#include "Grader.h"
+#include "SubmissionQueue.h"
+#include "DatabaseSeeder.h"
+#include "QueryStats.h"
+#include <thread>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+static const int AUTOSAVE_SECONDS = 5;
+static const int LOGIN_WINDOW_SECONDS = 2;
+
+enum Operation { OP_LOGIN, OP_PAPER, OP_AUTOSAVE, OP_SUBMIT, OP_COUNT };
+static const char* operationNames[OP_COUNT] = { "login", "paper", "autosave", "submit" };
+
+struct CandidateStats {
+    vector<double> latenciesMs[OP_COUNT];
+    long failures[OP_COUNT];
+    Clock::time_point submittedAt;
+
+    CandidateStats() {
+        for (int op = 0; op < OP_COUNT; op++) failures[op] = 0;
+    }
+};
+
+// Everything the candidates share; read-only once the hall opens
+struct Hall {
+    string path;
+    StorageProfile profile;
+    Course course;
+    int examSeconds;
+    Clock::time_point opens;
+    Clock::time_point deadline;
+    SubmissionQueue* submissions;       // NULL = each candidate commits its own
+};
+
+static void removeDatabase(const string& path) {
+    remove(path.c_str());
+    remove((path + "-wal").c_str());
+    remove((path + "-shm").c_str());
+    remove((path + "-journal").c_str());
+}
+
+static double elapsedMs(Clock::time_point start) {
+    chrono::duration<double, milli> d = Clock::now() - start;
+    return d.count();
+}
+
+static void candidate(const Hall* hall, int index, CandidateStats* stats) {
+    DatabaseManager db(hall->path, hall->profile);
+    if (!db.isReady()) {
+        stats->failures[OP_LOGIN]++;
+        return;
+    }
+    mt19937 rng(index * 7919 + 17);
+
+    // Login burst: everyone arrives within the first few seconds
+    uniform_int_distribution<int> arrival(0, LOGIN_WINDOW_SECONDS * 1000);
+    this_thread::sleep_until(hall->opens + chrono::milliseconds(arrival(rng)));
+
+    Clock::time_point start = Clock::now();
+    User* user = db.authenticateUser(seedUsername(index), SEED_PASSWORD);
+    stats->latenciesMs[OP_LOGIN].push_back(elapsedMs(start));
+    if (!user) {
+        stats->failures[OP_LOGIN]++;
+        return;
+    }
+
+    start = Clock::now();
+    vector<Question> paper;
+    ExamSession session;
+    PaperSource source = preparePaper(&db, user->id, hall->course.id,
+                                      hall->course.questionsPerExam, hall->examSeconds,
+                                      paper, session, hall->course.selectionMode);
+    stats->latenciesMs[OP_PAPER].push_back(elapsedMs(start));
+    if (source == PAPER_NONE || session.id == 0) {
+        stats->failures[OP_PAPER]++;
+        delete user;
+        return;
+    }
+
+    // Answer at a steady pace so the paper is about done by the deadline,
+    // going back to change an earlier answer now and then
+    vector<string> answers = session.answers;
+    vector<string> saved = session.answers;
+    int perSave = max(1, (int)paper.size() * AUTOSAVE_SECONDS / max(1, hall->examSeconds));
+    uniform_int_distribution<int> anyQuestion(0, (int)paper.size() - 1);
+    uniform_int_distribution<int> anyOption(0, 3);
+    uniform_int_distribution<int> phase(0, AUTOSAVE_SECONDS * 1000);
+    int answered = 0;
+
+    Clock::time_point nextSave = Clock::now() + chrono::milliseconds(phase(rng));
+    while (nextSave < hall->deadline) {
+        this_thread::sleep_until(nextSave);
+        nextSave += chrono::seconds(AUTOSAVE_SECONDS);
+
+        for (int i = 0; i < perSave; i++) {
+            int q = answered < (int)paper.size() ? answered++ : anyQuestion(rng);
+            answers[q] = string(1, "ABCD"[anyOption(rng)]);
+        }
+        if (anyOption(rng) == 0) {
+            answers[anyQuestion(rng)] = string(1, "ABCD"[anyOption(rng)]);
+        }
+
+        vector<SessionAnswer> changes;
+        for (size_t q = 0; q < answers.size(); q++) {
+            if (answers[q] != saved[q]) changes.push_back(SessionAnswer((int)q, answers[q]));
+        }
+        int timeSpent = (int)chrono::duration_cast<chrono::seconds>(Clock::now() - hall->opens).count();
+
+        start = Clock::now();
+        bool ok = db.saveSessionProgress(session.id, changes, answered % (int)paper.size(),
+                                         hall->examSeconds - timeSpent, timeSpent);
+        stats->latenciesMs[OP_AUTOSAVE].push_back(elapsedMs(start));
+        if (ok) {
+            saved = answers;
+        } else {
+            stats->failures[OP_AUTOSAVE]++;
+        }
+    }
+
+    // Time up: the whole hall submits at once
+    this_thread::sleep_until(hall->deadline);
+    Result result = gradeExam(paper, answers, *user, hall->course, hall->examSeconds,
+                              session.seed);
+    vector<SessionAnswer> changes;
+    for (size_t q = 0; q < answers.size(); q++) {
+        if (answers[q] != saved[q]) changes.push_back(SessionAnswer((int)q, answers[q]));
+    }
+
+    ResultPaper resultPaper;
+    resultPaper.courseId = hall->course.id;
+    resultPaper.questionIds = session.questionIds;
+    resultPaper.answers = AnswerSheet::fromAnswers(answers);
+    resultPaper.seed = session.seed;
+
+    start = Clock::now();
+    int resultId = hall->submissions
+        ? hall->submissions->submit(result, resultPaper, session.id, changes)
+        : db.submitResult(result, resultPaper, session.id, changes);
+    stats->latenciesMs[OP_SUBMIT].push_back(elapsedMs(start));
+    stats->submittedAt = Clock::now();
+    if (resultId <= 0) {
+        stats->failures[OP_SUBMIT]++;
+    }
+    delete user;
+}
+
+static double percentile(const vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    return sorted[(size_t)(p * (sorted.size() - 1))];
+}
+
+int main(int argc, char** argv) {
+    int candidates = argc > 1 ? atoi(argv[1]) : 200;
+    int questionCount = argc > 2 ? atoi(argv[2]) : 100000;
+    int resultCount = argc > 3 ? atoi(argv[3]) : 100000;
+    int examSeconds = argc > 4 ? atoi(argv[4]) : 30;
+    string path = argc > 5 ? argv[5] : "bench_examhall.db";
+    string preset = argc > 6 ? argv[6] : "exam-hall";
+    string paperMode = argc > 7 ? argv[7] : "draw";
+    string submitMode = argc > 8 ? argv[8] : "direct";
+    if (paperMode != "draw" && paperMode != "pregen") {
+        fprintf(stderr, "Unknown paper mode: %s (draw or pregen)\n", paperMode.c_str());
+        return 1;
+    }
+    if (submitMode != "direct" && submitMode != "group") {
+        fprintf(stderr, "Unknown submit mode: %s (direct or group)\n", submitMode.c_str());
+        return 1;
+    }
+
+    Hall hall;
+    hall.path = path;
+    hall.examSeconds = examSeconds;
+    hall.submissions = NULL;
+    if (!StorageProfile::byName(preset, hall.profile)) {
+        fprintf(stderr, "Unknown storage preset: %s\n", preset.c_str());
+        return 1;
+    }
+
+    printf("Seeding %d questions, %d past results, %d candidates...\n",
+           questionCount, resultCount, candidates);
+    removeDatabase(path);
+    SeedSpec spec;
+    spec.questionsPerCourse = questionCount / spec.courses;
+    spec.users = candidates;
+    spec.results = resultCount;
+    {
+        DatabaseManager db(path, StorageProfile::bulkImport());
+        if (!db.isReady() || !seedDatabase(&db, spec)) {
+            fprintf(stderr, "Seeding failed: %s\n", db.getLastError().c_str());
+            return 1;
+        }
+    }
+    {
+        DatabaseManager db(path, hall.profile);
+        Course* course = db.getCourseById(db.getCourseIdByCode(seedCourseCode(spec, 0)));
+        if (!course) {
+            fprintf(stderr, "Seeded course missing\n");
+            return 1;
+        }
+        hall.course = *course;
+        delete course;
+        
+        if (paperMode == "pregen") {
+            vector<int> userIds;
+            for (int i = 0; i < candidates; i++) {
+                userIds.push_back(db.getUserIdByUsername(seedUsername(i)));
+            }
+            PregenStats pregen;
+            if (!pregeneratePapers(&db, hall.course.id, userIds, &pregen)) {
+                fprintf(stderr, "Pre-generation failed: %s\n", db.getLastError().c_str());
+                return 1;
+            }
+            printf("Pre-generated %d papers in %.1f ms on %d thread(s)\n", pregen.papers,
+                   pregen.seconds * 1000, pregen.threads);
+        }
+    }
+
+    if (submitMode == "group") {
+        hall.submissions = new SubmissionQueue(path, hall.profile);
+        if (!hall.submissions->isReady()) {
+            fprintf(stderr, "%s\n", hall.submissions->getLastError().c_str());
+            return 1;
+        }
+    }
+
+    printf("%d candidates, %d s exam, autosave every %d s, %s profile, %s papers, "
+           "%s submits\n\n", candidates, examSeconds, AUTOSAVE_SECONDS,
+           hall.profile.name.c_str(), paperMode.c_str(), submitMode.c_str());
+
+    // Give every thread time to open its connection before the doors open
+    hall.opens = Clock::now() + chrono::seconds(1);
+    hall.deadline = hall.opens + chrono::seconds(examSeconds);
+
+    vector<CandidateStats> stats(candidates);
+    vector<thread> threads;
+    for (int i = 0; i < candidates; i++) {
+        threads.push_back(thread(candidate, &hall, i, &stats[i]));
+    }
+    for (size_t i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+    double wallSeconds = elapsedMs(hall.opens) / 1000.0;
+
+    printf("%-10s %8s %6s %9s %9s %9s %9s\n",
+           "operation", "count", "fail", "p50 ms", "p99 ms", "p999 ms", "max ms");
+    long totalOps = 0;
+    for (int op = 0; op < OP_COUNT; op++) {
+        vector<double> all;
+        long failures = 0;
+        for (int i = 0; i < candidates; i++) {
+            all.insert(all.end(), stats[i].latenciesMs[op].begin(), stats[i].latenciesMs[op].end());
+            failures += stats[i].failures[op];
+        }
+        sort(all.begin(), all.end());
+        totalOps += (long)all.size();
+        printf("%-10s %8ld %6ld %9.2f %9.2f %9.2f %9.2f\n", operationNames[op],
+               (long)all.size(), failures, percentile(all, 0.50), percentile(all, 0.99),
+               percentile(all, 0.999), all.empty() ? 0 : all.back());
+    }
+
+    // How long after time-up the last candidate's result was safely stored
+    double stormMs = 0;
+    for (int i = 0; i < candidates; i++) {
+        if (stats[i].latenciesMs[OP_SUBMIT].empty()) continue;
+        chrono::duration<double, milli> d = stats[i].submittedAt - hall.deadline;
+        stormMs = max(stormMs, d.count());
+    }
+
+    printf("\nThroughput: %ld operations in %.1f s (%.0f ops/s)\n",
+           totalOps, wallSeconds, totalOps / wallSeconds);
+    printf("Time-up storm: all results stored %.1f ms after the deadline\n", stormMs);
+    if (hall.submissions) {
+        SubmissionStats grouped = hall.submissions->getStats();
+        printf("Group commit: %d submissions in %d transactions (largest %d, %d retried alone)\n",
+               grouped.submissions, grouped.groups, grouped.largestGroup, grouped.retried);
+        delete hall.submissions;
+    }
+
+#ifdef EXAM_QUERY_STATS
+    // Includes the seeding calls made before the hall opened
+    printf("\nPer-query latency, all connections:\n%s", formatQueryStats().c_str());
+#endif
+
+    removeDatabase(path);
+    return 0;
+}
@@ -0,0 +1,114 @@
+// Benchmark: grading throughput of the packed answer kernel against the
+// per-question string comparison it replaced, with equal and with mixed
+// question points. Every packed score is checked against the string one.
+//
+// Usage: bench_grading [papers] [questions-per-paper]
+
+#include "AnswerSheet.h"
+#include "Question.h"
+#include <chrono>
+#include <random>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace std;
+
+static double elapsedMs(chrono::steady_clock::time_point start) {
+    chrono::duration<double, milli> d = chrono::steady_clock::now() - start;
+    return d.count();
+}
+
+// How gradeExam scored papers before the packed kernel
+static int gradeStrings(const vector<Question>& questions, const vector<string>& answers) {
+    int score = 0;
+    for (size_t i = 0; i < questions.size(); i++) {
+        if (i < answers.size() && answers[i] == questions[i].correctAnswer) {
+            score += questions[i].points;
+        }
+    }
+    return score;
+}
+
+static void run(const char* label, const vector<Question>& paper,
+                const vector<vector<string> >& answers) {
+    int papers = (int)answers.size();
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    long long stringTotal = 0;
+    vector<int> expected(papers);
+    for (int p = 0; p < papers; p++) {
+        expected[p] = gradeStrings(paper, answers[p]);
+        stringTotal += expected[p];
+    }
+    double stringMs = elapsedMs(start);
+
+    // Sheets are packed once, as they would be stored; the key once per paper
+    vector<AnswerSheet> sheets;
+    sheets.reserve(papers);
+    start = chrono::steady_clock::now();
+    for (int p = 0; p < papers; p++) {
+        sheets.push_back(AnswerSheet::fromAnswers(answers[p]));
+    }
+    double packMs = elapsedMs(start);
+
+    start = chrono::steady_clock::now();
+    AnswerKey key(paper);
+    long long packedTotal = 0;
+    int mismatches = 0;
+    vector<int> scores(papers);
+    for (int p = 0; p < papers; p++) {
+        scores[p] = scoreSheet(key, sheets[p]);
+    }
+    double packedMs = elapsedMs(start);
+    for (int p = 0; p < papers; p++) {
+        packedTotal += scores[p];
+        if (scores[p] != expected[p]) mismatches++;
+    }
+
+    printf("%-16s %14.0f %14.0f %9.1fx %12.0f %6d\n", label,
+           papers / (stringMs / 1000.0), papers / (packedMs / 1000.0),
+           packedMs > 0 ? stringMs / packedMs : 0, papers / (packMs / 1000.0), mismatches);
+    if (stringTotal != packedTotal) {
+        printf("  total score differs: %lld vs %lld\n", stringTotal, packedTotal);
+    }
+}
+
+int main(int argc, char** argv) {
+    int papers = argc > 1 ? atoi(argv[1]) : 200000;
+    int questionCount = argc > 2 ? atoi(argv[2]) : 100;
+
+    mt19937 rng(42);
+    uniform_int_distribution<int> option(0, 4);   // 4 = left blank
+
+    vector<Question> paper(questionCount);
+    for (int i = 0; i < questionCount; i++) {
+        paper[i].correctAnswer = string(1, (char)('A' + option(rng) % 4));
+        paper[i].points = 1;
+    }
+
+    vector<vector<string> > answers(papers, vector<string>(questionCount));
+    for (int p = 0; p < papers; p++) {
+        for (int i = 0; i < questionCount; i++) {
+            int choice = option(rng);
+            // Roughly 60% correct, the rest spread over other options and blanks
+            if (choice < 3 && option(rng) < 3) {
+                answers[p][i] = paper[i].correctAnswer;
+            } else if (choice < 4) {
+                answers[p][i] = string(1, (char)('A' + choice));
+            }
+        }
+    }
+
+    printf("%d papers of %d questions\n\n", papers, questionCount);
+    printf("%-16s %14s %14s %10s %12s %6s\n",
+           "points", "string/s", "packed/s", "speedup", "packing/s", "diff");
+
+    run("equal", paper, answers);
+
+    for (int i = 0; i < questionCount; i++) {
+        paper[i].points = 1 + i % 3;
+    }
+    run("mixed", paper, answers);
+
+    return 0;
+}
@@ -0,0 +1,225 @@
+// Benchmark: an exam hall served by one HallServer. The server runs in this
+// process on a Unix socket; each candidate is a thread with its own
+// HallClient connection, as each terminal would be:
+//
+//   login     everyone at once
+//   paper     start a paper through the server
+//   save      one changed answer per save, back to back for the whole run,
+//             so the server's answer-save capacity is what gets measured
+//   submit    everyone at the same moment (time-up), graded by the server
+//
+// Reports p50/p99 latency per operation, saves per second and how long the
+// time-up storm took to be stored.
+//
+// Usage: bench_hallserver [candidates] [seconds] [workers] [database-path]
+//                         [storage-preset]
+
+#include "HallServer.h"
+#include "HallClient.h"
+#include "DatabaseSeeder.h"
+#include <thread>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+enum Operation { OP_LOGIN, OP_PAPER, OP_SAVE, OP_SUBMIT, OP_COUNT };
+static const char* operationNames[OP_COUNT] = { "login", "paper", "save", "submit" };
+
+struct CandidateStats {
+    vector<double> latenciesMs[OP_COUNT];
+    long failures[OP_COUNT];
+    Clock::time_point submittedAt;
+
+    CandidateStats() {
+        for (int op = 0; op < OP_COUNT; op++) failures[op] = 0;
+    }
+};
+
+// Everything the candidates share; read-only once the hall opens
+struct Hall {
+    string socketPath;
+    int courseId;
+    Clock::time_point opens;
+    Clock::time_point deadline;
+};
+
+static void removeDatabase(const string& path) {
+    remove(path.c_str());
+    remove((path + "-wal").c_str());
+    remove((path + "-shm").c_str());
+    remove((path + "-journal").c_str());
+}
+
+static double elapsedMs(Clock::time_point start) {
+    chrono::duration<double, milli> d = Clock::now() - start;
+    return d.count();
+}
+
+static void runServer(HallServer* server) {
+    server->run();
+}
+
+static void candidate(const Hall* hall, int index, CandidateStats* stats) {
+    HallClient client;
+    if (!client.connect(hall->socketPath)) {
+        stats->failures[OP_LOGIN]++;
+        return;
+    }
+    mt19937 rng(index * 7919 + 17);
+    this_thread::sleep_until(hall->opens);
+
+    Clock::time_point start = Clock::now();
+    User* user = client.login(seedUsername(index), SEED_PASSWORD);
+    stats->latenciesMs[OP_LOGIN].push_back(elapsedMs(start));
+    if (!user) {
+        stats->failures[OP_LOGIN]++;
+        return;
+    }
+    delete user;
+
+    start = Clock::now();
+    vector<Question> paper;
+    ExamSession session;
+    PaperSource source = client.startPaper(hall->courseId, Seat(), paper, session);
+    stats->latenciesMs[OP_PAPER].push_back(elapsedMs(start));
+    if (source == PAPER_NONE) {
+        stats->failures[OP_PAPER]++;
+        return;
+    }
+
+    vector<string> answers = session.answers;
+    uniform_int_distribution<int> anyQuestion(0, (int)paper.size() - 1);
+    uniform_int_distribution<int> anyOption(0, 3);
+    while (Clock::now() < hall->deadline) {
+        int q = anyQuestion(rng);
+        answers[q] = string(1, "ABCD"[anyOption(rng)]);
+        vector<SessionAnswer> changes(1, SessionAnswer(q, answers[q]));
+        int timeSpent = (int)chrono::duration_cast<chrono::seconds>(Clock::now() - hall->opens).count();
+
+        start = Clock::now();
+        bool ok = client.saveSessionProgress(session.id, hall->courseId, changes, q,
+                                             session.timeRemaining - timeSpent, timeSpent);
+        stats->latenciesMs[OP_SAVE].push_back(elapsedMs(start));
+        if (!ok) {
+            stats->failures[OP_SAVE]++;
+        }
+    }
+
+    // Time up: the whole hall submits at once
+    this_thread::sleep_until(hall->deadline + chrono::milliseconds(100));
+    Result result;
+    int timeSpent = (int)chrono::duration_cast<chrono::seconds>(hall->deadline - hall->opens).count();
+    start = Clock::now();
+    int resultId = client.submitResult(session.id, hall->courseId, answers,
+                                       vector<SessionAnswer>(), timeSpent, result);
+    stats->latenciesMs[OP_SUBMIT].push_back(elapsedMs(start));
+    stats->submittedAt = Clock::now();
+    if (resultId <= 0) {
+        stats->failures[OP_SUBMIT]++;
+    }
+}
+
+static double percentile(const vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    return sorted[(size_t)(p * (sorted.size() - 1))];
+}
+
+int main(int argc, char** argv) {
+    int candidates = argc > 1 ? atoi(argv[1]) : 200;
+    int seconds = argc > 2 ? atoi(argv[2]) : 10;
+    int workers = argc > 3 ? atoi(argv[3]) : 0;
+    string path = argc > 4 ? argv[4] : "bench_hallserver.db";
+    string preset = argc > 5 ? argv[5] : "exam-hall";
+    StorageProfile profile;
+    if (!StorageProfile::byName(preset, profile)) {
+        fprintf(stderr, "Unknown storage preset: %s\n", preset.c_str());
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    printf("Seeding %d candidates...\n", candidates);
+    removeDatabase(path);
+    SeedSpec spec;
+    spec.users = candidates;
+    Hall hall;
+    {
+        DatabaseManager db(path, StorageProfile::bulkImport());
+        if (!db.isReady() || !seedDatabase(&db, spec)) {
+            fprintf(stderr, "Seeding failed: %s\n", db.getLastError().c_str());
+            return 1;
+        }
+        hall.courseId = db.getCourseIdByCode(seedCourseCode(spec, 0));
+    }
+
+    char socketPath[64];
+    sprintf(socketPath, "/tmp/bench_hallserver.%d.sock", (int)getpid());
+    hall.socketPath = socketPath;
+    HallServer* server = new HallServer(path, profile, workers);
+    if (!server->isReady() || !server->listenUnix(hall.socketPath)) {
+        fprintf(stderr, "%s\n", server->getLastError().c_str());
+        return 1;
+    }
+    thread serving(runServer, server);
+
+    printf("%d candidates, %d s of answer saves, %s profile\n\n", candidates, seconds,
+           profile.name.c_str());
+
+    // Give every thread time to connect before the doors open
+    hall.opens = Clock::now() + chrono::seconds(1);
+    hall.deadline = hall.opens + chrono::seconds(seconds);
+
+    vector<CandidateStats> stats(candidates);
+    vector<thread> threads;
+    for (int i = 0; i < candidates; i++) {
+        threads.push_back(thread(candidate, &hall, i, &stats[i]));
+    }
+    for (size_t i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+
+    printf("%-10s %8s %6s %9s %9s %9s\n", "operation", "count", "fail", "p50 ms", "p99 ms",
+           "max ms");
+    long saves = 0;
+    for (int op = 0; op < OP_COUNT; op++) {
+        vector<double> all;
+        long failures = 0;
+        for (int i = 0; i < candidates; i++) {
+            all.insert(all.end(), stats[i].latenciesMs[op].begin(), stats[i].latenciesMs[op].end());
+            failures += stats[i].failures[op];
+        }
+        sort(all.begin(), all.end());
+        if (op == OP_SAVE) saves = (long)all.size() - failures;
+        printf("%-10s %8ld %6ld %9.2f %9.2f %9.2f\n", operationNames[op], (long)all.size(),
+               failures, percentile(all, 0.50), percentile(all, 0.99),
+               all.empty() ? 0 : all.back());
+    }
+
+    double stormMs = 0;
+    for (int i = 0; i < candidates; i++) {
+        if (stats[i].latenciesMs[OP_SUBMIT].empty()) continue;
+        chrono::duration<double, milli> d = stats[i].submittedAt - hall.deadline;
+        stormMs = max(stormMs, d.count() - 100);
+    }
+
+    printf("\nAnswer saves: %ld in %d s (%.0f saves/s)\n", saves, seconds,
+           seconds > 0 ? (double)saves / seconds : 0.0);
+    printf("Time-up storm: all results stored %.1f ms after the deadline\n", stormMs);
+
+    server->stop();
+    serving.join();
+    HallServerStats served = server->getStats();
+    printf("Server: %lld terminals, %lld requests, %lld refused\n", served.connections,
+           served.requests, served.errors);
+    delete server;
+
+    removeDatabase(path);
+    return 0;
+}
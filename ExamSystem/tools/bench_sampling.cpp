@@ -0,0 +1,182 @@
+// Benchmark: random paper draw via the sampling engine vs ORDER BY RANDOM(),
+// a blueprint draw of the same length over the seeder's topics and
+// difficulties, and how evenly uniform and balanced draws spread exposure
+// over a pool.
+//
+// Usage: bench_sampling [draws-per-size] [questions-per-paper] [database-path]
+
+#include "DatabaseManager.h"
+#include "DatabaseSeeder.h"
+#include <sqlite3.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+
+using namespace std;
+
+static double elapsedMs(chrono::steady_clock::time_point start) {
+    chrono::duration<double, milli> d = chrono::steady_clock::now() - start;
+    return d.count();
+}
+
+// The query getRandomQuestions used before the sampling engine
+static double legacyDraws(const string& path, int courseId, int count, int draws) {
+    sqlite3* raw;
+    sqlite3_open(path.c_str(), &raw);
+    sqlite3_stmt* stmt;
+    sqlite3_prepare_v2(raw, "SELECT * FROM questions WHERE course_id = ? ORDER BY RANDOM() LIMIT ?",
+                       -1, &stmt, 0);
+    
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int d = 0; d < draws; d++) {
+        sqlite3_bind_int(stmt, 1, courseId);
+        sqlite3_bind_int(stmt, 2, count);
+        int rows = 0;
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            Question q;
+            q.id = sqlite3_column_int(stmt, 0);
+            q.questionText = string((char*)sqlite3_column_text(stmt, 2));
+            q.optionA = string((char*)sqlite3_column_text(stmt, 3));
+            q.optionB = string((char*)sqlite3_column_text(stmt, 4));
+            q.optionC = string((char*)sqlite3_column_text(stmt, 5));
+            q.optionD = string((char*)sqlite3_column_text(stmt, 6));
+            q.correctAnswer = string((char*)sqlite3_column_text(stmt, 7));
+            rows++;
+        }
+        sqlite3_reset(stmt);
+        if (rows != count) fprintf(stderr, "legacy draw returned %d rows\n", rows);
+    }
+    double ms = elapsedMs(start);
+    
+    sqlite3_finalize(stmt);
+    sqlite3_close(raw);
+    return ms;
+}
+
+// Draws papers through one selection mode and prints how often the most and
+// least shown questions came up
+static void exposureRun(DatabaseManager& db, int courseId, int poolSize, int count, int draws,
+                        SelectionMode mode) {
+    vector<int> shown(poolSize, 0);
+    int firstId = 0;
+    vector<Question> key = db.getCourseAnswerKey(courseId);
+    for (size_t i = 0; i < key.size(); i++) {
+        if (i == 0 || key[i].id < firstId) firstId = key[i].id;
+    }
+    
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int d = 0; d < draws; d++) {
+        vector<int> ids = db.sampleQuestionIds(courseId, count, mode);
+        for (size_t i = 0; i < ids.size(); i++) {
+            shown[ids[i] - firstId]++;
+        }
+    }
+    double ms = elapsedMs(start);
+    
+    int least = shown[0], most = shown[0];
+    double mean = (double)draws * count / poolSize, variance = 0;
+    for (int i = 0; i < poolSize; i++) {
+        if (shown[i] < least) least = shown[i];
+        if (shown[i] > most) most = shown[i];
+        variance += (shown[i] - mean) * (shown[i] - mean);
+    }
+    printf("%10s %12.3f %8d %8.1f %8d %10.2f\n",
+           mode == SELECT_BALANCED ? "balanced" : "uniform", ms / draws, least, mean, most,
+           sqrt(variance / poolSize));
+}
+
+int main(int argc, char** argv) {
+    int draws = argc > 1 ? atoi(argv[1]) : 200;
+    int count = argc > 2 ? atoi(argv[2]) : 40;
+    string path = argc > 3 ? argv[3] : "bench_sampling.db";
+    
+    const int poolSizes[] = { 1000, 10000, 50000, 100000 };
+    
+    printf("%d draws of %d questions per pool size\n\n", draws, count);
+    // A quarter of the paper from each of three topic/difficulty strata,
+    // the rest from a fourth topic at any difficulty
+    Blueprint blueprint;
+    blueprint.rows.push_back(BlueprintRow("topic1", DIFFICULTY_EASY, count / 4));
+    blueprint.rows.push_back(BlueprintRow("topic2", DIFFICULTY_MEDIUM, count / 4));
+    blueprint.rows.push_back(BlueprintRow("topic3", DIFFICULTY_HARD, count / 4));
+    blueprint.rows.push_back(BlueprintRow("topic4", DIFFICULTY_NONE, count - 3 * (count / 4)));
+    
+    printf("%10s %16s %16s %16s %16s %10s\n", "pool", "ORDER BY RANDOM", "sampler", "balanced",
+           "blueprint", "speedup");
+    printf("%10s %16s %16s %16s %16s %10s\n", "", "(ms/draw)", "(ms/draw)", "(ms/draw)",
+           "(ms/draw)", "");
+    
+    for (size_t s = 0; s < sizeof(poolSizes) / sizeof(poolSizes[0]); s++) {
+        remove(path.c_str());
+        DatabaseManager db(path);
+        if (!db.isReady()) {
+            fprintf(stderr, "%s\n", db.getLastError().c_str());
+            return 1;
+        }
+        SeedSpec spec;
+        spec.courses = 1;
+        spec.questionsPerCourse = poolSizes[s];
+        spec.users = 0;
+        spec.results = 0;
+        seedDatabase(&db, spec);
+        int courseId = db.getCourseIdByCode(seedCourseCode(spec, 0));
+        
+        double legacyMs = legacyDraws(path, courseId, count, draws);
+        
+        // First draw loads the course pool; include it in the timing
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        for (int d = 0; d < draws; d++) {
+            vector<Question> paper = db.getRandomQuestions(courseId, count);
+            if ((int)paper.size() != count) {
+                fprintf(stderr, "sampler draw returned %d rows\n", (int)paper.size());
+            }
+        }
+        double samplerMs = elapsedMs(start);
+        
+        start = chrono::steady_clock::now();
+        for (int d = 0; d < draws; d++) {
+            vector<Question> paper = db.getRandomQuestions(courseId, count, SELECT_BALANCED);
+            if ((int)paper.size() != count) {
+                fprintf(stderr, "balanced draw returned %d rows\n", (int)paper.size());
+            }
+        }
+        double balancedMs = elapsedMs(start);
+        
+        start = chrono::steady_clock::now();
+        for (int d = 0; d < draws; d++) {
+            vector<Question> paper;
+            if (!db.getBlueprintQuestions(courseId, blueprint, paper)) {
+                fprintf(stderr, "blueprint draw returned %d rows\n", (int)paper.size());
+            }
+        }
+        double blueprintMs = elapsedMs(start);
+        
+        printf("%10d %16.3f %16.3f %16.3f %16.3f %9.1fx\n", poolSizes[s], legacyMs / draws,
+               samplerMs / draws, balancedMs / draws, blueprintMs / draws,
+               legacyMs / samplerMs);
+    }
+    
+    // Exposure spread: enough draws that every question is due ~50 showings
+    const int exposurePool = 2000;
+    int exposureDraws = exposurePool * 50 / (count > 0 ? count : 1);
+    printf("\nTimes each of %d questions was shown over %d draws\n\n", exposurePool,
+           exposureDraws);
+    printf("%10s %12s %8s %8s %8s %10s\n", "mode", "ms/draw", "min", "mean", "max", "stddev");
+    for (int m = 0; m < 2; m++) {
+        remove(path.c_str());
+        DatabaseManager db(path);
+        SeedSpec spec;
+        spec.courses = 1;
+        spec.questionsPerCourse = exposurePool;
+        spec.users = 0;
+        spec.results = 0;
+        seedDatabase(&db, spec);
+        int courseId = db.getCourseIdByCode(seedCourseCode(spec, 0));
+        exposureRun(db, courseId, exposurePool, count, exposureDraws,
+                    m == 0 ? SELECT_UNIFORM : SELECT_BALANCED);
+    }
+    
+    remove(path.c_str());
+    return 0;
+}
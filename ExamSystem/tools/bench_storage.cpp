@@ -0,0 +1,170 @@
+// Benchmark: concurrent admin reads and candidate result writes under each
+// storage profile preset.
+//
+// Usage: bench_storage [seconds-per-preset] [writers] [readers] [database-path]
+
+#include "DatabaseManager.h"
+#include "DatabaseSeeder.h"
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace std;
+
+struct WorkerStats {
+    long operations;
+    long failures;
+    vector<double> latenciesMs;
+    
+    WorkerStats() : operations(0), failures(0) {}
+};
+
+static void removeDatabase(const string& path) {
+    remove(path.c_str());
+    remove((path + "-wal").c_str());
+    remove((path + "-shm").c_str());
+    remove((path + "-journal").c_str());
+}
+
+static void writer(const string& path, StorageProfile profile, int courseId, int userId,
+                   atomic<bool>* stop, WorkerStats* stats) {
+    DatabaseManager db(path, profile);
+    if (!db.isReady()) {
+        fprintf(stderr, "writer: %s\n", db.getLastError().c_str());
+        return;
+    }
+    Result r;
+    r.userId = userId;
+    r.username = "bench";
+    r.courseId = courseId;
+    r.courseCode = "BENCH";
+    r.courseTitle = "Storage Benchmark";
+    r.totalQuestions = 40;
+    r.totalPoints = 40;
+    
+    while (!stop->load()) {
+        r.score = rand() % 41;
+        r.percentage = r.score * 2.5;
+        r.passed = r.percentage >= 40;
+        
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        int id = db.saveResult(r);
+        chrono::duration<double, milli> d = chrono::steady_clock::now() - start;
+        
+        stats->latenciesMs.push_back(d.count());
+        if (id > 0) stats->operations++;
+        else stats->failures++;
+    }
+}
+
+static bool countRow(const Result& result, void* data) {
+    (*(long*)data)++;
+    return true;
+}
+
+static void reader(const string& path, StorageProfile profile,
+                   atomic<bool>* stop, WorkerStats* stats) {
+    DatabaseManager db(path, profile);
+    if (!db.isReady()) {
+        fprintf(stderr, "reader: %s\n", db.getLastError().c_str());
+        return;
+    }
+    while (!stop->load()) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        // The admin results tab: first page of the listing, newest first
+        ResultQuery query;
+        query.pageSize = 200;
+        long rows = 0;
+        db.streamResults(query, countRow, &rows);
+        chrono::duration<double, milli> d = chrono::steady_clock::now() - start;
+        
+        stats->latenciesMs.push_back(d.count());
+        if (rows > 0) stats->operations++;
+        else stats->failures++;
+    }
+}
+
+static double percentile(vector<double>& values, double p) {
+    if (values.empty()) return 0;
+    sort(values.begin(), values.end());
+    size_t idx = (size_t)(p * (values.size() - 1));
+    return values[idx];
+}
+
+int main(int argc, char** argv) {
+    int seconds = argc > 1 ? atoi(argv[1]) : 3;
+    int writers = argc > 2 ? atoi(argv[2]) : 4;
+    int readers = argc > 3 ? atoi(argv[3]) : 2;
+    string path = argc > 4 ? argv[4] : "bench_storage.db";
+    
+    const char* presets[] = { "exam-hall", "bulk-import", "durable" };
+    
+    printf("%d writer(s), %d reader(s), %d s per preset, 2000 seeded results\n\n",
+           writers, readers, seconds);
+    printf("%-12s %10s %12s %10s %10s %12s\n",
+           "preset", "writes/s", "write p99ms", "busy", "reads/s", "read p99ms");
+    
+    for (size_t p = 0; p < sizeof(presets) / sizeof(presets[0]); p++) {
+        StorageProfile profile;
+        StorageProfile::byName(presets[p], profile);
+        
+        removeDatabase(path);
+        int courseId;
+        {
+            DatabaseManager db(path, profile);
+            if (!db.isReady()) {
+                fprintf(stderr, "%s\n", db.getLastError().c_str());
+                return 1;
+            }
+            SeedSpec spec;
+            spec.courses = 1;
+            spec.questionsPerCourse = 40;
+            spec.users = 500;
+            spec.results = 2000;
+            seedDatabase(&db, spec);
+            courseId = db.getCourseIdByCode(seedCourseCode(spec, 0));
+        }
+        
+        atomic<bool> stop(false);
+        vector<WorkerStats> writeStats(writers);
+        vector<WorkerStats> readStats(readers);
+        vector<thread> threads;
+        
+        for (int i = 0; i < writers; i++) {
+            threads.push_back(thread(writer, path, profile, courseId, i + 1, &stop, &writeStats[i]));
+        }
+        for (int i = 0; i < readers; i++) {
+            threads.push_back(thread(reader, path, profile, &stop, &readStats[i]));
+        }
+        
+        this_thread::sleep_for(chrono::seconds(seconds));
+        stop.store(true);
+        for (size_t i = 0; i < threads.size(); i++) {
+            threads[i].join();
+        }
+        
+        long writesDone = 0, writesBusy = 0, readsDone = 0;
+        vector<double> writeLatency, readLatency;
+        for (int i = 0; i < writers; i++) {
+            writesDone += writeStats[i].operations;
+            writesBusy += writeStats[i].failures;
+            writeLatency.insert(writeLatency.end(), writeStats[i].latenciesMs.begin(),
+                                writeStats[i].latenciesMs.end());
+        }
+        for (int i = 0; i < readers; i++) {
+            readsDone += readStats[i].operations;
+            readLatency.insert(readLatency.end(), readStats[i].latenciesMs.begin(),
+                               readStats[i].latenciesMs.end());
+        }
+        
+        printf("%-12s %10.0f %12.2f %10ld %10.1f %12.2f\n", presets[p],
+               (double)writesDone / seconds, percentile(writeLatency, 0.99), writesBusy,
+               (double)readsDone / seconds, percentile(readLatency, 0.99));
+    }
+    
+    removeDatabase(path);
+    return 0;
+}
@@ -0,0 +1,229 @@
+// Crash recovery check for exam autosave: seeds a database with many
+// sittings, then forks a candidate process that opens an exam, autosaves a
+// few rounds of answers and is killed with SIGKILL halfway through the next
+// save. The parent then runs the same recovery path as ExamWindow and checks
+// that exactly the committed state comes back, and how long it took.
+// Exits non-zero on any mismatch.
+//
+// Usage: exam_crashcheck [seeded-sessions] [rounds] [database-path]
+
+#include "DatabaseManager.h"
+#include "PaperGenerator.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+static const int CANDIDATE_ID = 999999;
+static const int PAPER_SIZE = 40;
+static const int EXAM_SECONDS = 3600;
+static const char* OPTIONS = "ABCD";
+
+static void removeDatabase(const string& path) {
+    remove(path.c_str());
+    remove((path + "-wal").c_str());
+    remove((path + "-shm").c_str());
+}
+
+static void seed(DatabaseManager& db, int sessionCount) {
+    db.addCourse("CRASH1", "Crash Recovery Course", 60, PAPER_SIZE, 40);
+    int courseId = db.getCourseIdByCode("CRASH1");
+
+    vector<Question> questions;
+    for (int i = 0; i < 500; i++) {
+        Question q;
+        q.courseId = courseId;
+        q.questionText = "Seeded question";
+        q.optionA = "A";
+        q.optionB = "B";
+        q.optionC = "C";
+        q.optionD = "D";
+        q.correctAnswer = "A";
+        questions.push_back(q);
+    }
+    db.addQuestions(questions);
+
+    // Other candidates' sittings, mostly finished, all with full answer sets
+    db.beginTransaction();
+    for (int i = 0; i < sessionCount; i++) {
+        ExamSession session;
+        session.userId = 1 + i;
+        session.courseId = courseId;
+        for (int q = 0; q < PAPER_SIZE; q++) {
+            session.questionIds.push_back(1 + (i + q) % 500);
+        }
+        session.timeRemaining = EXAM_SECONDS;
+        db.openExamSession(session);
+
+        vector<SessionAnswer> answers;
+        for (int q = 0; q < PAPER_SIZE; q++) {
+            answers.push_back(SessionAnswer(q, string(1, OPTIONS[(i + q) % 4])));
+        }
+        db.saveSessionProgress(session.id, answers, PAPER_SIZE - 1, 0, EXAM_SECONDS);
+        if (i % 10 != 0) {
+            db.closeExamSession(session.id);
+        }
+
+        if (i % 5000 == 4999) {
+            db.commitTransaction();
+            db.beginTransaction();
+        }
+    }
+    db.commitTransaction();
+}
+
+// The state after autosave round r (1-based), applied on top of round r-1
+static SessionAnswer roundAnswer(int round) {
+    return SessionAnswer((round * 7) % PAPER_SIZE, string(1, OPTIONS[round % 4]));
+}
+
+static void expectedState(int rounds, ExamSession& expected) {
+    expected.answers.assign(PAPER_SIZE, "");
+    for (int r = 1; r <= rounds; r++) {
+        SessionAnswer a = roundAnswer(r);
+        expected.answers[a.position] = a.answer;
+    }
+    expected.currentIndex = rounds % PAPER_SIZE;
+    expected.timeSpent = rounds * 5;
+    expected.timeRemaining = EXAM_SECONDS - expected.timeSpent;
+}
+
+// Runs in the child: one candidate sitting, killed mid-save
+static void sitAndCrash(const string& path, int rounds, int reportFd) {
+    DatabaseManager db(path);
+    int courseId = db.getCourseIdByCode("CRASH1");
+
+    ExamSession session;
+    vector<Question> paper;
+    if (preparePaper(&db, CANDIDATE_ID, courseId, PAPER_SIZE, EXAM_SECONDS, paper,
+                     session) != PAPER_NEW || session.id == 0) {
+        _exit(2);
+    }
+
+    // Tell the parent which paper was drawn
+    int header[2] = { session.id, (int)session.questionIds.size() };
+    if (write(reportFd, header, sizeof(header)) != sizeof(header) ||
+        write(reportFd, &session.questionIds[0], sizeof(int) * session.questionIds.size()) < 0) {
+        _exit(2);
+    }
+    close(reportFd);
+
+    for (int r = 1; r <= rounds; r++) {
+        vector<SessionAnswer> changes;
+        changes.push_back(roundAnswer(r));
+        db.saveSessionProgress(session.id, changes, r % PAPER_SIZE,
+                               EXAM_SECONDS - r * 5, r * 5);
+    }
+
+    // The next save dies between its writes and its commit
+    db.beginTransaction();
+    vector<SessionAnswer> lost;
+    for (int q = 0; q < PAPER_SIZE; q++) {
+        lost.push_back(SessionAnswer(q, "X"));
+    }
+    db.saveSessionProgress(session.id, lost, PAPER_SIZE - 1, 1, EXAM_SECONDS - 1);
+    raise(SIGKILL);
+}
+
+int main(int argc, char** argv) {
+    int sessionCount = argc > 1 ? atoi(argv[1]) : 50000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 25;
+    string path = argc > 3 ? argv[3] : "exam_crashcheck.db";
+
+    removeDatabase(path);
+    {
+        DatabaseManager db(path);
+        if (!db.isReady()) {
+            fprintf(stderr, "%s\n", db.getLastError().c_str());
+            return 1;
+        }
+        printf("Seeding %d sittings...\n", sessionCount);
+        seed(db, sessionCount);
+    }
+
+    int pipeFds[2];
+    if (pipe(pipeFds) != 0) {
+        perror("pipe");
+        return 1;
+    }
+
+    pid_t child = fork();
+    if (child == 0) {
+        close(pipeFds[0]);
+        sitAndCrash(path, rounds, pipeFds[1]);
+        _exit(3);
+    }
+    close(pipeFds[1]);
+
+    ExamSession expected;
+    int header[2] = { 0, 0 };
+    bool reported = read(pipeFds[0], header, sizeof(header)) == sizeof(header);
+    if (reported) {
+        expected.id = header[0];
+        expected.questionIds.resize(header[1]);
+        reported = header[1] > 0 &&
+                   read(pipeFds[0], &expected.questionIds[0], sizeof(int) * header[1]) ==
+                   (ssize_t)(sizeof(int) * header[1]);
+    }
+    close(pipeFds[0]);
+
+    int status = 0;
+    waitpid(child, &status, 0);
+    if (!reported || !WIFSIGNALED(status) || WTERMSIG(status) != SIGKILL) {
+        fprintf(stderr, "Candidate process did not reach the crash point\n");
+        return 1;
+    }
+    printf("Candidate killed after %d autosaves\n", rounds);
+    expectedState(rounds, expected);
+
+    // The candidate logs back in: the same call ExamWindow makes, on a fresh connection
+    DatabaseManager db(path);
+    int courseId = db.getCourseIdByCode("CRASH1");
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    ExamSession resumed;
+    vector<Question> paper;
+    bool found = preparePaper(&db, CANDIDATE_ID, courseId, PAPER_SIZE, EXAM_SECONDS, paper,
+                              resumed) == PAPER_RESUMED;
+    chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+
+    int failures = 0;
+    if (!found || resumed.id != expected.id) {
+        printf("[FAIL] open session not found\n");
+        return 1;
+    }
+    if (resumed.questionIds != expected.questionIds || paper.size() != expected.questionIds.size()) {
+        printf("[FAIL] paper differs from the one drawn\n");
+        failures++;
+    }
+    for (int q = 0; q < PAPER_SIZE; q++) {
+        if (resumed.answers[q] != expected.answers[q]) {
+            printf("[FAIL] answer %d: got '%s', expected '%s'\n", q + 1,
+                   resumed.answers[q].c_str(), expected.answers[q].c_str());
+            failures++;
+        }
+    }
+    if (resumed.currentIndex != expected.currentIndex ||
+        resumed.timeRemaining != expected.timeRemaining ||
+        resumed.timeSpent != expected.timeSpent) {
+        printf("[FAIL] position/clock: index %d time %d/%d, expected %d time %d/%d\n",
+               resumed.currentIndex, resumed.timeRemaining, resumed.timeSpent,
+               expected.currentIndex, expected.timeRemaining, expected.timeSpent);
+        failures++;
+    }
+
+    int answered = 0;
+    for (int q = 0; q < PAPER_SIZE; q++) {
+        if (!resumed.answers[q].empty()) answered++;
+    }
+    printf("Recovery read %d questions and %d saved answers in %.2f ms\n",
+           (int)paper.size(), answered, elapsed.count());
+    printf("%s\n", failures == 0 ? "[ OK ] resumed state matches the last committed autosave"
+                                 : "[FAIL] resumed state is wrong");
+
+    removeDatabase(path);
+    return failures == 0 ? 0 : 1;
+}
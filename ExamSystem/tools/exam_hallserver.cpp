@@ -0,0 +1,77 @@
+// Serves an exam hall from one process: the only program with the database
+// open, answering thin terminals started as
+//   exam_system --server <socket-path|host:port> [--seat <row>,<column>]
+// A number is a loopback TCP port, anything else a Unix socket path.
+// Stops on Ctrl-C (SIGINT) or SIGTERM.
+//
+// Usage: exam_hallserver <socket-path|port> [database-path] [workers] [storage-preset]
+//
+// Example:
+//   exam_hallserver /tmp/exam_hall.sock database/exam_system.db
+
+#include "HallServer.h"
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+
+using namespace std;
+
+static HallServer* running = NULL;
+
+static void stopServer(int) {
+    if (running) {
+        running->stop();
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <socket-path|port> [database-path] [workers] "
+                "[storage-preset]\n", argv[0]);
+        return 1;
+    }
+    string listenOn = argv[1];
+    string path = argc > 2 ? argv[2] : "database/exam_system.db";
+    int workers = argc > 3 ? atoi(argv[3]) : 0;
+    string preset = argc > 4 ? argv[4] : "exam-hall";
+    StorageProfile profile;
+    if (!StorageProfile::byName(preset, profile)) {
+        fprintf(stderr, "Unknown storage preset: %s\n", preset.c_str());
+        return 1;
+    }
+
+    bool isPort = !listenOn.empty();
+    for (size_t i = 0; i < listenOn.size(); i++) {
+        if (!isdigit((unsigned char)listenOn[i])) isPort = false;
+    }
+
+    HallServer server(path, profile, workers);
+    bool listening = server.isReady() &&
+        (isPort ? server.listenTcp(atoi(listenOn.c_str())) : server.listenUnix(listenOn));
+    if (!listening) {
+        fprintf(stderr, "%s\n", server.getLastError().c_str());
+        return 1;
+    }
+
+    running = &server;
+    signal(SIGINT, stopServer);
+    signal(SIGTERM, stopServer);
+    signal(SIGPIPE, SIG_IGN);
+
+    printf("Serving %s on %s%s (%s profile)\n", path.c_str(), isPort ? "127.0.0.1:" : "",
+           listenOn.c_str(), profile.name.c_str());
+    fflush(stdout);
+    bool ok = server.run();
+    running = NULL;
+
+    HallServerStats stats = server.getStats();
+    printf("\nTerminals: %lld\n", stats.connections);
+    printf("Requests:  %lld (%lld refused)\n", stats.requests, stats.errors);
+    printf("Saves:     %lld\n", stats.saves);
+    if (!ok) {
+        fprintf(stderr, "%s\n", server.getLastError().c_str());
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,51 @@
+// Headless question importer.
+//
+// Usage: exam_import <course-code> <questions-file> [database-path] [chunk-size]
+
+#include "DatabaseManager.h"
+#include "QuestionImporter.h"
+#include <cstdio>
+#include <cstdlib>
+
+using namespace std;
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <course-code> <questions-file> [database-path] [chunk-size]\n",
+                argv[0]);
+        return 1;
+    }
+    
+    string courseCode = argv[1];
+    string filename = argv[2];
+    string dbPath = argc > 3 ? argv[3] : "database/exam_system.db";
+    int chunkSize = argc > 4 ? atoi(argv[4]) : 1000;
+    
+    DatabaseManager db(dbPath, StorageProfile::bulkImport());
+    if (!db.isReady()) {
+        fprintf(stderr, "%s\n", db.getLastError().c_str());
+        return 1;
+    }
+    
+    int courseId = db.getCourseIdByCode(courseCode);
+    if (courseId <= 0) {
+        fprintf(stderr, "Unknown course code: %s\n", courseCode.c_str());
+        return 1;
+    }
+    
+    vector<Question> questions;
+    if (!parseQuestionFile(filename, courseId, questions)) {
+        fprintf(stderr, "Cannot open questions file: %s\n", filename.c_str());
+        return 1;
+    }
+    
+    ImportStats stats;
+    db.addQuestions(questions, &stats, chunkSize);
+    
+    printf("Parsed:   %d questions\n", (int)questions.size());
+    printf("Inserted: %d\n", stats.inserted);
+    printf("Failed:   %d\n", stats.failed);
+    printf("Time:     %.3f s (%.0f rows/sec)\n", stats.seconds, stats.rowsPerSecond);
+    
+    return stats.failed == 0 ? 0 : 2;
+}
@@ -0,0 +1,228 @@
+// Query plan check: seeds a large database, runs every DatabaseManager
+// query once, then prints EXPLAIN QUERY PLAN for each statement it
+// prepared. Exits non-zero if any query falls back to a full table scan.
+//
+// Usage: exam_queryplan [questions] [results] [database-path]
+
+#include "DatabaseManager.h"
+#include "StatementCache.h"
+#include "DatabaseSeeder.h"
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace std;
+
+static void removeDatabase(const string& path) {
+    remove(path.c_str());
+    remove((path + "-wal").c_str());
+    remove((path + "-shm").c_str());
+}
+
+static bool ignoreRow(const Result& result, void* data) {
+    return true;
+}
+
+// Calls every query-issuing public method so its statement gets cached
+static void exercise(DatabaseManager& db, const SeedSpec& spec) {
+    db.addUser("plan_user", "secret", "candidate");
+    delete db.authenticateUser("plan_user", "secret");
+    delete db.authenticateUser("plan_user", "wrong");
+    db.getUserIdByUsername("plan_user");
+    db.getUserIdsByRole("candidate");
+    db.incrementLoginAttempts("plan_user");
+    db.resetLoginAttempts("plan_user");
+    
+    db.addCourse("PLANX", "Extra", 60, 40, 40);
+    db.getAllCourses();
+    delete db.getCourseById(1);
+    int courseId = db.getCourseIdByCode(seedCourseCode(spec, 1));
+    
+    db.addQuestion(courseId, "q", "a", "b", "c", "d", "A", 1);
+    db.getRandomQuestions(courseId, 40);
+    
+    // Exposure control
+    db.setSelectionMode(courseId, SELECT_BALANCED);
+    db.getRandomQuestions(courseId, 40, SELECT_BALANCED);
+    db.getExposureStats(courseId);
+    db.setSelectionMode(courseId, SELECT_UNIFORM);
+    
+    // Blueprints and per-stratum draws
+    Blueprint blueprint;
+    string error;
+    Blueprint::parse("10 easy topic1, 10 hard topic2, 20 any", blueprint, error);
+    db.getStrata(courseId);
+    db.getQuestionStrata(courseId);
+    db.setBlueprint(courseId, blueprint);
+    db.getBlueprint(courseId);
+    vector<int> stratified;
+    db.sampleBlueprintIds(courseId, blueprint, stratified);
+    vector<Question> stratifiedPaper;
+    db.getBlueprintQuestions(courseId, blueprint, stratifiedPaper);
+    db.setBlueprint(courseId, Blueprint());
+    
+    // Papers drawn ahead of a sitting
+    AssignedPaper assigned;
+    assigned.userId = 1;
+    assigned.courseId = courseId;
+    assigned.questionIds = db.sampleQuestionIds(courseId, 40);
+    db.saveAssignedPapers(vector<AssignedPaper>(1, assigned));
+    db.countAssignedPapers(courseId);
+    db.findAssignedPaper(1, courseId, assigned);
+    db.deleteAssignedPaper(1, courseId);
+    
+    // Papers planned per seat of a hall
+    SeatPaper seatPaper;
+    seatPaper.courseId = courseId;
+    seatPaper.seat = Seat(1, 1);
+    seatPaper.questionIds = db.sampleQuestionIds(courseId, 40);
+    db.saveSeatPapers(courseId, vector<SeatPaper>(1, seatPaper));
+    db.countSeatPapers(courseId);
+    db.findSeatPaper(courseId, Seat(1, 1), seatPaper);
+    db.deleteSeatPaper(courseId, Seat(1, 1));
+    
+    // Seeded papers: current pool version, snapshot, regeneration
+    PaperSeed seed(0, paperSeedFor(1, courseId, 1), 40);
+    db.getRandomQuestions(courseId, 40, seed);
+    vector<int> regenerated;
+    db.getPaperQuestionIds(courseId, seed, regenerated);
+    db.countExamSessions(1, courseId);
+
+    // A sitting keeps its snapshot; a new pool version prunes the rest
+    ExamSession seededSession;
+    seededSession.userId = 1;
+    seededSession.courseId = courseId;
+    seededSession.seed = seed;
+    seededSession.questionIds = regenerated;
+    seededSession.timeRemaining = 600;
+    db.openExamSession(seededSession);
+    db.closeExamSession(seededSession.id);
+    db.addQuestion(courseId, "q2", "a", "b", "c", "d", "B", 1);
+    PaperSeed nextSeed(0, paperSeedFor(1, courseId, 2), 40);
+    db.getRandomQuestions(courseId, 40, nextSeed);
+
+    Result r;
+    r.userId = 1;
+    r.courseId = courseId;
+    db.saveResult(r);
+    
+    // Re-grading after an answer key fix
+    vector<Question> key = db.getCourseAnswerKey(courseId);
+    if (!key.empty()) db.updateCorrectAnswer(key[0].id, key[0].correctAnswer);
+    int firstResultId = 0, lastResultId = 0;
+    db.getResultPaperRange(courseId, firstResultId, lastResultId);
+    vector<ResultPaper> papers;
+    db.loadResultPapers(courseId, 0, lastResultId, 100, papers);
+    vector<Result> regraded;
+    for (size_t i = 0; i < papers.size(); i++) {
+        Result changed;
+        changed.id = papers[i].resultId;
+        regraded.push_back(changed);
+    }
+    db.updateResultScores(regraded);
+    
+    ExamSession session;
+    session.userId = 1;
+    session.courseId = courseId;
+    session.questionIds.push_back(1);
+    session.timeRemaining = 600;
+    db.openExamSession(session);
+    vector<SessionAnswer> changes;
+    changes.push_back(SessionAnswer(0, "B"));
+    db.saveSessionProgress(session.id, changes, 0, 595, 5);
+    ExamSession resumed;
+    db.findOpenExamSession(1, courseId, resumed);
+    db.closeExamSession(session.id);
+    
+    ResultPaper paper;
+    paper.courseId = courseId;
+    paper.questionIds.push_back(1);
+    paper.answers = AnswerSheet::fromAnswers(vector<string>(1, "B"));
+    db.openExamSession(session);
+    db.submitResult(r, paper, session.id, changes);
+    
+    // Every filter shape the results views use, first page and next page
+    for (int shape = 0; shape < 6; shape++) {
+        ResultQuery query;
+        if (shape == 1) query.userId = 1;
+        if (shape == 2) query.courseId = courseId;
+        if (shape == 3) query.passed = 1;
+        if (shape == 4) query.courseId = courseId, query.passed = 0;
+        if (shape == 5) query.fromDate = "2000-01-01", query.toDate = "2100-01-01";
+        db.streamResults(query, ignoreRow, NULL);
+        db.streamResults(query, ignoreRow, NULL);
+        db.countResults(query);
+    }
+    
+    // Every column the admin results grid sorts by, both directions,
+    // unfiltered and with the grid's filters, plus an OFFSET jump
+    for (int sort = SORT_DATE; sort <= SORT_SCORE; sort++) {
+        for (int filter = 0; filter < 3; filter++) {
+            for (int dir = 0; dir < 2; dir++) {
+                ResultQuery query;
+                query.sortBy = (ResultSort)sort;
+                query.ascending = dir == 1;
+                if (filter == 1) query.courseId = courseId;
+                if (filter == 2) query.passed = 1;
+                db.streamResults(query, ignoreRow, NULL);
+                query.offset = 500;
+                db.streamResults(query, ignoreRow, NULL);
+            }
+        }
+    }
+}
+
+static bool isFullScan(const string& planLine) {
+    // "SCAN t" without an index is a table scan; "SCAN t USING INDEX"
+    // walks an index in order and is how unfiltered listings are served
+    return planLine.find("SCAN ") != string::npos &&
+           planLine.find("USING") == string::npos &&
+           planLine.find("CONSTANT ROW") == string::npos;
+}
+
+int main(int argc, char** argv) {
+    int questionCount = argc > 1 ? atoi(argv[1]) : 200000;
+    int resultCount = argc > 2 ? atoi(argv[2]) : 100000;
+    string path = argc > 3 ? argv[3] : "exam_queryplan.db";
+    
+    removeDatabase(path);
+    DatabaseManager db(path, StorageProfile::bulkImport());
+    if (!db.isReady()) {
+        fprintf(stderr, "%s\n", db.getLastError().c_str());
+        return 1;
+    }
+    
+    SeedSpec spec;
+    spec.questionsPerCourse = questionCount / spec.courses;
+    spec.users = 500;
+    spec.results = resultCount;
+    seedDatabase(&db, spec);
+    exercise(db, spec);
+    
+    vector<string> queries = db.getStatementCache()->statementsSql();
+    int failures = 0;
+    
+    for (size_t i = 0; i < queries.size(); i++) {
+        string plan = db.explainQueryPlan(queries[i]);
+        if (plan.empty()) continue;
+        
+        bool scan = false;
+        stringstream lines(plan);
+        string line;
+        while (getline(lines, line)) {
+            if (isFullScan(line)) scan = true;
+        }
+        
+        printf("%s %s\n", scan ? "[SCAN]" : "[ OK ]", queries[i].c_str());
+        lines.clear();
+        lines.str(plan);
+        while (getline(lines, line)) {
+            printf("         %s\n", line.c_str());
+        }
+        if (scan) failures++;
+    }
+    
+    printf("\n%d queries checked, %d full table scan(s)\n", (int)queries.size(), failures);
+    removeDatabase(path);
+    return failures == 0 ? 0 : 1;
+}
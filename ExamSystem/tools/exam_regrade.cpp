@@ -0,0 +1,83 @@
+// Re-grades every stored paper of a course against its current answer key,
+// optionally correcting one question's answer first.
+//
+// Usage: exam_regrade <course-code> [database-path] [threads]
+//                     [question-id new-answer]
+//
+// Example after a wrong key on question 1234 of SEED001:
+//   exam_regrade SEED001 exam_seed.db 0 1234 C
+
+#include "DatabaseManager.h"
+#include "Regrader.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+
+using namespace std;
+
+static void printProgress(int done, int total, void* data) {
+    // Only when the whole percentage moves
+    int* lastPercent = (int*)data;
+    int percent = total > 0 ? (int)(done * 100LL / total) : 100;
+    if (percent != *lastPercent) {
+        *lastPercent = percent;
+        printf("\r  %d / %d papers (%d%%)", done, total, percent);
+        fflush(stdout);
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <course-code> [database-path] [threads] "
+                        "[question-id new-answer]\n", argv[0]);
+        return 1;
+    }
+    string code = argv[1];
+    string path = argc > 2 ? argv[2] : "database/exam_system.db";
+    int threads = argc > 3 ? atoi(argv[3]) : 0;
+
+    DatabaseManager db(path);
+    if (!db.isReady()) {
+        fprintf(stderr, "%s\n", db.getLastError().c_str());
+        return 1;
+    }
+    int courseId = db.getCourseIdByCode(code);
+    if (courseId <= 0) {
+        fprintf(stderr, "No course with code %s\n", code.c_str());
+        return 1;
+    }
+
+    if (argc > 5) {
+        int questionId = atoi(argv[4]);
+        string answer = argv[5];
+        if (answer.size() != 1 || toupper(answer[0]) < 'A' || toupper(answer[0]) > 'D') {
+            fprintf(stderr, "The new answer must be one of A, B, C or D\n");
+            return 1;
+        }
+        answer[0] = (char)toupper(answer[0]);
+        if (!db.updateCorrectAnswer(questionId, answer)) {
+            fprintf(stderr, "Could not set the answer of question %d to %s: %s\n",
+                    questionId, answer.c_str(), db.getLastError().c_str());
+            return 1;
+        }
+        printf("Question %d now answered %s\n", questionId, answer.c_str());
+    }
+
+    printf("Re-grading %s...\n", code.c_str());
+    RegradeStats stats;
+    int lastPercent = -1;
+    bool ok = regradeCourse(&db, courseId, &stats, threads, printProgress, &lastPercent);
+    printf("\n");
+
+    printf("Papers:  %d\n", stats.papers);
+    printf("Changed: %d\n", stats.changed);
+    printf("Skipped: %d (unreadable or with deleted questions, results left as they were)\n", stats.skipped);
+    printf("Threads: %d\n", stats.threads);
+    printf("Time:    %.3f s (%.0f papers/sec)\n", stats.seconds, stats.papersPerSecond);
+
+    if (!ok) {
+        fprintf(stderr, "Re-grade failed: %s\n", db.getLastError().c_str());
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,118 @@
+// Synthetic database seeder: builds a reproducible database of the given
+// size for performance testing. The same arguments always give the same rows.
+// Candidates are seed000001, seed000002, ... with password "seedpass".
+//
+// The database file is created from scratch; an existing one is only
+// replaced with --force.
+//
+// Usage: exam_seed [--force] [courses] [questions-per-course] [users] [results]
+//                  [database-path] [seed]
+
+#include "DatabaseManager.h"
+#include "DatabaseSeeder.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <cerrno>
+
+using namespace std;
+
+static void removeDatabase(const string& path) {
+    remove(path.c_str());
+    remove((path + "-wal").c_str());
+    remove((path + "-shm").c_str());
+    remove((path + "-journal").c_str());
+}
+
+static bool fileExists(const string& path) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file) {
+        fclose(file);
+    }
+    return file != NULL;
+}
+
+// A whole decimal number from minimum to maximum
+static bool parseCount(const char* text, long long minimum, long long maximum,
+                       long long& value) {
+    char* end = NULL;
+    errno = 0;
+    value = strtoll(text, &end, 10);
+    return end != text && *end == '\0' && errno == 0 && value >= minimum && value <= maximum;
+}
+
+static int usage(const char* program) {
+    fprintf(stderr, "Usage: %s [--force] [courses] [questions-per-course] [users] [results] "
+            "[database-path] [seed]\n"
+            "Builds a new database; --force replaces an existing database-path.\n", program);
+    return 1;
+}
+
+int main(int argc, char** argv) {
+    bool force = false;
+    vector<const char*> args;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--force") == 0) {
+            force = true;
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            return usage(argv[0]);
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+    if (args.size() > 6) {
+        return usage(argv[0]);
+    }
+
+    SeedSpec spec;
+    int* counts[4] = { &spec.courses, &spec.questionsPerCourse, &spec.users, &spec.results };
+    const long long minimums[4] = { 1, 1, 0, 0 };
+    for (size_t i = 0; i < 4 && i < args.size(); i++) {
+        long long value;
+        if (!parseCount(args[i], minimums[i], INT_MAX, value)) {
+            fprintf(stderr, "Not a valid count: %s\n", args[i]);
+            return usage(argv[0]);
+        }
+        *counts[i] = (int)value;
+    }
+    string path = args.size() > 4 ? args[4] : "exam_seed.db";
+    if (args.size() > 5) {
+        long long value;
+        if (!parseCount(args[5], 0, UINT_MAX, value)) {
+            fprintf(stderr, "Not a valid seed: %s\n", args[5]);
+            return usage(argv[0]);
+        }
+        spec.seed = (unsigned int)value;
+    }
+
+    if (fileExists(path) && !force) {
+        fprintf(stderr, "%s already exists; pass --force to replace it\n", path.c_str());
+        return 1;
+    }
+    // Always starts from an empty file, so the rows depend only on the spec
+    removeDatabase(path);
+    DatabaseManager db(path, StorageProfile::bulkImport());
+    if (!db.isReady()) {
+        fprintf(stderr, "%s\n", db.getLastError().c_str());
+        return 1;
+    }
+
+    printf("Seeding %s (seed %u)...\n", path.c_str(), spec.seed);
+    SeedStats stats;
+    bool ok = seedDatabase(&db, spec, &stats);
+
+    int rows = stats.courses + stats.questions + stats.users + stats.results;
+    printf("Courses:   %d\n", stats.courses);
+    printf("Questions: %d\n", stats.questions);
+    printf("Users:     %d\n", stats.users);
+    printf("Results:   %d\n", stats.results);
+    printf("Time:      %.3f s (%.0f rows/sec)\n", stats.seconds,
+           stats.seconds > 0 ? rows / stats.seconds : 0);
+
+    if (!ok) {
+        fprintf(stderr, "Seeding failed: %s\n", db.getLastError().c_str());
+        return 2;
+    }
+    return 0;
+}